@@ -0,0 +1,520 @@
+#include "sapien_vulkan/camera.h"
+#include "sapien_vulkan/camera_controller.h"
+#include "sapien_vulkan/common/log.h"
+#include "sapien_vulkan/common/profiler.h"
+#include "sapien_vulkan/internal/vulkan_context.h"
+#include "sapien_vulkan/internal/vulkan_material.h"
+#include "sapien_vulkan/internal/vulkan_renderer.h"
+#include "sapien_vulkan/scene.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+
+using namespace svulkan;
+
+/* Headless rendering benchmark. Renders a generated or loaded scene for a fixed number of frames
+ * at every combination of resolution and camera count, then runs each download path, and
+ * prints a JSON report. Runs on any Vulkan device, e.g. --device=llvmpipe for lavapipe.
+ * CPU times come from the profiler scopes; --trace=FILE writes a Chrome trace of the last run.
+ *
+ *   bench --scene=primitives --objects=1000 --resolutions=640x480,1920x1080 --cameras=1,4
+ *   bench --scene=instances --mesh=model.obj --copies=500
+ *   bench --scene=sponza --sponza=../assets/sponza/sponza.obj --output=sponza.json */
+
+namespace {
+
+struct Options {
+  std::string scene{"primitives"};
+  std::string sponza{"../assets/sponza/sponza.obj"};
+  std::string mesh{}; // instances of a sphere when empty
+  uint32_t objects{1000};
+  uint32_t copies{100};
+  std::vector<std::pair<uint32_t, uint32_t>> resolutions{{640, 480}};
+  std::vector<uint32_t> cameras{1};
+  uint32_t frames{100};
+  uint32_t warmup{10};
+  uint32_t downloads{20};
+  std::string device{};
+  std::string shaderDir{};
+  std::string output{};
+  std::string trace{};
+  uint32_t seed{0};
+};
+
+struct DownloadResult {
+  std::string name;
+  std::string error;
+  uint32_t calls{0};
+  double milliseconds{0}; // per call
+  size_t bytes{0};        // per call
+};
+
+struct RunResult {
+  uint32_t width;
+  uint32_t height;
+  uint32_t cameras;
+  std::string error;
+  double framesPerSecond{0};
+  double frameMilliseconds{0};
+  std::vector<profiler::ScopeSummary> cpu;
+  std::vector<PassTiming> gpu;
+  RenderStats stats; // of the last frame
+  MemoryStats memory; // with the renderer of the run alive
+  std::vector<DownloadResult> downloads;
+};
+
+} // namespace
+
+static std::vector<std::string> split(std::string const &str, char delimiter) {
+  std::vector<std::string> result;
+  std::stringstream stream(str);
+  std::string item;
+  while (std::getline(stream, item, delimiter)) {
+    if (!item.empty()) {
+      result.push_back(item);
+    }
+  }
+  return result;
+}
+
+static Options parseOptions(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    auto eq = arg.find('=');
+    if (arg.rfind("--", 0) != 0 || eq == std::string::npos) {
+      throw std::runtime_error("Arguments are given as --name=value, got " + arg);
+    }
+    std::string name = arg.substr(2, eq - 2);
+    std::string value = arg.substr(eq + 1);
+    if (name == "scene") {
+      options.scene = value;
+    } else if (name == "sponza") {
+      options.sponza = value;
+    } else if (name == "mesh") {
+      options.mesh = value;
+    } else if (name == "objects") {
+      options.objects = std::stoul(value);
+    } else if (name == "copies") {
+      options.copies = std::stoul(value);
+    } else if (name == "resolutions") {
+      options.resolutions.clear();
+      for (auto &resolution : split(value, ',')) {
+        auto size = split(resolution, 'x');
+        if (size.size() != 2) {
+          throw std::runtime_error("Resolutions are given as WIDTHxHEIGHT, got " + resolution);
+        }
+        options.resolutions.push_back({std::stoul(size[0]), std::stoul(size[1])});
+      }
+    } else if (name == "cameras") {
+      options.cameras.clear();
+      for (auto &count : split(value, ',')) {
+        options.cameras.push_back(std::stoul(count));
+      }
+    } else if (name == "frames") {
+      options.frames = std::max<uint32_t>(std::stoul(value), 1);
+    } else if (name == "warmup") {
+      options.warmup = std::stoul(value);
+    } else if (name == "downloads") {
+      options.downloads = std::max<uint32_t>(std::stoul(value), 1);
+    } else if (name == "device") {
+      options.device = value;
+    } else if (name == "shader-dir") {
+      options.shaderDir = value;
+    } else if (name == "output") {
+      options.output = value;
+    } else if (name == "trace") {
+      options.trace = value;
+    } else if (name == "seed") {
+      options.seed = std::stoul(value);
+    } else {
+      throw std::runtime_error("Unknown argument --" + name);
+    }
+  }
+  return options;
+}
+
+static void addLights(Scene &scene) {
+  scene.setAmbientLight({0.3, 0.3, 0.3, 1});
+  scene.addDirectionalLight({{0, -1, -0.1, 1}, {1, 1, 1, 1}});
+  scene.addPointLight({{0.5, 0.3, 0, 1}, {1, 0, 0, 1}});
+  scene.addPointLight({{0, 0.3, 0, 1}, {0, 1, 0, 1}});
+  scene.addPointLight({{-0.5, 0.3, 0, 1}, {0, 0, 1, 1}});
+}
+
+/* spheres, cubes and capsules scattered around the cameras, sharing a few materials */
+static void loadPrimitives(VulkanContext &context, Scene &scene, Options const &options) {
+  std::vector<std::shared_ptr<VulkanMesh>> meshes = {
+      context.loadSphere()->getVulkanObject()->mMesh,
+      context.loadCube()->getVulkanObject()->mMesh,
+      context.loadCapsule(0.5f, 0.5f)->getVulkanObject()->mMesh};
+  std::mt19937 random(options.seed);
+  std::uniform_real_distribution<float> unit(0.f, 1.f);
+  std::vector<std::shared_ptr<VulkanMaterial>> materials;
+  for (uint32_t i = 0; i < 8; ++i) {
+    auto material = context.createMaterial();
+    PBRMaterialUBO properties;
+    properties.baseColor = {unit(random), unit(random), unit(random), 1};
+    properties.roughness = unit(random);
+    material->setProperties(properties);
+    materials.push_back(material);
+  }
+
+  for (uint32_t i = 0; i < options.objects; ++i) {
+    auto obj = context.createObject(meshes[i % meshes.size()], materials[i % materials.size()]);
+    obj->mTransform.position = {4 * unit(random) - 2, 4 * unit(random) - 2, 4 * unit(random) - 2};
+    obj->mTransform.scale = glm::vec3(0.02f + 0.04f * unit(random));
+    obj->setSegmentId(i % 255 + 1);
+    scene.addObject(std::move(obj));
+  }
+  addLights(scene);
+}
+
+/* copies of every mesh of a file on a grid, meshes and materials are shared */
+static void loadInstances(VulkanContext &context, Scene &scene, Options const &options) {
+  std::vector<std::pair<std::shared_ptr<VulkanMesh>, std::shared_ptr<VulkanMaterial>>> parts;
+  auto objects = options.mesh.empty() ? std::vector<std::unique_ptr<Object>>{}
+                                      : context.loadObjects(options.mesh);
+  if (options.mesh.empty()) {
+    objects.push_back(context.loadSphere());
+  }
+  for (auto &obj : objects) {
+    parts.push_back({obj->getVulkanObject()->mMesh, obj->getMaterial()});
+  }
+
+  uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(float(options.copies))));
+  float spacing = 4.f / std::max(side, 1u);
+  for (uint32_t i = 0; i < options.copies; ++i) {
+    glm::vec3 cell(i % side, i / side % side, i / side / side);
+    for (auto &[mesh, material] : parts) {
+      auto obj = context.createObject(mesh, material);
+      obj->mTransform.position = cell * spacing - glm::vec3(2.f);
+      obj->mTransform.scale = glm::vec3(spacing * 0.4f);
+      obj->setSegmentId(i % 255 + 1);
+      scene.addObject(std::move(obj));
+    }
+  }
+  addLights(scene);
+}
+
+static DownloadResult measure(std::string const &name, uint32_t calls,
+                              std::function<size_t()> const &download) {
+  DownloadResult result;
+  result.name = name;
+  try {
+    download(); // first call allocates staging memory and pipelines
+    int64_t begin = profiler::now();
+    for (uint32_t i = 0; i < calls; ++i) {
+      result.bytes = download();
+    }
+    result.calls = calls;
+    result.milliseconds = (profiler::now() - begin) * 1e-6 / calls;
+  } catch (std::exception const &e) {
+    result.error = e.what();
+  }
+  return result;
+}
+
+static std::vector<DownloadResult> benchmarkDownloads(VulkanContext &context,
+                                                      VulkanRenderer &renderer,
+                                                      RunResult const &run, uint32_t calls) {
+  auto device = context.getDevice();
+  auto commandBuffer = createCommandBuffer(device, context.getCommandPool(),
+                                           vk::CommandBufferLevel::ePrimary);
+  auto fence = device.createFenceUnique({});
+  auto submit = [&]() {
+    commandBuffer->end();
+    context.getGraphicsQueue().submit(vk::SubmitInfo(0, nullptr, nullptr, 1, &commandBuffer.get()),
+                                      fence.get());
+  };
+
+  std::vector<DownloadResult> results;
+  results.push_back(measure("downloadLighting", calls, [&]() {
+    return renderer.downloadLighting().size() * sizeof(float);
+  }));
+  results.push_back(measure("downloadTargets", calls, [&]() {
+    auto targets = renderer.downloadTargets({RenderTarget::eAlbedo, RenderTarget::eNormal,
+                                             RenderTarget::eDepth, RenderTarget::eSegmentation});
+    size_t size = 0;
+    for (size_t i = 0; i < targets.count(); ++i) {
+      size += targets.size(i);
+    }
+    return size;
+  }));
+  results.push_back(measure("downloadConverted", calls, [&]() {
+    auto targets = renderer.downloadConverted({DownloadConversion::rgb8(RenderTarget::eLighting),
+                                               DownloadConversion::depthMillimeters(),
+                                               DownloadConversion::segmentationId()});
+    size_t size = 0;
+    for (size_t i = 0; i < targets.count(); ++i) {
+      size += targets.size(i);
+    }
+    return size;
+  }));
+  std::vector<char> destination;
+  results.push_back(measure("downloadInto", calls, [&]() {
+    destination.resize(renderer.getDownloadSize(RenderTarget::eLighting));
+    renderer.downloadInto(RenderTarget::eLighting, destination.data());
+    return destination.size();
+  }));
+  results.push_back(measure("downloadAsync", calls, [&]() {
+    commandBuffer->begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    auto future = renderer.downloadAsync(commandBuffer.get(), fence.get(), RenderTarget::eLighting);
+    submit();
+    size_t size = future.get().size() * sizeof(float);
+    device.resetFences(fence.get());
+    return size;
+  }));
+  results.push_back(measure("downloadSegmentationAsync", calls, [&]() {
+    commandBuffer->begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    auto future = renderer.downloadSegmentationAsync(commandBuffer.get(), fence.get());
+    submit();
+    size_t size = future.get().size() * sizeof(uint32_t);
+    device.resetFences(fence.get());
+    return size;
+  }));
+
+  std::mt19937 random(0);
+  std::vector<PixelQuery> points;
+  for (uint32_t i = 0; i < 1024; ++i) {
+    points.push_back({static_cast<int32_t>(random() % run.width),
+                      static_cast<int32_t>(random() % run.height), 0, i % run.cameras});
+  }
+  results.push_back(measure("queryPixels", calls, [&]() {
+    auto result = renderer.queryPixels({RenderTarget::eDepth, RenderTarget::eSegmentation}, points);
+    return result.values.size() * sizeof(glm::uvec4);
+  }));
+  results.push_back(measure("computeSegmentationStats", calls, [&]() {
+    auto result = renderer.computeSegmentationStats({0}, 256);
+    return result.stats.size() * sizeof(SegmentationStats);
+  }));
+  results.push_back(measure("computePointCloud", calls, [&]() {
+    PointCloudConfig config;
+    config.color = true;
+    auto result = renderer.computePointCloud(config);
+    return result.positions.size() * sizeof(glm::vec3) + result.colors.size() * sizeof(uint32_t);
+  }));
+  return results;
+}
+
+static RunResult run(VulkanContext &context, Scene &scene, Options const &options,
+                     uint32_t width, uint32_t height, uint32_t cameraCount) {
+  RunResult result{width, height, cameraCount};
+  // a single camera renders without multiview
+  if (cameraCount > 1 &&
+      cameraCount > std::min(MaxCameraViews, context.getMaxMultiviewViewCount())) {
+    result.error = "too many cameras for multiview on this device";
+    return result;
+  }
+
+  VulkanRendererConfig config;
+  config.viewCount = cameraCount;
+  config.passTimers = true;
+  auto renderer = context.createVulkanRenderer(config);
+  renderer->resize(width, height);
+
+  std::vector<std::unique_ptr<Camera>> cameras;
+  std::vector<Camera *> cameraPointers;
+  for (uint32_t i = 0; i < cameraCount; ++i) {
+    cameras.push_back(context.createCamera());
+    cameras.back()->aspect = static_cast<float>(width) / height;
+    FPSCameraController controller(*cameras.back(), {0, 0, -1}, {0, 1, 0});
+    controller.setXYZ(0, 0.3, 0);
+    controller.setRPY(0, 0, 1.5f + 6.283f * i / cameraCount);
+    cameraPointers.push_back(cameras.back().get());
+  }
+
+  auto device = context.getDevice();
+  auto commandBuffer = createCommandBuffer(device, context.getCommandPool(),
+                                           vk::CommandBufferLevel::ePrimary);
+  auto fence = device.createFenceUnique({});
+  int64_t begin = 0;
+  for (uint32_t frame = 0; frame < options.warmup + options.frames; ++frame) {
+    if (frame == options.warmup) {
+      profiler::clear();
+      begin = profiler::now();
+    }
+    SVULKAN_PROFILE_SCOPE("frame");
+    {
+      SVULKAN_PROFILE_SCOPE("record");
+      commandBuffer->begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+      if (cameraCount == 1) {
+        renderer->render(commandBuffer.get(), scene, *cameras[0]);
+      } else {
+        renderer->render(commandBuffer.get(), scene, cameraPointers);
+      }
+      commandBuffer->end();
+    }
+    {
+      SVULKAN_PROFILE_SCOPE("submit");
+      context.getGraphicsQueue().submit(
+          vk::SubmitInfo(0, nullptr, nullptr, 1, &commandBuffer.get()), fence.get());
+    }
+    {
+      SVULKAN_PROFILE_SCOPE("wait for frame");
+      device.waitForFences(fence.get(), VK_TRUE, UINT64_MAX);
+      device.resetFences(fence.get());
+    }
+  }
+  double seconds = (profiler::now() - begin) * 1e-9;
+  result.framesPerSecond = options.frames / seconds;
+  result.frameMilliseconds = seconds * 1e3 / options.frames;
+  result.cpu = profiler::summarize();
+  result.gpu = renderer->getPassTimings();
+  result.stats = renderer->getRenderStats();
+
+  result.downloads = benchmarkDownloads(context, *renderer, result, options.downloads);
+  result.memory = context.getMemoryStats();
+  device.waitIdle();
+  return result;
+}
+
+static std::string quote(std::string const &str) {
+  std::string out = "\"";
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+    }
+    out += static_cast<unsigned char>(c) < 0x20 ? ' ' : c;
+  }
+  return out + "\"";
+}
+
+static std::string number(double value) {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.4f", value);
+  return buffer;
+}
+
+static std::string toJson(Options const &options, std::string const &deviceName,
+                          size_t objectCount, std::vector<RunResult> const &runs) {
+  std::ostringstream out;
+  out << "{\n  \"device\": " << quote(deviceName) << ",\n  \"scene\": " << quote(options.scene)
+      << ",\n  \"objects\": " << objectCount << ",\n  \"frames\": " << options.frames
+      << ",\n  \"runs\": [";
+  for (size_t r = 0; r < runs.size(); ++r) {
+    auto &run = runs[r];
+    uint32_t frames = options.frames;
+    out << (r ? "," : "") << "\n    {\"width\": " << run.width << ", \"height\": " << run.height
+        << ", \"cameras\": " << run.cameras;
+    if (!run.error.empty()) {
+      out << ", \"error\": " << quote(run.error) << "}";
+      continue;
+    }
+    out << ", \"fps\": " << number(run.framesPerSecond)
+        << ", \"frameMs\": " << number(run.frameMilliseconds) << ",\n     \"cpuMsPerFrame\": {";
+    for (size_t i = 0; i < run.cpu.size(); ++i) {
+      out << (i ? ", " : "") << quote(run.cpu[i].name) << ": "
+          << number(run.cpu[i].totalMilliseconds / frames);
+    }
+    out << "},\n     \"gpuMsPerFrame\": {";
+    for (size_t i = 0; i < run.gpu.size(); ++i) {
+      out << (i ? ", " : "") << quote(run.gpu[i].name) << ": "
+          << number(run.gpu[i].averageMilliseconds);
+    }
+    out << "},\n     \"uploadedBytesPerFrame\": " << run.stats.uploadedBytes
+        << ",\n     \"commandsPerFrame\": {";
+    auto passes = run.stats.passes;
+    passes.push_back(run.stats.total);
+    for (size_t i = 0; i < passes.size(); ++i) {
+      auto &pass = passes[i];
+      out << (i ? ",\n       " : "\n       ") << quote(pass.name)
+          << ": {\"draws\": " << pass.drawCalls << ", \"instances\": " << pass.instances
+          << ", \"triangles\": " << pass.triangles << ", \"pipelines\": " << pass.pipelineBinds
+          << ", \"descriptorSets\": " << pass.descriptorSetBinds
+          << ", \"vertexBuffers\": " << pass.vertexBufferBinds
+          << ", \"indexBuffers\": " << pass.indexBufferBinds
+          << ", \"barriers\": " << pass.barriers << "}";
+    }
+    out << "},\n     \"memory\": {\"bytes\": " << run.memory.bytes
+        << ", \"peakBytes\": " << run.memory.peakBytes;
+    for (uint32_t i = 0; i < static_cast<uint32_t>(MemoryCategory::eCount); ++i) {
+      auto category = static_cast<MemoryCategory>(i);
+      out << ", " << quote(getMemoryCategoryName(category)) << ": "
+          << run.memory.get(category).bytes;
+    }
+    out << "},\n     \"downloads\": [";
+    for (size_t i = 0; i < run.downloads.size(); ++i) {
+      auto &download = run.downloads[i];
+      out << (i ? "," : "") << "\n       {\"name\": " << quote(download.name);
+      if (!download.error.empty()) {
+        out << ", \"error\": " << quote(download.error) << "}";
+        continue;
+      }
+      double megabytes = download.bytes / (1024.0 * 1024.0);
+      out << ", \"ms\": " << number(download.milliseconds) << ", \"bytes\": " << download.bytes
+          << ", \"MBps\": " << number(megabytes / (download.milliseconds * 1e-3)) << "}";
+    }
+    out << "]}";
+  }
+  out << "\n  ]\n}\n";
+  return out.str();
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  try {
+    options = parseOptions(argc, argv);
+  } catch (std::exception const &e) {
+    log::error("{}", e.what());
+    return 1;
+  }
+  if (!options.shaderDir.empty()) {
+    VulkanContext::setDefaultShaderDir(options.shaderDir);
+  }
+  profiler::setThreadCapacity(1 << 20);
+  profiler::setEnabled(true);
+
+  uint32_t objectCount = options.scene == "primitives" ? options.objects
+                         : options.scene == "instances" ? options.copies
+                                                        : 0;
+  VulkanContext context(false, objectCount + 1000, options.device);
+  std::string deviceName = context.getPhysicalDevice().getProperties().deviceName;
+
+  auto scene = Scene(context.createVulkanScene());
+  if (options.scene == "primitives") {
+    loadPrimitives(context, scene, options);
+  } else if (options.scene == "instances") {
+    loadInstances(context, scene, options);
+  } else if (options.scene == "sponza") {
+    for (auto &obj : context.loadObjects(options.sponza, {0.001f, 0.001f, 0.001f})) {
+      scene.addObject(std::move(obj));
+    }
+    addLights(scene);
+  } else {
+    log::error("Unknown scene {}, use primitives, instances or sponza", options.scene);
+    return 1;
+  }
+  scene.prepareObjectsForRender();
+  size_t renderedObjects = scene.getOpaqueObjects().size() + scene.getTransparentObjects().size();
+
+  std::vector<RunResult> runs;
+  for (auto [width, height] : options.resolutions) {
+    for (uint32_t cameras : options.cameras) {
+      log::info("Rendering {} x {} with {} camera(s)", width, height, cameras);
+      runs.push_back(run(context, scene, options, width, height, cameras));
+    }
+  }
+
+  if (!options.trace.empty() && !profiler::writeChromeTrace(options.trace)) {
+    log::error("Failed to write trace {}", options.trace);
+  }
+  std::string json = toJson(options, deviceName, renderedObjects, runs);
+  if (options.output.empty()) {
+    std::cout << json;
+  } else {
+    std::ofstream file(options.output);
+    file << json;
+    if (!file) {
+      log::error("Failed to write {}", options.output);
+      return 1;
+    }
+  }
+  return 0;
+}
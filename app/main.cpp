@@ -3,6 +3,7 @@
 #include "sapien_vulkan/internal/vulkan_renderer_for_editor.h"
 #include "sapien_vulkan/scene.h"
 #include "sapien_vulkan/common/log.h"
+#include "sapien_vulkan/common/profiler.h"
 #include "sapien_vulkan/pass/axis.h"
 #include "sapien_vulkan/pass/gbuffer.h"
 #include "sapien_vulkan/pass/transparency.h"
@@ -13,10 +14,10 @@
 
 #include "sapien_vulkan/gui/gui.h"
 
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "sapien_vulkan/common/stb_image_write.h"
+#include "sapien_vulkan/frame_writer.h"
 
 #include <chrono>
+#include <cstdlib>
 
 using namespace svulkan;
 
@@ -83,7 +84,9 @@ int main() {
   VulkanRendererConfig config;
   config.customTextureCount = 1;
   // auto renderer = context.createVulkanRendererForEditor(config);
-  auto renderer = context.createVulkanRenderer();
+  VulkanRendererConfig rendererConfig;
+  rendererConfig.passTimers = true;
+  auto renderer = context.createVulkanRenderer(rendererConfig);
   auto m = glm::mat4(1);
   m[0][0] = 0.1;
   m[1][1] = 0.1;
@@ -125,8 +128,16 @@ int main() {
 
   glfwSetWindowSizeCallback(vwindow->getWindow(), glfw_resize_callback);
 
+  FrameWriter frameWriter;
+
+  // SVULKAN_TRACE=trace.json records a Chrome trace of the session into that file
+  char const *traceFile = std::getenv("SVULKAN_TRACE");
+  profiler::setEnabled(traceFile != nullptr);
+
+  bool showStatistics = false; // pass timings and render stats, toggled with 't'
   int count = 0;
   while (!vwindow->isClosed()) {
+    SVULKAN_PROFILE_SCOPE("frame");
     count += 1;
 
     if (gSwapchainRebuild) {
@@ -150,16 +161,22 @@ int main() {
 
     ImGui::NewFrame();
     ImGui::ShowDemoWindow();
+    if (showStatistics) {
+      drawPassTimings(renderer->getPassTimings());
+      drawRenderStats(renderer->getRenderStats());
+    }
     ImGui::Render();
 
     // wait for previous frame to finish
     {
+      SVULKAN_PROFILE_SCOPE("wait for frame");
       device.waitForFences(sceneRenderFence.get(), VK_TRUE, UINT64_MAX);
       device.resetFences(sceneRenderFence.get());
     }
 
     // draw
     {
+      SVULKAN_PROFILE_SCOPE("record and submit");
       sceneCommandBuffer->begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
       renderer->render(sceneCommandBuffer.get(), scene, *camera);
       renderer->display(sceneCommandBuffer.get(), vwindow->getBackBuffer(),
@@ -185,43 +202,22 @@ int main() {
     }
     device.waitIdle();
 
-    // {
-    //   auto albedo = renderer->downloadAlbedo();
-    //   std::vector<uint8_t> img(albedo.size());
-    //   for (uint32_t i = 0; i < albedo.size(); ++i) {
-    //     img[i] = static_cast<uint8_t>(std::clamp(albedo[i] * 255, 0.f, 255.f));
-    //   }
-    //   stbi_write_png("albedo.png", 800, 600, 4, img.data(), 4 * 800);
-    // }
-    // {
-    //   auto normal = renderer->downloadNormal();
-    //   std::vector<uint8_t> img(normal.size());
-    //   for (uint32_t i = 0; i < normal.size(); ++i) {
-    //     img[i] = static_cast<uint8_t>(std::clamp(normal[i] * 255, 0.f, 255.f));
-    //   }
-    //   stbi_write_png("normal.png", 800, 600, 4, img.data(), 4 * 800);
-    // }
-    // {
-    //   auto position = renderer->downloadPosition();
-    //   std::vector<uint8_t> img(position.size());
-    //   for (uint32_t i = 0; i < position.size(); ++i) {
-    //     img[i] = static_cast<uint8_t>(std::clamp(position[i] * 255, 0.f, 255.f));
-    //   }
-    //   stbi_write_png("position.png", 800, 600, 4, img.data(), 4 * 800);
-    // }
-    // {
-    //   auto depth = renderer->downloadDepth();
-    //   std::vector<uint8_t> img(depth.size());
-    //   for (uint32_t i = 0; i < depth.size(); ++i) {
-    //     img[i] = static_cast<uint8_t>(std::clamp(depth[i] * 255, 0.f, 255.f));
-    //   }
-    //   stbi_write_png("depth.png", 800, 600, 1, img.data(), 800);
-    // }
-
+    // 'c' captures the targets, converted and written on worker threads
+    if (vwindow->isKeyPressed('c')) {
+      auto targets = renderer->downloadTargets(
+          {RenderTarget::eAlbedo, RenderTarget::eNormal, RenderTarget::ePosition,
+           RenderTarget::eDepth});
+      frameWriter.write(std::move(targets), renderer->getTileExtent(),
+                        {{0, 0, "albedo.png"}, {1, 0, "normal.png"}, {2, 0, "position.png"},
+                         {3, 0, "depth.png"}});
+    }
 
     if (vwindow->isKeyDown('q')) {
       vwindow->close();
     }
+    if (vwindow->isKeyPressed('t')) {
+      showStatistics = !showStatistics;
+    }
 
     if (vwindow->isMouseKeyDown(1)) {
       auto [x, y] = vwindow->getMouseDelta();
@@ -254,6 +250,9 @@ int main() {
     // }
   }
   device.waitIdle();
+  if (traceFile && !profiler::writeChromeTrace(traceFile)) {
+    log::error("Failed to write the trace to {}", traceFile);
+  }
 
   log::info("Finish");
 }
@@ -0,0 +1,228 @@
+#include "sapien_vulkan/common/log.h"
+#include "sapien_vulkan/internal/vulkan_context.h"
+#include "sapien_vulkan/internal/vulkan_resources_manager.h"
+#include "sapien_vulkan/object.h"
+#include "sapien_vulkan/scene.h"
+
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <random>
+
+using namespace svulkan;
+
+/* Microbenchmarks of CPU paths that scale with scene size, 10 to 100k objects each. Results
+ * are written as JSON with --benchmark_format=json or --benchmark_out=FILE.
+ *
+ * Scene benchmarks use objects without Vulkan resources, so a scene of 100k objects does not
+ * need 100k device allocations; the opaque and transparent split of prepareObjectsForRender is
+ * therefore not part of them. Generator and copyToDevice benchmarks need a Vulkan device and
+ * are skipped without one; SVULKAN_DEVICE selects it like VulkanContext does. */
+
+static VulkanContext *getContext() {
+  static std::unique_ptr<VulkanContext> context = []() -> std::unique_ptr<VulkanContext> {
+    char const *device = std::getenv("SVULKAN_DEVICE");
+    try {
+      return std::make_unique<VulkanContext>(false, 1000, device ? device : "");
+    } catch (std::exception const &e) {
+      log::error("No Vulkan device: {}", e.what());
+      return nullptr;
+    }
+  }();
+  return context.get();
+}
+
+static std::unique_ptr<Object> createObject(std::mt19937 &random) {
+  std::uniform_real_distribution<float> unit(-1.f, 1.f);
+  auto obj = std::make_unique<Object>(nullptr);
+  obj->mTransform.position = {unit(random), unit(random), unit(random)};
+  obj->mTransform.rotation =
+      glm::normalize(glm::quat(unit(random), unit(random), unit(random), unit(random)));
+  obj->mTransform.scale = glm::vec3(0.5f + 0.5f * unit(random));
+  return obj;
+}
+
+/* objects at the root of the scene */
+static void fillFlat(Scene &scene, uint32_t count) {
+  std::mt19937 random(0);
+  for (uint32_t i = 0; i < count; ++i) {
+    auto obj = createObject(random);
+    obj->mName = i % 2 ? "odd" : "even";
+    scene.addObject(std::move(obj));
+  }
+}
+
+/* roots with 3 levels of 4 children, like articulated robots */
+static void fillTree(Scene &scene, uint32_t count) {
+  std::mt19937 random(0);
+  std::function<std::unique_ptr<Object>(uint32_t, uint32_t &)> build =
+      [&](uint32_t depth, uint32_t &remaining) {
+        auto obj = createObject(random);
+        --remaining;
+        for (uint32_t i = 0; depth < 3 && i < 4 && remaining > 0; ++i) {
+          obj->addChild(build(depth + 1, remaining));
+        }
+        return obj;
+      };
+  uint32_t remaining = count;
+  while (remaining > 0) {
+    scene.addObject(build(0, remaining));
+  }
+}
+
+static void BM_PrepareObjectsForRender(benchmark::State &state) {
+  Scene scene(nullptr);
+  fillFlat(scene, state.range(0));
+  for (auto _ : state) {
+    scene.prepareObjectsForRender();
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PrepareObjectsForRender)->RangeMultiplier(10)->Range(10, 100000);
+
+static void BM_PrepareObjectTree(benchmark::State &state) {
+  Scene scene(nullptr);
+  fillTree(scene, state.range(0));
+  for (auto _ : state) {
+    scene.prepareObjectsForRender();
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PrepareObjectTree)->RangeMultiplier(10)->Range(10, 100000);
+
+static void BM_GetModelMat(benchmark::State &state) {
+  Scene scene(nullptr);
+  fillFlat(scene, state.range(0));
+  for (auto _ : state) {
+    for (auto &obj : scene.getObjects()) {
+      benchmark::DoNotOptimize(obj->getModelMat());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GetModelMat)->RangeMultiplier(10)->Range(10, 100000);
+
+static void BM_ForceRemove(benchmark::State &state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto scene = std::make_unique<Scene>(nullptr);
+    fillFlat(*scene, state.range(0));
+    uint32_t i = 0;
+    for (auto &obj : scene->getObjects()) {
+      if (i++ % 10 == 0) {
+        scene->removeObject(obj.get());
+      }
+    }
+    state.ResumeTiming();
+    scene->forceRemove();
+    state.PauseTiming();
+    scene.reset(); // destruction is not measured
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ForceRemove)->RangeMultiplier(10)->Range(10, 100000);
+
+static void BM_RemoveObjectsByName(benchmark::State &state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto scene = std::make_unique<Scene>(nullptr);
+    fillFlat(*scene, state.range(0));
+    state.ResumeTiming();
+    scene->removeObjectsByName("odd");
+    scene->forceRemove();
+    state.PauseTiming();
+    scene.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_RemoveObjectsByName)->RangeMultiplier(10)->Range(10, 100000);
+
+/* a grid mesh of about range(0) vertices */
+static void BM_RecalculateNormals(benchmark::State &state) {
+  uint32_t side = std::max(2u, static_cast<uint32_t>(std::sqrt(double(state.range(0)))));
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+  for (uint32_t y = 0; y < side; ++y) {
+    for (uint32_t x = 0; x < side; ++x) {
+      float height = std::sin(x * 0.1f) * std::cos(y * 0.1f);
+      vertices.push_back(Vertex(glm::vec3(x, y, height)));
+    }
+  }
+  for (uint32_t y = 0; y + 1 < side; ++y) {
+    for (uint32_t x = 0; x + 1 < side; ++x) {
+      uint32_t i = y * side + x;
+      indices.insert(indices.end(), {i, i + 1, i + side + 1, i, i + side + 1, i + side});
+    }
+  }
+  for (auto _ : state) {
+    VulkanMesh::recalculateNormals(vertices, indices);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * vertices.size());
+}
+BENCHMARK(BM_RecalculateNormals)->RangeMultiplier(10)->Range(10, 100000);
+
+/* a new manager per iteration, so cached meshes are generated and uploaded every time */
+template <typename Load> static void benchmarkGenerator(benchmark::State &state, Load load) {
+  auto context = getContext();
+  if (!context) {
+    state.SkipWithError("no Vulkan device");
+    return;
+  }
+  for (auto _ : state) {
+    VulkanResourcesManager manager(*context);
+    benchmark::DoNotOptimize(load(manager));
+  }
+}
+
+static void BM_LoadSphere(benchmark::State &state) {
+  benchmarkGenerator(state, [](auto &manager) { return manager.loadSphere(); });
+}
+BENCHMARK(BM_LoadSphere);
+
+static void BM_LoadCube(benchmark::State &state) {
+  benchmarkGenerator(state, [](auto &manager) { return manager.loadCube(); });
+}
+BENCHMARK(BM_LoadCube);
+
+static void BM_LoadCapsule(benchmark::State &state) {
+  benchmarkGenerator(state, [](auto &manager) { return manager.loadCapsule(0.5f, 1.f); });
+}
+BENCHMARK(BM_LoadCapsule);
+
+static void BM_LoadYZPlane(benchmark::State &state) {
+  benchmarkGenerator(state, [](auto &manager) { return manager.loadYZPlane(); });
+}
+BENCHMARK(BM_LoadYZPlane);
+
+/* range(0) matrices, tightly packed or at the 256 byte stride of dynamic uniform buffers */
+static void benchmarkCopyToDevice(benchmark::State &state, size_t stride) {
+  auto context = getContext();
+  if (!context) {
+    state.SkipWithError("no Vulkan device");
+    return;
+  }
+  size_t count = state.range(0);
+  std::vector<glm::mat4> data(count, glm::mat4(1));
+  VulkanBufferData buffer(context->getPhysicalDevice(), context->getDevice(), count * stride,
+                          vk::BufferUsageFlagBits::eUniformBuffer);
+  for (auto _ : state) {
+    copyToDevice(context->getDevice(), buffer.getMemory(), data.data(), count, stride);
+  }
+  state.SetBytesProcessed(state.iterations() * count * sizeof(glm::mat4));
+}
+
+static void BM_CopyToDevice(benchmark::State &state) {
+  benchmarkCopyToDevice(state, sizeof(glm::mat4));
+}
+BENCHMARK(BM_CopyToDevice)->RangeMultiplier(10)->Range(10, 100000);
+
+static void BM_CopyToDeviceStrided(benchmark::State &state) { benchmarkCopyToDevice(state, 256); }
+BENCHMARK(BM_CopyToDeviceStrided)->RangeMultiplier(10)->Range(10, 100000);
+
+BENCHMARK_MAIN();
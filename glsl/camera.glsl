@@ -0,0 +1,27 @@
+// Camera of the view being rendered, see CameraUBO in uniform_buffers.h. Shaders compiled with
+// -DMULTIVIEW render all views in one pass and read the camera of gl_ViewIndex. Include this
+// before any other declaration since it enables GL_EXT_multiview.
+
+#ifdef MULTIVIEW
+#extension GL_EXT_multiview : require
+
+// one camera per view, gl_ViewIndex is the array layer being rendered
+#define MAX_VIEWS 16
+struct Camera {
+  mat4 viewMatrix;
+  mat4 projectionMatrix;
+  mat4 viewMatrixInverse;
+  mat4 projectionMatrixInverse;
+};
+layout(set = 1, binding = 0) uniform CameraUBO {
+  Camera views[MAX_VIEWS];
+} cameras;
+#define cameraUBO cameras.views[gl_ViewIndex]
+#else
+layout(set = 1, binding = 0) uniform CameraUBO {
+  mat4 viewMatrix;
+  mat4 projectionMatrix;
+  mat4 viewMatrixInverse;
+  mat4 projectionMatrixInverse;
+} cameraUBO;
+#endif
@@ -0,0 +1,11 @@
+#version 450 
+
+layout(input_attachment_index = 0, set = 0, binding = 0) uniform subpassInput lightingInput;
+
+layout(location = 0) in vec2 inUV;
+layout(location = 0) out vec4 outColor;
+
+void main() {
+  outColor = subpassLoad(lightingInput);
+  outColor = pow(outColor, vec4(1/2.2, 1/2.2, 1/2.2, 1));
+}
@@ -0,0 +1,74 @@
+// Converts channels of a render target into a tightly packed buffer, laid out like a
+// download: tiles one after another, the layers of a tile after each other, then rows. Each
+// invocation writes one 32-bit word. The including shader declares inputSampler and defines
+// fetchElement.
+
+layout(local_size_x = 256) in;
+
+// 0: uint8, 1: uint16, 2: uint32, 3: float32
+layout (constant_id = 0) const uint OUTPUT_TYPE = 0;
+layout (constant_id = 1) const bool LINEAR_DEPTH = false;
+layout (constant_id = 2) const bool SRGB = false;
+
+layout(set = 0, binding = 1) writeonly buffer OutputBuffer {
+  uint words[];
+};
+
+// the camera of every tile and layer, tile-major
+layout(set = 0, binding = 2) readonly buffer ProjectionBuffer {
+  mat4 projectionMatrixInverse[];
+};
+
+layout(push_constant) uniform PushConstants {
+  uvec2 tileSize;
+  uint tileColumns;
+  uint layers;
+  uint elementCount;
+  uint channelCount;
+  uint channels; // source channel of output channel i in bits 8i to 8i + 7
+  uint rowLength; // invocations per row of the dispatch
+  float scale;
+} pushConstants;
+
+uint fetchElement(ivec3 texel, uint channel);
+
+ivec3 getTexel(uint pixel) {
+  uint tilePixels = pushConstants.tileSize.x * pushConstants.tileSize.y;
+  uint tile = pixel / (tilePixels * pushConstants.layers);
+  uint rest = pixel % (tilePixels * pushConstants.layers);
+  uint inTile = rest % tilePixels;
+  uvec2 origin =
+      uvec2(tile % pushConstants.tileColumns, tile / pushConstants.tileColumns) *
+      pushConstants.tileSize;
+  return ivec3(origin + uvec2(inTile % pushConstants.tileSize.x,
+                              inTile / pushConstants.tileSize.x),
+               rest / tilePixels);
+}
+
+uint quantize(float value) {
+  value *= pushConstants.scale;
+  if (OUTPUT_TYPE == 3) {
+    return floatBitsToUint(value);
+  }
+  float maxValue = OUTPUT_TYPE == 0 ? 255.0 : OUTPUT_TYPE == 1 ? 65535.0 : 4294967040.0;
+  return uint(clamp(round(value), 0.0, maxValue));
+}
+
+void main() {
+  uint elementsPerWord = OUTPUT_TYPE == 0 ? 4u : OUTPUT_TYPE == 1 ? 2u : 1u;
+  uint bits = 32u / elementsPerWord;
+  uint word = gl_GlobalInvocationID.y * pushConstants.rowLength + gl_GlobalInvocationID.x;
+  uint first = word * elementsPerWord;
+  if (first >= pushConstants.elementCount) {
+    return;
+  }
+
+  uint packed = 0;
+  for (uint i = 0; i < elementsPerWord && first + i < pushConstants.elementCount; ++i) {
+    uint element = first + i;
+    uint channel = (pushConstants.channels >> (8 * (element % pushConstants.channelCount))) & 0xff;
+    uint value = fetchElement(getTexel(element / pushConstants.channelCount), channel);
+    packed |= bits == 32 ? value : value << (bits * i);
+  }
+  words[word] = packed;
+}
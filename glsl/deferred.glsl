@@ -0,0 +1,65 @@
+// Deferred lighting shared by deferred.frag and deferred_subpass.frag. The including shader
+// declares cameraUBO and the G-buffer, and defines FETCH(target) to read a G-buffer target
+// at the current pixel.
+
+layout (constant_id = 0) const bool OCTAHEDRAL_NORMAL = false;
+// read positions from depth instead of the position target
+layout (constant_id = 1) const bool RECONSTRUCT_POSITION = false;
+#include "lighting.glsl"
+
+layout(location = 0) in vec2 inUV;
+layout(location = 0) out vec4 outColor;
+
+vec4 getCameraSpacePosition(vec2 uv) {
+  if (!RECONSTRUCT_POSITION) {
+    return FETCH(position);
+  }
+  float depth = FETCH(depth).x;
+  vec4 csPosition = cameraUBO.projectionMatrixInverse * vec4(uv * 2 - 1, depth, 1);
+  return vec4(csPosition.xyz / csPosition.w, 1);
+}
+
+vec3 getBackgroundColor(vec3 texcoord) {
+  return vec3(1,1,1);
+  // float r = sqrt(texcoord.x * texcoord.x + texcoord.z * texcoord.z);
+  // float angle = atan(texcoord.y / r) * 57.3;
+
+  // vec3 horizonColor = vec3(0.9, 0.9, 0.9);
+  // vec3 zenithColor = vec3(0.522, 0.757, 0.914);
+  // vec3 groundColor = vec3(0.5, 0.410, 0.271);
+  
+  // return mix(mix(zenithColor, horizonColor, smoothstep(15.f, 5.f, angle)),
+  //            groundColor,
+  //            smoothstep(-5.f, -15.f, angle));
+}
+
+void main() {
+  vec3 albedo = FETCH(albedo).xyz;
+  vec3 srm = FETCH(specular).xyz;
+  float F0 = srm.x;
+  float roughness = srm.y;
+  float metallic = srm.z;
+
+  vec3 normal = decodeNormal(FETCH(normal));
+  vec4 csPosition = getCameraSpacePosition(inUV);
+  vec3 camDir = -normalize(csPosition.xyz);
+  vec3 wsPosition = (cameraUBO.viewMatrixInverse * csPosition).xyz;
+
+  vec3 color = shadeScene(csPosition.xyz, wsPosition, camDir, normal, albedo, F0, roughness,
+                          metallic);
+
+  float depth = FETCH(depth).x;
+  if (depth == 1) {
+    outColor = vec4(getBackgroundColor((cameraUBO.viewMatrixInverse * csPosition).xyz), 1.f);
+  } else {
+    outColor = vec4(color, 1);
+  }
+
+  // outColor = vec4(abs(normal), 1);
+  // outColor = vec4(depth, depth, depth, 1);
+  // outColor = vec4(csPosition.xy, 0, 1);
+  // outColor = vec4(wsPosition.xyz, 1);
+  // outColor = vec4(wsNormal, 1);
+  // outColor = vec4(ffnormal, 1);
+  // outColor = vec4(-csPosition.xyz / 6, 1);
+}
@@ -0,0 +1,14 @@
+#version 450 
+#extension GL_GOOGLE_include_directive : require
+
+#include "camera.glsl"
+
+// G-buffer is read from the previous subpass
+layout(input_attachment_index = 0, set = 2, binding = 0) uniform subpassInput albedoInput;
+layout(input_attachment_index = 1, set = 2, binding = 1) uniform subpassInput positionInput;
+layout(input_attachment_index = 2, set = 2, binding = 2) uniform subpassInput specularInput;
+layout(input_attachment_index = 3, set = 2, binding = 3) uniform subpassInput normalInput;
+layout(input_attachment_index = 4, set = 2, binding = 4) uniform subpassInput depthInput;
+
+#define FETCH(target) subpassLoad(target##Input)
+#include "deferred.glsl"
@@ -1,5 +1,8 @@
 #version 450
 
+// store normals as 2-channel octahedral encoding (compact G-buffer)
+layout (constant_id = 0) const bool OCTAHEDRAL_NORMAL = false;
+
 layout(set = 3, binding = 0) uniform MaterialUBO {
   vec4 baseColor;  // rgba
   float specular;
@@ -30,6 +33,19 @@ layout(location = 3) out vec4 outNormal;
 layout(location = 4) out uvec4 outSegmentation;
 layout(location = 5) out vec4 outCustom;
 
+vec2 octWrap(vec2 v) {
+  return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec4 encodeNormal(vec3 n) {
+  if (!OCTAHEDRAL_NORMAL) {
+    return vec4(n, 0);
+  }
+  n /= abs(n.x) + abs(n.y) + abs(n.z);
+  n.xy = n.z >= 0.0 ? n.xy : octWrap(n.xy);
+  return vec4(n.xy, 0, 0);
+}
+
 void main() {
   outCustom = vec4(objectCoord, 1);
   outSegmentation = inSegmentation;
@@ -54,8 +70,8 @@ void main() {
   outSpecular.b = material.metallic;
 
   if (material.hasNormalTexture != 0) {
-    outNormal = vec4(normalize(inTbn * texture(normalTexture, inUV).xyz), 0);
+    outNormal = encodeNormal(normalize(inTbn * texture(normalTexture, inUV).xyz));
   } else {
-    outNormal = vec4(normalize(inTbn * vec3(0, 0, 1)), 0);
+    outNormal = encodeNormal(normalize(inTbn * vec3(0, 0, 1)));
   }
 }
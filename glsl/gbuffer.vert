@@ -1,13 +1,9 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_ARB_shading_language_420pack : enable
+#extension GL_GOOGLE_include_directive : require
 
-layout(binding = 0, set = 1) uniform CameraUBO {
-  mat4 viewMatrix;
-  mat4 projectionMatrix;
-  mat4 viewMatrixInverse;
-  mat4 projectionMatrixInverse;
-} cameraUBO;
+#include "camera.glsl"
 
 layout(binding = 0, set = 2) uniform ObjectUBO {
   mat4 modelMatrix;
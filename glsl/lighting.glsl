@@ -0,0 +1,113 @@
+// Lights and BRDF shared by the lighting shaders, see SceneUBO in uniform_buffers.h. The
+// including shader declares cameraUBO and the OCTAHEDRAL_NORMAL specialization constant.
+// Shading happens in camera space, wsPosition is only used for shadow lookups.
+
+struct PointLight {
+  vec4 position;
+  vec4 emission;
+};
+struct DirectionalLight {
+  vec4 direction;
+  vec4 emission;
+};
+layout(set = 0, binding = 0) uniform SceneUBO {
+  vec4 ambientLight;
+  uint numDirectionalLights;
+  uint numPointLights;
+} sceneUBO;
+layout(std430, set = 0, binding = 1) readonly buffer DirectionalLightBuffer {
+  DirectionalLight directionalLights[];
+};
+layout(std430, set = 0, binding = 2) readonly buffer PointLightBuffer {
+  PointLight pointLights[];
+};
+#include "shadow.glsl"
+
+vec3 decodeNormal(vec4 encoded) {
+  if (!OCTAHEDRAL_NORMAL) {
+    return encoded.xyz;
+  }
+  vec3 n = vec3(encoded.xy, 1.0 - abs(encoded.x) - abs(encoded.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
+float diffuse(vec3 l, vec3 v, vec3 n) {
+  return max(dot(l, n), 0.f) / 3.141592653589793f;
+}
+
+float SmithG1(vec3 v, vec3 normal, float a2) {
+  float dotNV = dot(v, normal);
+  return 2 * dotNV / (dotNV + sqrt(a2 + (1-a2) * dotNV * dotNV));
+}
+
+float SmithGGXMasking(vec3 wi, vec3 wo, vec3 normal, float a2) {
+  return SmithG1(wi, normal, a2) * SmithG1(wo, normal, a2);
+}
+
+float ggx(vec3 wi, vec3 wo, vec3 normal, float roughness, float ks) {
+  float a2 = roughness * roughness;
+  float F0 = ks;
+  if (dot(wi, normal) > 0 && dot(wo, normal) > 0) {
+    vec3 wm = normalize(wi + wo);
+    float dotMN = dot(wm, normal);
+    float F = F0;
+    float G = SmithGGXMasking(wi, wo, normal, a2);
+    float D2 = dotMN * dotMN * (a2 - 1) + 1; D2 = D2 * D2;
+    float D = a2 / (3.141592653589793f * D2);
+    return F * G * D;
+  } else {
+    return 0.f;
+  }
+}
+
+// diffuse, metallic and specular response to light arriving from lightDir
+vec3 brdf(vec3 lightDir, vec3 emission, vec3 camDir, vec3 normal, vec3 albedo, float F0,
+          float roughness, float metallic) {
+  return (1 - metallic) * albedo * emission * diffuse(lightDir, camDir, normal) +
+         metallic * albedo * emission * ggx(lightDir, camDir, normal, roughness, 1.f) +
+         emission * ggx(lightDir, camDir, normal, roughness, F0);
+}
+
+vec3 shadePointLight(uint i, vec3 csPosition, vec3 wsPosition, vec3 camDir, vec3 normal,
+                     vec3 albedo, float F0, float roughness, float metallic) {
+  vec3 pos = (cameraUBO.viewMatrix * vec4(pointLights[i].position.xyz, 1.f)).xyz;
+  vec3 l = pos - csPosition;
+  float d = max(length(l), 0.0001);
+  if (length(l) == 0) {
+    return vec3(0);
+  }
+  vec3 lightDir = normalize(l);
+  vec3 emission = pointLights[i].emission.rgb *
+                  pointShadow(i, wsPosition, pointLights[i].position.xyz);
+  return brdf(lightDir, emission, camDir, normal, albedo, F0, roughness, metallic) / d / d;
+}
+
+vec3 shadeDirectionalLight(uint i, vec3 csPosition, vec3 wsPosition, vec3 camDir, vec3 normal,
+                           vec3 albedo, float F0, float roughness, float metallic) {
+  if (length(directionalLights[i].direction.xyz) == 0) {
+    return vec3(0);
+  }
+  vec3 lightDir = -normalize((cameraUBO.viewMatrix *
+                              vec4(directionalLights[i].direction.xyz, 0)).xyz);
+  vec3 emission = directionalLights[i].emission.rgb *
+                  directionalShadow(i, wsPosition, -csPosition.z);
+  return brdf(lightDir, emission, camDir, normal, albedo, F0, roughness, metallic);
+}
+
+// every light of the scene plus ambient light
+vec3 shadeScene(vec3 csPosition, vec3 wsPosition, vec3 camDir, vec3 normal, vec3 albedo,
+                float F0, float roughness, float metallic) {
+  vec3 color = vec3(0.f);
+  for (uint i = 0; i < sceneUBO.numPointLights; ++i) {
+    color += shadePointLight(i, csPosition, wsPosition, camDir, normal, albedo, F0, roughness,
+                             metallic);
+  }
+  for (uint i = 0; i < sceneUBO.numDirectionalLights; ++i) {
+    color += shadeDirectionalLight(i, csPosition, wsPosition, camDir, normal, albedo, F0,
+                                   roughness, metallic);
+  }
+  return color + sceneUBO.ambientLight.rgb * albedo;
+}
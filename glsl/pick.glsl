@@ -0,0 +1,28 @@
+// Gathers single texels of a render target, one invocation per queried point. The including
+// shader declares inputSampler and defines fetchTexel.
+
+layout(local_size_x = 64) in;
+
+// x, y and layer of the texel, x is negative for points outside the target
+layout(std430, set = 0, binding = 1) readonly buffer PointBuffer {
+  ivec4 points[];
+};
+layout(std430, set = 0, binding = 2) writeonly buffer ValueBuffer {
+  uvec4 values[];
+};
+
+layout(push_constant) uniform PushConstants {
+  uint pointCount;
+  uint outputOffset; // first value written, targets are stored one after another
+} pushConstants;
+
+uvec4 fetchTexel(ivec3 texel);
+
+void main() {
+  uint i = gl_GlobalInvocationID.x;
+  if (i >= pushConstants.pointCount) {
+    return;
+  }
+  ivec4 point = points[i];
+  values[pushConstants.outputOffset + i] = point.x < 0 ? uvec4(0) : fetchTexel(point.xyz);
+}
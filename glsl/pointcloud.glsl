@@ -0,0 +1,135 @@
+// Emits a compacted list of the pixels that hit geometry: x, y, z, then optionally the
+// segmentation id and the sRGB encoded color as RGBA8. Invocations first count their points in
+// shared memory so each workgroup reserves its output range with a single atomic. With a voxel
+// size only the first point to claim a voxel in a hash table is kept. The including shader
+// defines SEGMENTATION to read a segmentation channel.
+
+layout(local_size_x = 16, local_size_y = 16) in;
+
+layout (constant_id = 0) const bool WORLD_SPACE = false;
+layout (constant_id = 1) const bool COLOR = false;
+
+struct Camera {
+  mat4 viewMatrixInverse;
+  mat4 projectionMatrixInverse;
+};
+
+layout(set = 0, binding = 0) uniform sampler2DArray depthSampler;
+layout(set = 0, binding = 1) uniform sampler2DArray colorSampler;
+#ifdef SEGMENTATION
+layout(set = 0, binding = 2) uniform usampler2DArray segmentationSampler;
+#endif
+// one camera per tile and view, views of a tile are adjacent
+layout(std430, set = 0, binding = 3) readonly buffer CameraBuffer {
+  Camera cameras[];
+};
+layout(std430, set = 0, binding = 4) buffer CounterBuffer {
+  uint pointCount;
+  uint voxelTable[];
+};
+layout(std430, set = 0, binding = 5) writeonly buffer PointBuffer {
+  uint points[];
+};
+
+layout(push_constant) uniform PushConstants {
+  uvec2 tileSize;
+  uint tileColumns;
+  uint tileCount;
+  uint layers;
+  uint stride; // words per point
+  uint segmentationChannel;
+  uint voxelTableMask; // table size - 1, 0 without downsampling
+  float voxelSize;
+} pushConstants;
+
+shared uint groupCount;
+shared uint groupBase;
+
+vec3 linearToSrgb(vec3 color) {
+  color = clamp(color, 0.0, 1.0);
+  return mix(color * 12.92, 1.055 * pow(color, vec3(1.0 / 2.4)) - 0.055,
+             greaterThan(color, vec3(0.0031308)));
+}
+
+uint hashVoxel(ivec3 voxel, uint image) {
+  uint h = uint(voxel.x) * 73856093u ^ uint(voxel.y) * 19349663u ^ uint(voxel.z) * 83492791u ^
+           image * 2654435761u;
+  h ^= h >> 16;
+  h *= 0x7feb352du;
+  h ^= h >> 15;
+  return h;
+}
+
+// whether this point is the first one in its voxel
+bool claimVoxel(vec3 position, uint image) {
+  uint key = hashVoxel(ivec3(floor(position / pushConstants.voxelSize)), image);
+  // 0 marks an empty slot
+  key = max(key, 1u);
+  uint slot = key & pushConstants.voxelTableMask;
+  for (uint i = 0; i < 32; ++i) {
+    uint previous = atomicCompSwap(voxelTable[slot], 0u, key);
+    if (previous == 0u) {
+      return true;
+    }
+    if (previous == key) {
+      return false;
+    }
+    slot = (slot + 1) & pushConstants.voxelTableMask;
+  }
+  // crowded table, keep the point
+  return true;
+}
+
+void main() {
+  if (gl_LocalInvocationIndex == 0) {
+    groupCount = 0u;
+  }
+  barrier();
+
+  uvec2 pixel = gl_GlobalInvocationID.xy;
+  uint layer = gl_GlobalInvocationID.z;
+  uvec2 tileCoord = pixel / pushConstants.tileSize;
+  uint tile = tileCoord.y * pushConstants.tileColumns + tileCoord.x;
+  uint image = tile * pushConstants.layers + layer;
+
+  bool valid = tileCoord.x < pushConstants.tileColumns && tile < pushConstants.tileCount;
+  float depth = valid ? texelFetch(depthSampler, ivec3(pixel, layer), 0).x : 1.0;
+  valid = valid && depth < 1.0;
+
+  vec3 position = vec3(0);
+  if (valid) {
+    vec2 uv = (vec2(pixel % pushConstants.tileSize) + 0.5) / vec2(pushConstants.tileSize);
+    vec4 csPosition = cameras[image].projectionMatrixInverse * vec4(uv * 2 - 1, depth, 1);
+    position = csPosition.xyz / csPosition.w;
+    if (WORLD_SPACE) {
+      position = (cameras[image].viewMatrixInverse * vec4(position, 1)).xyz;
+    }
+    if (pushConstants.voxelTableMask != 0) {
+      valid = claimVoxel(position, image);
+    }
+  }
+
+  uint localIndex = valid ? atomicAdd(groupCount, 1u) : 0u;
+  barrier();
+  if (gl_LocalInvocationIndex == 0) {
+    groupBase = atomicAdd(pointCount, groupCount);
+  }
+  barrier();
+  if (!valid) {
+    return;
+  }
+
+  uint offset = (groupBase + localIndex) * pushConstants.stride;
+  points[offset] = floatBitsToUint(position.x);
+  points[offset + 1] = floatBitsToUint(position.y);
+  points[offset + 2] = floatBitsToUint(position.z);
+  offset += 3;
+#ifdef SEGMENTATION
+  points[offset++] =
+      texelFetch(segmentationSampler, ivec3(pixel, layer), 0)[pushConstants.segmentationChannel];
+#endif
+  if (COLOR) {
+    vec4 color = texelFetch(colorSampler, ivec3(pixel, layer), 0);
+    points[offset] = packUnorm4x8(vec4(linearToSrgb(color.rgb), color.a));
+  }
+}
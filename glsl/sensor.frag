@@ -0,0 +1,10 @@
+#version 450
+
+layout(location = 0) in vec2 inUV;
+layout(location = 1) in flat uvec4 inSegmentation;
+
+layout(location = 0) out uvec4 outSegmentation;
+
+void main() {
+  outSegmentation = inSegmentation;
+}
@@ -0,0 +1,30 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+layout(binding = 0, set = 1) uniform CameraUBO {
+  mat4 viewMatrix;
+  mat4 projectionMatrix;
+  mat4 viewMatrixInverse;
+  mat4 projectionMatrixInverse;
+} cameraUBO;
+
+layout(binding = 0, set = 2) uniform ObjectUBO {
+  mat4 modelMatrix;
+  uvec4 segmentation;
+  mat4 userData;
+} objectUBO;
+
+layout(location = 0) in vec3 pos;
+layout(location = 2) in vec2 uv;
+
+layout(location = 0) out vec2 outUV;
+layout(location = 1) out flat uvec4 outSegmentation;
+
+void main() {
+  outSegmentation = objectUBO.segmentation;
+  outUV = uv;
+
+  mat4 modelView = cameraUBO.viewMatrix * objectUBO.modelMatrix;
+  gl_Position = cameraUBO.projectionMatrix * (modelView * vec4(pos, 1));
+}
@@ -0,0 +1,30 @@
+#version 450
+
+layout(set = 3, binding = 0) uniform MaterialUBO {
+  vec4 baseColor;  // rgba
+  float specular;
+  float roughness;
+  float metallic;
+  float transparency;
+  int hasColorTexture;
+  int hasSpecularTexture;
+  int hasNormalTexture;
+  int hasHeightTexture;
+} material;
+
+layout(set = 3, binding = 1) uniform sampler2D colorTexture;
+
+layout(location = 0) in vec2 inUV;
+layout(location = 1) in flat uvec4 inSegmentation;
+
+layout(location = 0) out uvec4 outSegmentation;
+
+// same alpha test as the G-buffer and transparency shaders
+void main() {
+  float alpha = material.hasColorTexture != 0 ? texture(colorTexture, inUV).a
+                                              : material.baseColor.a;
+  if (alpha * (1 - material.transparency) <= 0) {
+    discard;
+  }
+  outSegmentation = inSegmentation;
+}
@@ -0,0 +1,57 @@
+// Shadow lookups shared by the lighting shaders, see ShadowUBO in uniform_buffers.h.
+// Layers [0, numCascades) hold the cascades of directional light 0, followed by 6 faces for
+// each of the first numPointLightShadows point lights.
+
+#define MAX_SHADOW_LAYERS 28
+
+layout(set = 0, binding = 3) uniform ShadowUBO {
+  mat4 lightMatrices[MAX_SHADOW_LAYERS];
+  vec4 cascadeSplits;
+  uint numCascades;
+  uint numPointLightShadows;
+  float texelSize;
+} shadowUBO;
+layout(set = 0, binding = 4) uniform sampler2DArrayShadow shadowMaps;
+
+// 3x3 percentage closer filtering, 1 when lit
+float sampleShadow(uint layer, vec3 wsPosition) {
+  vec4 p = shadowUBO.lightMatrices[layer] * vec4(wsPosition, 1);
+  vec3 ndc = p.xyz / p.w;
+  vec2 uv = ndc.xy * 0.5 + 0.5;
+  if (any(lessThan(uv, vec2(0))) || any(greaterThan(uv, vec2(1))) || ndc.z < 0 || ndc.z > 1) {
+    return 1.0;
+  }
+  float lit = 0;
+  for (int x = -1; x <= 1; ++x) {
+    for (int y = -1; y <= 1; ++y) {
+      // explicit gradients so this also works in compute shaders
+      lit += textureGrad(shadowMaps, vec4(uv + vec2(x, y) * shadowUBO.texelSize, layer, ndc.z),
+                         vec2(0), vec2(0));
+    }
+  }
+  return lit / 9.0;
+}
+
+float directionalShadow(uint lightIndex, vec3 wsPosition, float viewDepth) {
+  if (lightIndex != 0) {
+    return 1.0;
+  }
+  for (uint c = 0; c < shadowUBO.numCascades; ++c) {
+    if (viewDepth <= shadowUBO.cascadeSplits[c]) {
+      return sampleShadow(c, wsPosition);
+    }
+  }
+  return 1.0;
+}
+
+float pointShadow(uint lightIndex, vec3 wsPosition, vec3 lightPosition) {
+  if (lightIndex >= shadowUBO.numPointLightShadows) {
+    return 1.0;
+  }
+  vec3 d = wsPosition - lightPosition;
+  vec3 a = abs(d);
+  uint face = a.x >= a.y && a.x >= a.z ? (d.x > 0 ? 0 : 1)
+            : a.y >= a.z               ? (d.y > 0 ? 2 : 3)
+                                       : (d.z > 0 ? 4 : 5);
+  return sampleShadow(shadowUBO.numCascades + 6 * lightIndex + face, wsPosition);
+}
@@ -0,0 +1,17 @@
+#version 450
+
+layout(binding = 0, set = 0) uniform ObjectUBO {
+  mat4 modelMatrix;
+  uvec4 segmentation;
+  mat4 userData;
+} objectUBO;
+
+layout(push_constant) uniform PushConstants {
+  mat4 lightMatrix;
+} pushConstants;
+
+layout(location = 0) in vec3 pos;
+
+void main() {
+  gl_Position = pushConstants.lightMatrix * objectUBO.modelMatrix * vec4(pos, 1.f);
+}
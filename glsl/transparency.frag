@@ -1,4 +1,7 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "camera.glsl"
 
 //=== geometry resources ===//
 
@@ -38,64 +41,21 @@ layout(push_constant) uniform PushConstants {
   float visibility;
 } pushConstants;
 
-layout(binding = 0, set = 1) uniform CameraUBO {
-  mat4 viewMatrix;
-  mat4 projectionMatrix;
-  mat4 viewMatrixInverse;
-  mat4 projectionMatrixInverse;
-} cameraUBO;
-
-layout (constant_id = 0) const uint NUM_DIRECTIONAL_LIGHTS = 3;
-layout (constant_id = 1) const uint NUM_POINT_LIGHTS = 10;
-
-struct PointLight {
-  vec4 position;
-  vec4 emission;
-};
-
-struct DirectionalLight {
-  vec4 direction;
-  vec4 emission;
-};
-
-layout(set = 0, binding = 0) uniform SceneUBO {
-  vec4 ambientLight;
-  DirectionalLight directionalLights[NUM_DIRECTIONAL_LIGHTS];
-  PointLight pointLights[NUM_POINT_LIGHTS];
-} sceneUBO;
-
-vec4 world2camera(vec4 pos) {
-  return cameraUBO.viewMatrix * pos;
-}
-
-float diffuse(vec3 l, vec3 v, vec3 n) {
-  return max(dot(l, n), 0.f) / 3.141592653589793f;
-}
+layout (constant_id = 0) const bool OCTAHEDRAL_NORMAL = false;
 
-float SmithG1(vec3 v, vec3 normal, float a2) {
-  float dotNV = dot(v, normal);
-  return 2 * dotNV / (dotNV + sqrt(a2 + (1-a2) * dotNV * dotNV));
-}
+#include "lighting.glsl"
 
-float SmithGGXMasking(vec3 wi, vec3 wo, vec3 normal, float a2) {
-  return SmithG1(wi, normal, a2) * SmithG1(wo, normal, a2);
+vec2 octWrap(vec2 v) {
+  return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
 }
 
-float ggx(vec3 wi, vec3 wo, vec3 normal, float roughness, float ks) {
-  float a2 = roughness * roughness;
-  float F0 = ks;
-  if (dot(wi, normal) > 0 && dot(wo, normal) > 0) {
-    vec3 wm = normalize(wi + wo);
-    float dotMN = dot(wm, normal);
-    // float F = fresnel_schlick(dot(wi, wm), 5.f, F0, 1);
-    float F = F0;
-    float G = SmithGGXMasking(wi, wo, normal, a2);
-    float D2 = dotMN * dotMN * (a2 - 1) + 1; D2 = D2 * D2;
-    float D = a2 / (3.141592653589793f * D2);
-    return F * G * D;
-  } else {
-    return 0.f;
+vec4 encodeNormal(vec3 n) {
+  if (!OCTAHEDRAL_NORMAL) {
+    return vec4(n, 0);
   }
+  n /= abs(n.x) + abs(n.y) + abs(n.z);
+  n.xy = n.z >= 0.0 ? n.xy : octWrap(n.xy);
+  return vec4(n.xy, 0, 0);
 }
 
 
@@ -122,11 +82,13 @@ void main() {
   outSpecular.g = material.roughness;
   outSpecular.b = material.metallic;
 
+  vec3 normal;
   if (material.hasNormalTexture != 0) {
-    outNormal = vec4(normalize(inTbn * texture(normalTexture, inUV).xyz), 0);
+    normal = normalize(inTbn * texture(normalTexture, inUV).xyz);
   } else {
-    outNormal = vec4(normalize(inTbn * vec3(0, 0, 1)), 0);
+    normal = normalize(inTbn * vec3(0, 0, 1));
   }
+  outNormal = encodeNormal(normal);
 
   vec3 albedo = outAlbedo.rgb;
   vec3 srm = outSpecular.xyz;
@@ -134,58 +96,11 @@ void main() {
   float roughness = srm.y;
   float metallic = srm.z;
 
-  vec3 normal = outNormal.xyz;
   vec4 csPosition = outPosition;
   vec3 camDir = -normalize(csPosition.xyz);
+  vec3 wsPosition = (cameraUBO.viewMatrixInverse * csPosition).xyz;
 
-  vec3 color = vec3(0.f);
-
-  for (int i = 0; i < NUM_POINT_LIGHTS; i++) {
-    vec3 pos = world2camera(vec4(sceneUBO.pointLights[i].position.xyz, 1.f)).xyz;
-    vec3 l = pos - csPosition.xyz;
-    float d = max(length(l), 0.0001);
-
-    if (length(l) == 0) {
-      continue;
-    }
-
-    vec3 lightDir = normalize(l);
-
-    // diffuse
-    color += (1 - metallic) * albedo * sceneUBO.pointLights[i].emission.rgb *
-             diffuse(lightDir, camDir, normal) / d / d;
-
-    // metallic
-    color += metallic * albedo * sceneUBO.pointLights[i].emission.rgb *
-             ggx(lightDir, camDir, normal, roughness, 1.f) / d / d;
-
-    // specular
-    color += sceneUBO.pointLights[i].emission.rgb * ggx(lightDir, camDir, normal, roughness, F0) / d / d;
-  }
-
-  for (int i = 0; i < NUM_DIRECTIONAL_LIGHTS; ++i) {
-    if (length(sceneUBO.directionalLights[i].direction.xyz) == 0) {
-      continue;
-    }
-
-    vec3 lightDir = -normalize((cameraUBO.viewMatrix *
-                                vec4(sceneUBO.directionalLights[i].direction.xyz, 0)).xyz);
-
-    // diffuse
-    color += (1 - metallic) * albedo * sceneUBO.directionalLights[i].emission.rgb *
-             diffuse(lightDir, camDir, normal);
-
-    color += (1 - metallic) * albedo * sceneUBO.directionalLights[i].emission.rgb *
-             diffuse(lightDir, camDir, normal);
-
-    // metallic
-    color += metallic * albedo * sceneUBO.directionalLights[i].emission.rgb *
-             ggx(lightDir, camDir, normal, roughness, 1.f);
-
-    // specular
-    color += sceneUBO.directionalLights[i].emission.rgb * ggx(lightDir, camDir, normal, roughness, F0);
-  }
-
-  color += sceneUBO.ambientLight.rgb * albedo;
+  vec3 color = shadeScene(csPosition.xyz, wsPosition, camDir, normal, albedo, F0, roughness,
+                          metallic);
   outLighting = vec4(color, finalAlpha);
 }
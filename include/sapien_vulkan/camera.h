@@ -19,6 +19,7 @@ struct Camera {
   vk::Device mDevice;
   VulkanBufferData mUBO;
   vk::UniqueDescriptorSet mDescriptorSet;
+  DescriptorSetRecord mDescriptorSetRecord;
 
   Camera(vk::PhysicalDevice physicalDevice, vk::Device device, vk::DescriptorPool descriptorPool,
          vk::DescriptorSetLayout descriptorLayout);
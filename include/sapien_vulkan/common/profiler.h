@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Scoped CPU timers. Scopes are recorded into a ring buffer of the calling thread while the
+ * profiler is enabled at runtime; disabled, a scope costs one relaxed atomic load. Building
+ * without SVULKAN_PROFILER removes the scopes entirely. Names must be string literals. */
+#ifdef SVULKAN_PROFILER
+#define SVULKAN_PROFILE_CONCAT_(a, b) a##b
+#define SVULKAN_PROFILE_CONCAT(a, b) SVULKAN_PROFILE_CONCAT_(a, b)
+#define SVULKAN_PROFILE_SCOPE(name)                                                             \
+  ::svulkan::profiler::Scope SVULKAN_PROFILE_CONCAT(svulkanProfileScope, __LINE__)(name)
+#define SVULKAN_PROFILE_FUNCTION() SVULKAN_PROFILE_SCOPE(__func__)
+#else
+#define SVULKAN_PROFILE_SCOPE(name)
+#define SVULKAN_PROFILE_FUNCTION()
+#endif
+
+namespace svulkan {
+namespace profiler {
+
+extern std::atomic<bool> gEnabled;
+
+inline bool isEnabled() { return gEnabled.load(std::memory_order_relaxed); }
+void setEnabled(bool enabled);
+
+/** nanoseconds on the steady clock, the time base of every event */
+int64_t now();
+
+/** name shown for the calling thread in traces */
+void setThreadName(std::string const &name);
+
+/** Events kept per thread; older events are overwritten. Applies to threads that record their
+ *  first event afterwards. */
+void setThreadCapacity(uint32_t capacity);
+
+/** record a finished scope of the calling thread, name must outlive the profiler */
+void record(char const *name, int64_t begin, int64_t end);
+
+/** Record an event on a named track that is not a thread, such as the GPU queue. Names are
+ *  copied. */
+void recordTrack(std::string const &track, std::string const &name, int64_t begin,
+                 int64_t end);
+
+/** drop all recorded events, keeping thread names */
+void clear();
+
+/** recorded scopes of all threads with the same name, tracks excluded */
+struct ScopeSummary {
+  std::string name;
+  uint64_t count{0};
+  double totalMilliseconds{0};
+  double maxMilliseconds{0};
+};
+/** summaries in order of decreasing total time */
+std::vector<ScopeSummary> summarize();
+
+/** Chrome trace event JSON of the recorded events, loadable by chrome://tracing and Perfetto */
+std::string exportChromeTrace();
+/** write exportChromeTrace to a file, false on failure */
+bool writeChromeTrace(std::string const &filename);
+
+class Scope {
+  char const *mName;
+  int64_t mBegin;
+
+public:
+  inline explicit Scope(char const *name) : mName(isEnabled() ? name : nullptr) {
+    if (mName) {
+      mBegin = now();
+    }
+  }
+  inline ~Scope() {
+    if (mName) {
+      record(mName, mBegin, now());
+    }
+  }
+
+  Scope(Scope const &other) = delete;
+  Scope &operator=(Scope const &other) = delete;
+};
+
+} // namespace profiler
+} // namespace svulkan
@@ -0,0 +1,94 @@
+#pragma once
+#include "internal/vulkan_readback.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <string>
+#include <thread>
+
+namespace svulkan {
+
+enum class ImageEncoding {
+  ePng, // 8 or 16 bit
+  eHdr, // Radiance RGBE, float data
+  eRaw  // converted data as is, no header
+};
+
+enum class ImageConversion {
+  eAuto,   // PNG: palette for integer targets, 16 bit for single channel floats (depth), 8 bit
+           // for other floats, 8 and 16 bit data as is; raw: the source data unchanged
+  eUint8,  // floats in [0, 1] to the full range, integers saturated
+  eUint16, // floats in [0, 1] to the full range, integers saturated
+  ePalette // integer ids to RGB colors, 0 is black
+};
+
+/** One image of a downloaded frame to encode and write */
+struct FrameImage {
+  uint32_t target{0}; // index into the downloaded targets
+  uint32_t image{0};  // tile * views + view, see VulkanRenderer::downloadTargets
+  std::string filename;
+  ImageEncoding encoding{ImageEncoding::ePng};
+  ImageConversion conversion{ImageConversion::eAuto};
+  uint32_t channels{0}; // leading channels to keep, 0 for all; one channel for palettes
+  uint32_t channel{0};  // source channel of palettes and integer conversions
+  float scale{1.f};     // float values are multiplied before conversion
+};
+
+/** Converts and encodes downloaded frames on worker threads. A frame keeps its staging buffer
+ *  until every image of it is written, so no copy is made on the calling thread. At most
+ *  maxPendingFrames frames are in flight: write waits for one to finish, tryWrite refuses the
+ *  frame instead. Failed writes are logged and counted. */
+class FrameWriter {
+  struct Frame {
+    VulkanDownloadedTargets targets;
+    vk::Extent2D extent;
+    std::atomic<uint32_t> remaining;
+
+    Frame(VulkanDownloadedTargets targets, vk::Extent2D extent, uint32_t imageCount)
+        : targets(std::move(targets)), extent(extent), remaining(imageCount) {}
+  };
+  struct Job {
+    std::shared_ptr<Frame> frame;
+    FrameImage image;
+  };
+
+  uint32_t mMaxPendingFrames;
+  std::vector<std::thread> mWorkers;
+
+  std::mutex mMutex;
+  std::condition_variable mJobAvailable;
+  std::condition_variable mFrameDone;
+  std::deque<Job> mJobs;
+  uint32_t mPendingFrames{0};
+  bool mStopping{false};
+  std::atomic<uint32_t> mFailureCount{0};
+
+  void work();
+  void writeImage(Frame const &frame, FrameImage const &image);
+  void enqueue(VulkanDownloadedTargets targets, vk::Extent2D extent,
+               std::vector<FrameImage> images);
+
+public:
+  /** threadCount 0 uses all but one hardware thread */
+  FrameWriter(uint32_t threadCount = 0, uint32_t maxPendingFrames = 4);
+  /** waits for all frames to be written */
+  ~FrameWriter();
+
+  FrameWriter(FrameWriter const &other) = delete;
+  FrameWriter &operator=(FrameWriter const &other) = delete;
+
+  /** Queue images of targets, each extent sized. Images are validated here and throw before
+   *  anything is queued. Waits while maxPendingFrames frames are in flight. */
+  void write(VulkanDownloadedTargets targets, vk::Extent2D extent,
+             std::vector<FrameImage> images);
+  /** write without waiting, false if the frame was not queued and targets is left untouched */
+  bool tryWrite(VulkanDownloadedTargets &targets, vk::Extent2D extent,
+                std::vector<FrameImage> images);
+
+  /** wait until every queued frame is written */
+  void flush();
+  uint32_t getPendingFrames();
+  inline uint32_t getFailureCount() const { return mFailureCount; }
+};
+
+} // namespace svulkan
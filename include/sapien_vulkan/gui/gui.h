@@ -6,6 +6,8 @@
 #include <vector>
 #include <vulkan/vulkan.hpp>
 #include "sapien_vulkan/common/log.h"
+#include "sapien_vulkan/internal/vulkan_pass_timer.h"
+#include "sapien_vulkan/internal/vulkan_render_stats.h"
 
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
@@ -147,6 +149,10 @@ class VulkanWindow {
   void recreateImguiResources(); 
 };
 
+/** ImGui window listing pass timings, call between ImGui::NewFrame and ImGui::Render */
+void drawPassTimings(std::vector<PassTiming> const &timings);
+void drawRenderStats(RenderStats const &stats);
+
 }
 
 #endif
@@ -1,4 +1,5 @@
 #pragma once
+#include "vulkan_memory.h"
 #include "vulkan_util.h"
 
 namespace svulkan {
@@ -6,6 +7,7 @@ namespace svulkan {
 struct VulkanBufferData {
   vk::UniqueBuffer mBuffer;
   vk::UniqueDeviceMemory mMemory;
+  MemoryRecord mMemoryRecord;
 
   VulkanBufferData(
       vk::PhysicalDevice physicalDevice, vk::Device device, vk::DeviceSize size,
@@ -15,6 +17,7 @@ struct VulkanBufferData {
 
   inline vk::Buffer getBuffer() const { return mBuffer.get(); }
   inline vk::DeviceMemory getMemory() const { return mMemory.get(); }
+  inline uint64_t getAllocationSize() const { return mMemoryRecord.getBytes(); }
 
   /** Upload data to Vulkan buffer */
   template <typename DataType> void upload(vk::Device device, DataType const &data) const {
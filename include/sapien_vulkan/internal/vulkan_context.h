@@ -32,11 +32,29 @@ class VulkanContext {
 
   uint32_t graphicsQueueFamilyIndex;
 
-  VulkanResourcesManager mResourcesManager;
+  // 0 when the device does not support multiview
+  uint32_t mMaxMultiviewViewCount{0};
+  bool mPipelineStatisticsQuery{false};
+  bool mMemoryBudget{false}; // VK_EXT_memory_budget is enabled
+  uint32_t mMaxDescriptorSets{0};
+
+  // VK_EXT_debug_utils entry points, null when the instance does not expose the extension
+  PFN_vkSetDebugUtilsObjectNameEXT mSetDebugUtilsObjectName{};
+  PFN_vkCmdBeginDebugUtilsLabelEXT mCmdBeginDebugUtilsLabel{};
+  PFN_vkCmdEndDebugUtilsLabelEXT mCmdEndDebugUtilsLabel{};
+  bool mDebugUtils{false};
 
+  VulkanResourcesManager mResourcesManager;
 
 public:
-  VulkanContext(bool requirePresent = true, uint32_t objectBufferSize = 1000);
+  /** Without requirePresent no window system is touched: GLFW is not initialized and devices
+   *  are not checked for surface support, builds without ON_SCREEN are always headless.
+   *
+   *  device selects the physical device by its index in enumeration order, its UUID (32 hex
+   *  digits, dashes ignored) or a case insensitive part of its name, e.g. "llvmpipe" for the
+   *  lavapipe software rasterizer. Empty picks the first compatible device. */
+  VulkanContext(bool requirePresent = true, uint32_t objectBufferSize = 1000,
+                std::string const &device = "");
   ~VulkanContext();
 
   /** Get the graphics queue */
@@ -48,6 +66,29 @@ public:
   inline vk::PhysicalDevice getPhysicalDevice() const { return mPhysicalDevice; }
   inline vk::CommandPool getCommandPool() const { return mCommandPool.get(); }
   inline vk::DescriptorPool getDescriptorPool() const { return mDescriptorPool.get(); }
+  inline uint32_t getMaxMultiviewViewCount() const { return mMaxMultiviewViewCount; }
+  inline bool supportsPipelineStatistics() const { return mPipelineStatisticsQuery; }
+
+  /** Current and peak device memory of buffers and images created on this device, by
+   *  category, descriptor sets in use and, with VK_EXT_memory_budget, the heap budgets */
+  MemoryStats getMemoryStats() const;
+  /** device memory of every cached model and texture file, largest first */
+  std::vector<FileMemoryUsage> getFileMemoryUsage() const;
+
+  /** Object names and command buffer labels of VK_EXT_debug_utils, shown by frame debuggers and
+   *  GPU profilers. They are on whenever the instance exposes the extension; disabling them
+   *  leaves a single branch per call. Objects created while disabled stay unnamed. */
+  inline bool isDebugUtilsEnabled() const { return mDebugUtils; }
+  void setDebugUtilsEnabled(bool enabled);
+
+  void setDebugName(vk::ObjectType type, uint64_t handle, std::string const &name) const;
+  void setDebugName(vk::Image image, std::string const &name) const;
+  void setDebugName(vk::Buffer buffer, std::string const &name) const;
+  void setDebugName(vk::DescriptorSet set, std::string const &name) const;
+
+  /** open a labelled region of commandBuffer, regions nest and must be closed in order */
+  void beginDebugLabel(vk::CommandBuffer commandBuffer, char const *name) const;
+  void endDebugLabel(vk::CommandBuffer commandBuffer) const;
 
 private:
 #ifdef VK_VALIDATION
@@ -57,8 +98,8 @@ private:
   /** Create Vulkan instance */
   void createInstance();
 
-  /** Choose physical device */
-  void pickPhysicalDevice();
+  /** Choose physical device, see the constructor for device */
+  void pickPhysicalDevice(std::string const &selector);
 
   /** Create logical device */
   void createLogicalDevice();
@@ -9,17 +9,34 @@ struct VulkanImageData {
   vk::Format mFormat;
   vk::UniqueImage mImage;
   vk::UniqueDeviceMemory mMemory;
+  MemoryRecord mMemoryRecord;
   vk::UniqueImageView mImageView;
+  // 2D array view of single layer render targets, see createArrayImageView
+  vk::UniqueImageView mArrayImageView;
   vk::Extent2D mExtent;
   uint32_t mMipLevels;
+  uint32_t mArrayLayers;
 
   vk::MemoryPropertyFlags mMemoryProperties;
 
   VulkanImageData(vk::PhysicalDevice physicalDevice, vk::Device device, vk::Format format,
                   vk::Extent2D const &extent, uint32_t mipLevels, vk::ImageTiling tiling,
                   vk::ImageUsageFlags usage, vk::ImageLayout initialLayout,
-                  vk::MemoryPropertyFlags memoryProperties, vk::ImageAspectFlags aspectMask);
+                  vk::MemoryPropertyFlags memoryProperties, vk::ImageAspectFlags aspectMask,
+                  uint32_t arrayLayers = 1);
 
+  inline uint64_t getAllocationSize() const { return mMemoryRecord.getBytes(); }
+
+  /** Add a 2D array view to a sampled single layer image, for compute shaders that read any
+   *  render target as an array. Array images already have one. */
+  void createArrayImageView(vk::Device device);
+
+  inline vk::ImageView getArrayImageView() const {
+    return mArrayImageView ? mArrayImageView.get() : mImageView.get();
+  }
+
+  /** Read a single texel with its own submission, VulkanRenderer::queryPixels gathers many
+   *  points at once */
   template <typename DataType>
   std::vector<DataType> downloadPixel(vk::PhysicalDevice physicalDevice, vk::Device device,
                                       vk::CommandPool commandPool, vk::Queue queue, int x,
@@ -33,20 +50,12 @@ struct VulkanImageData {
     vk::AccessFlags sourceAccessFlag2;
     vk::PipelineStageFlags sourceStage;
     vk::ImageAspectFlags aspect = vk::ImageAspectFlagBits::eColor;
-    uint32_t pixelSize;
-
-    // only support float/int textures
-    static_assert(sizeof(DataType) == 4);
+    uint32_t pixelSize = getFormatSize(mFormat);
+    if (pixelSize == 0 || pixelSize % sizeof(DataType) != 0) {
+      throw std::runtime_error("This image format does not support download");
+    }
 
-    if (mFormat == vk::Format::eR32G32B32A32Sfloat) {
-      sourceLayout = vk::ImageLayout::eColorAttachmentOptimal;
-      sourceAccessFlag1 = vk::AccessFlagBits::eColorAttachmentWrite;
-      sourceAccessFlag2 =
-          vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eColorAttachmentRead;
-      sourceStage = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-      aspect = vk::ImageAspectFlagBits::eColor;
-      pixelSize = 16;
-    } else if (mFormat == vk::Format::eD32Sfloat) {
+    if (isDepthFormat(mFormat)) {
       sourceLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
       sourceAccessFlag1 = vk::AccessFlagBits::eDepthStencilAttachmentWrite;
       sourceAccessFlag2 = vk::AccessFlagBits::eDepthStencilAttachmentWrite |
@@ -54,17 +63,13 @@ struct VulkanImageData {
       sourceStage = vk::PipelineStageFlagBits::eEarlyFragmentTests |
                     vk::PipelineStageFlagBits::eLateFragmentTests;
       aspect = vk::ImageAspectFlagBits::eDepth;
-      pixelSize = 4;
-    } else if (mFormat == vk::Format::eR32G32B32A32Uint) {
+    } else {
       sourceLayout = vk::ImageLayout::eColorAttachmentOptimal;
       sourceAccessFlag1 = vk::AccessFlagBits::eColorAttachmentWrite;
       sourceAccessFlag2 =
           vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eColorAttachmentRead;
       sourceStage = vk::PipelineStageFlagBits::eColorAttachmentOutput;
       aspect = vk::ImageAspectFlagBits::eColor;
-      pixelSize = 16;
-    } else {
-      throw std::runtime_error("This image format does not support download");
     }
 
     // TODO: handle host visible texture
@@ -96,41 +101,32 @@ struct VulkanImageData {
     return output;
   }
 
+  /** Regions copying size bytes into a buffer at offset. With a tile extent the image is
+   *  treated as a row-major grid of tiles and the first tiles that fit in size are copied one
+   *  after another, all layers of a tile tightly packed. */
+  std::vector<vk::BufferImageCopy> getDownloadRegions(vk::DeviceSize offset, size_t size,
+                                                      vk::Extent2D tile = {}) const;
+
+  /** Barrier between the attachment layout downloads start from and layout, accessed with
+   *  access; stages are the attachment stages that write the image */
+  vk::ImageMemoryBarrier getAttachmentBarrier(vk::ImageLayout layout, vk::AccessFlags access,
+                                              bool fromAttachment) const;
+  /** getAttachmentBarrier for TransferSrcOptimal */
+  vk::ImageMemoryBarrier getDownloadBarrier(bool toTransfer) const;
+  vk::PipelineStageFlags getAttachmentStages() const;
+
+  /** Record a copy of size bytes into buffer at offset, see getDownloadRegions. The image is
+   *  expected in its attachment layout and is returned to it. */
+  void recordDownload(vk::CommandBuffer commandBuffer, vk::Buffer buffer,
+                      vk::DeviceSize offset, size_t size, vk::Extent2D tile = {}) const;
+
+  /** Download size bytes, see recordDownload for tiles */
   template <typename DataType>
   std::vector<DataType> download(vk::PhysicalDevice physicalDevice, vk::Device device,
-                                 vk::CommandPool commandPool, vk::Queue queue, size_t size) const {
-    vk::ImageLayout sourceLayout;
-    vk::AccessFlags sourceAccessFlag1;
-    vk::AccessFlags sourceAccessFlag2;
-    vk::PipelineStageFlags sourceStage;
-    vk::ImageAspectFlags aspect = vk::ImageAspectFlagBits::eColor;
-
-    // only support float/int textures
-    static_assert(sizeof(DataType) == 4);
-
-    if (mFormat == vk::Format::eR32G32B32A32Sfloat) {
-      sourceLayout = vk::ImageLayout::eColorAttachmentOptimal;
-      sourceAccessFlag1 = vk::AccessFlagBits::eColorAttachmentWrite;
-      sourceAccessFlag2 =
-          vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eColorAttachmentRead;
-      sourceStage = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-      aspect = vk::ImageAspectFlagBits::eColor;
-    } else if (mFormat == vk::Format::eD32Sfloat) {
-      sourceLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
-      sourceAccessFlag1 = vk::AccessFlagBits::eDepthStencilAttachmentWrite;
-      sourceAccessFlag2 = vk::AccessFlagBits::eDepthStencilAttachmentWrite |
-                          vk::AccessFlagBits::eDepthStencilAttachmentRead;
-      sourceStage = vk::PipelineStageFlagBits::eEarlyFragmentTests |
-                    vk::PipelineStageFlagBits::eLateFragmentTests;
-      aspect = vk::ImageAspectFlagBits::eDepth;
-    } else if (mFormat == vk::Format::eR32G32B32A32Uint) {
-      sourceLayout = vk::ImageLayout::eColorAttachmentOptimal;
-      sourceAccessFlag1 = vk::AccessFlagBits::eColorAttachmentWrite;
-      sourceAccessFlag2 =
-          vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eColorAttachmentRead;
-      sourceStage = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-      aspect = vk::ImageAspectFlagBits::eColor;
-    } else {
+                                 vk::CommandPool commandPool, vk::Queue queue, size_t size,
+                                 vk::Extent2D tile = {}) const {
+    uint32_t pixelSize = getFormatSize(mFormat);
+    if (pixelSize == 0 || pixelSize % sizeof(DataType) != 0) {
       throw std::runtime_error("This image format does not support download");
     }
 
@@ -144,18 +140,7 @@ struct VulkanImageData {
 
       // copy image to buffer
       OneTimeSubmit(device, commandPool, queue, [&](vk::CommandBuffer commandBuffer) {
-        transitionImageLayout(commandBuffer, mImage.get(), mFormat, sourceLayout,
-                              vk::ImageLayout::eTransferSrcOptimal, sourceAccessFlag1,
-                              vk::AccessFlagBits::eTransferRead, sourceStage,
-                              vk::PipelineStageFlagBits::eTransfer, aspect, mMipLevels);
-        vk::BufferImageCopy copyRegion(0, mExtent.width, mExtent.height, {aspect, 0, 0, 1},
-                                       {0, 0, 0}, vk::Extent3D(mExtent, 1));
-        commandBuffer.copyImageToBuffer(mImage.get(), vk::ImageLayout::eTransferSrcOptimal,
-                                        stagingBuffer.getBuffer(), copyRegion);
-        transitionImageLayout(
-            commandBuffer, mImage.get(), mFormat, vk::ImageLayout::eTransferSrcOptimal,
-            sourceLayout, vk::AccessFlagBits::eTransferRead, sourceAccessFlag2,
-            vk::PipelineStageFlagBits::eTransfer, sourceStage, aspect, mMipLevels);
+        recordDownload(commandBuffer, stagingBuffer.getBuffer(), 0, size, tile);
       });
 
       // copy buffer to host memory
@@ -166,6 +151,8 @@ struct VulkanImageData {
       device.unmapMemory(stagingBuffer.getMemory());
 
     } else {
+      vk::ImageAspectFlags aspect = isDepthFormat(mFormat) ? vk::ImageAspectFlagBits::eDepth
+                                                           : vk::ImageAspectFlagBits::eColor;
       vk::ImageSubresource subResource(aspect, 0, 0);
       vk::SubresourceLayout subresourceLayout =
           device.getImageSubresourceLayout(mImage.get(), subResource);
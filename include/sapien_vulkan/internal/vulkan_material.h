@@ -11,6 +11,7 @@ class VulkanMaterial {
   vk::Device mDevice;
   VulkanBufferData mUBO;
   vk::UniqueDescriptorSet mDescriptorSet;
+  DescriptorSetRecord mDescriptorSetRecord;
 
   std::shared_ptr<VulkanTextureData> mDiffuseMap;
   std::shared_ptr<VulkanTextureData> mSpecularMap;
@@ -38,6 +39,10 @@ public:
   inline auto getHeightTexture() const { return mHeightMap; };
 
   inline vk::DescriptorSet getDescriptorSet() const { return mDescriptorSet.get(); }
+  inline vk::Buffer getUniformBuffer() const { return mUBO.getBuffer(); }
+
+  /** true if the shaders may discard fragments of this material */
+  bool isAlphaTested() const;
 };
 
 } // namespace svulkan
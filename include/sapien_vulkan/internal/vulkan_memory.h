@@ -0,0 +1,116 @@
+#pragma once
+#include <array>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace svulkan {
+
+/** What a device memory allocation holds, derived from the buffer or image usage */
+enum class MemoryCategory : uint32_t {
+  eMeshVertex,
+  eMeshIndex,
+  eTexture,
+  eRenderTarget, // attachments, including shadow maps
+  eUniform,
+  eStorage, // storage buffers of lights and compute passes
+  eStaging, // host visible transfer buffers, including the readback ring
+  eOther,
+  eCount
+};
+
+char const *getMemoryCategoryName(MemoryCategory category);
+
+MemoryCategory getBufferMemoryCategory(vk::BufferUsageFlags usage,
+                                       vk::MemoryPropertyFlags memoryProperties);
+MemoryCategory getImageMemoryCategory(vk::ImageUsageFlags usage);
+
+struct MemoryCategoryStats {
+  uint64_t bytes{0};
+  uint64_t peakBytes{0};
+  uint32_t allocations{0};
+};
+
+/** budget of one memory heap as reported by VK_EXT_memory_budget, for all processes */
+struct MemoryHeapBudget {
+  uint64_t size{0};
+  uint64_t budget{0};
+  uint64_t usage{0};
+  bool deviceLocal{false};
+};
+
+/** Device memory allocated through VulkanBufferData and VulkanImageData on one device. Sizes
+ *  are those of the allocations, including alignment padding. */
+struct MemoryStats {
+  uint64_t bytes{0};
+  uint64_t peakBytes{0};
+  uint64_t deviceLocalBytes{0};
+  uint64_t hostVisibleBytes{0}; // not device local, mostly staging
+  std::array<MemoryCategoryStats, static_cast<size_t>(MemoryCategory::eCount)> categories{};
+
+  // sets of scenes, cameras, objects and materials out of the shared pool
+  uint32_t descriptorSets{0};
+  uint32_t maxDescriptorSets{0};
+
+  // empty unless the device supports VK_EXT_memory_budget
+  std::vector<MemoryHeapBudget> heaps;
+
+  inline MemoryCategoryStats const &get(MemoryCategory category) const {
+    return categories[static_cast<size_t>(category)];
+  }
+};
+
+/** Device memory of the meshes and textures cached for one loaded file. Textures used by
+ *  several models count for each of them; textures loaded on their own have an entry of
+ *  their own. */
+struct FileMemoryUsage {
+  std::string file;
+  uint32_t meshCount{0};
+  uint64_t meshBytes{0};
+  uint32_t textureCount{0};
+  uint64_t textureBytes{0};
+};
+
+/** Registers an allocation with the statistics of its device while it lives */
+class MemoryRecord {
+  vk::Device mDevice{};
+  MemoryCategory mCategory{MemoryCategory::eOther};
+  uint64_t mBytes{0};
+  bool mDeviceLocal{false};
+
+public:
+  MemoryRecord() = default;
+  MemoryRecord(vk::Device device, MemoryCategory category, uint64_t bytes, bool deviceLocal);
+  ~MemoryRecord();
+
+  MemoryRecord(MemoryRecord &&other);
+  MemoryRecord &operator=(MemoryRecord &&other);
+  MemoryRecord(MemoryRecord const &other) = delete;
+  MemoryRecord &operator=(MemoryRecord const &other) = delete;
+
+  inline uint64_t getBytes() const { return mBytes; }
+  inline MemoryCategory getCategory() const { return mCategory; }
+};
+
+/** Counts a descriptor set allocated from the pool of device while it lives */
+class DescriptorSetRecord {
+  vk::Device mDevice{};
+
+public:
+  DescriptorSetRecord() = default;
+  explicit DescriptorSetRecord(vk::Device device);
+  ~DescriptorSetRecord();
+
+  DescriptorSetRecord(DescriptorSetRecord &&other);
+  DescriptorSetRecord &operator=(DescriptorSetRecord &&other);
+  DescriptorSetRecord(DescriptorSetRecord const &other) = delete;
+  DescriptorSetRecord &operator=(DescriptorSetRecord const &other) = delete;
+};
+
+/** statistics recorded for device so far, without descriptor pool size and heap budgets */
+MemoryStats getRecordedMemoryStats(vk::Device device);
+
+/** forget device, called when it is destroyed */
+void clearRecordedMemoryStats(vk::Device device);
+
+} // namespace svulkan
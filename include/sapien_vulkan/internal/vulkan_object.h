@@ -12,6 +12,7 @@ struct VulkanObject {
 
   VulkanBufferData mUBO;
   vk::UniqueDescriptorSet mDescriptorSet;
+  DescriptorSetRecord mDescriptorSetRecord;
 
   VulkanObject(vk::PhysicalDevice physicalDevice, vk::Device device, vk::DescriptorPool descriptorPool,
                vk::DescriptorSetLayout descriptorLayout);
@@ -0,0 +1,36 @@
+#pragma once
+#include "vulkan_pass_timer.h"
+#include "vulkan_render_stats.h"
+#include "vulkan_renderer_config.h"
+#include <memory>
+
+namespace svulkan {
+
+class VulkanContext;
+
+/** Brackets the passes of a renderer with a debug label, CPU command counts and, when
+ *  passTimers is set, GPU timestamps. Shared by the renderers so they time passes alike. */
+class VulkanPassRecorder {
+  VulkanContext *mContext;
+  std::unique_ptr<VulkanPassTimer> mTimer; // null unless passTimers is set and supported
+  VulkanRenderStatsCollector mStats;
+
+public:
+  /** creates the timer for config, clearing passTimers and pipelineStatistics when the
+   *  device cannot provide them */
+  VulkanPassRecorder(VulkanContext &context, VulkanRendererConfig &config);
+
+  /** start a frame recorded into commandBuffer, before its first pass */
+  void beginFrame(vk::CommandBuffer commandBuffer);
+  void endFrame();
+
+  void begin(vk::CommandBuffer commandBuffer, char const *name);
+  void end(vk::CommandBuffer commandBuffer);
+
+  std::vector<PassTiming> getTimings() const;
+
+  inline VulkanRenderStatsCollector &getCollector() { return mStats; }
+  inline RenderStats const &getStats() const { return mStats.getStats(); }
+};
+
+} // namespace svulkan
@@ -0,0 +1,91 @@
+#pragma once
+#include "vulkan_util.h"
+#include <map>
+#include <string>
+
+namespace svulkan {
+
+/** GPU time of one named pass, summed over its occurrences in a frame */
+struct PassTiming {
+  std::string name;
+  double lastMilliseconds{0};    // most recent resolved frame
+  double averageMilliseconds{0}; // over the last sampleCount resolved frames
+  uint32_t sampleCount{0};
+  // of the most recent resolved frame, with pipeline statistics enabled; passes nested in a
+  // counted pass are included in it and count 0 themselves
+  uint64_t vertexInvocations{0};
+  uint64_t fragmentInvocations{0};
+};
+
+/** Timestamp queries written around passes. Each frame uses one query pool of a small ring;
+ *  its results are read when the pool comes around again, frameCount frames later, so reading
+ *  never waits for the GPU. Frames that are still running then are dropped. */
+class VulkanPassTimer {
+  vk::Device mDevice;
+  double mNanosecondsPerTick;
+  uint64_t mTimestampMask;
+  uint32_t mMaxQueries;
+  uint32_t mWindow;
+  bool mCalibrated{false};
+  int64_t mCpuOffset{0}; // profiler time in nanoseconds minus GPU time in nanoseconds
+
+  struct Frame {
+    vk::UniqueQueryPool mPool;
+    // timing index and first of its two queries, in recording order
+    std::vector<std::pair<uint32_t, uint32_t>> mPasses;
+    uint32_t mQueryCount{0};
+    // pipeline statistics, one query per counted pass and timing index of each query
+    vk::UniqueQueryPool mStatisticsPool;
+    std::vector<uint32_t> mStatistics;
+  };
+  std::vector<Frame> mFrames;
+  uint32_t mFrameIndex{0};
+  bool mFrameStarted{false};
+  // passes of the current frame that are open, -1 for passes past the query budget
+  std::vector<int32_t> mOpenPasses;
+  // depth in mOpenPasses of the pass with an active statistics query, queries cannot nest
+  int32_t mStatisticsDepth{-1};
+
+  struct History {
+    PassTiming timing;
+    std::vector<double> samples; // ring of the last mWindow frames
+    uint32_t next{0};
+  };
+  std::vector<History> mHistory;
+  std::map<std::string, uint32_t> mHistoryIndices;
+
+  void resolve(Frame &frame);
+
+public:
+  /** whether queueFamily of physicalDevice supports timestamps in graphics and compute */
+  static bool isSupported(vk::PhysicalDevice physicalDevice, uint32_t queueFamily);
+
+  VulkanPassTimer(vk::PhysicalDevice physicalDevice, vk::Device device, uint32_t queueFamily,
+                  uint32_t frameCount = 4, uint32_t maxPasses = 64, uint32_t window = 60);
+
+  VulkanPassTimer(VulkanPassTimer const &other) = delete;
+  VulkanPassTimer &operator=(VulkanPassTimer const &other) = delete;
+
+  /** Relate GPU timestamps to the profiler clock by waiting for one timestamp on queue. Once
+   *  calibrated, resolved passes are also recorded on the "GPU" track of an enabled profiler,
+   *  shifted by up to the submission latency. */
+  void calibrate(vk::CommandPool commandPool, vk::Queue queue);
+
+  /** Count vertex and fragment shader invocations of passes with pipeline statistics queries.
+   *  The device must have been created with pipelineStatisticsQuery. */
+  void enablePipelineStatistics();
+
+  /** Start a frame, outside of render passes. Passes are added to it until the next frame
+   *  starts, including passes recorded into other command buffers submitted after this one. */
+  void beginFrame(vk::CommandBuffer commandBuffer);
+
+  /** Time the commands recorded until the matching end, outside of render passes. Passes may
+   *  nest; passes before the first frame or beyond maxPasses are not timed. */
+  void begin(vk::CommandBuffer commandBuffer, std::string const &name);
+  void end(vk::CommandBuffer commandBuffer);
+
+  /** passes in the order they were first recorded */
+  std::vector<PassTiming> getTimings() const;
+};
+
+} // namespace svulkan
@@ -0,0 +1,107 @@
+#pragma once
+#include "vulkan_buffer.h"
+#include <memory>
+#include <mutex>
+
+namespace svulkan {
+
+class VulkanReadbackSlot;
+
+/** Persistently mapped staging buffers for asynchronous readback. Host cached memory is used
+ *  when the device has it, so reading results back is not an uncached memcpy. A buffer is
+ *  handed out when a copy is recorded and returned once its data has been read; more buffers
+ *  are allocated while all existing ones are in flight.
+ *
+ *  The ring is shared by the slots it hands out, so results may outlive the renderer that
+ *  recorded them. They must not outlive the VulkanContext that owns the device. */
+class VulkanReadbackRing : public std::enable_shared_from_this<VulkanReadbackRing> {
+public:
+  struct Slot {
+    std::unique_ptr<VulkanBufferData> mBuffer;
+    vk::DeviceSize mSize{0};
+    char *mMapped{nullptr};
+    bool mInUse{false};
+  };
+
+private:
+  vk::PhysicalDevice mPhysicalDevice;
+  vk::Device mDevice;
+
+  // results may be read on other threads than the one recording copies
+  std::mutex mMutex;
+  std::vector<std::unique_ptr<Slot>> mSlots;
+
+  void allocate(Slot &slot, vk::DeviceSize size);
+  void release(Slot &slot);
+
+  friend class VulkanReadbackSlot;
+
+public:
+  VulkanReadbackRing(vk::PhysicalDevice physicalDevice, vk::Device device);
+  ~VulkanReadbackRing();
+
+  VulkanReadbackRing(VulkanReadbackRing const &other) = delete;
+  VulkanReadbackRing &operator=(VulkanReadbackRing const &other) = delete;
+
+  /** a buffer of at least size bytes, owned by the returned handle. The ring must be owned
+   *  by a shared_ptr. */
+  VulkanReadbackSlot acquire(vk::DeviceSize size);
+
+  /** make device writes to the slot visible to the host, after the copy has completed */
+  void invalidate(Slot const &slot) const;
+  /** make host writes to the slot visible to the device, before it is submitted */
+  void flush(Slot const &slot) const;
+};
+
+/** A buffer of the ring, returned to it when this handle is destroyed */
+class VulkanReadbackSlot {
+  std::shared_ptr<VulkanReadbackRing> mRing;
+  VulkanReadbackRing::Slot *mSlot{nullptr};
+
+public:
+  VulkanReadbackSlot() = default;
+  VulkanReadbackSlot(std::shared_ptr<VulkanReadbackRing> ring, VulkanReadbackRing::Slot &slot);
+  ~VulkanReadbackSlot();
+
+  VulkanReadbackSlot(VulkanReadbackSlot const &other) = delete;
+  VulkanReadbackSlot &operator=(VulkanReadbackSlot const &other) = delete;
+  VulkanReadbackSlot(VulkanReadbackSlot &&other);
+  VulkanReadbackSlot &operator=(VulkanReadbackSlot &&other);
+
+  inline VulkanReadbackRing::Slot *operator->() const { return mSlot; }
+  inline explicit operator bool() const { return mSlot; }
+
+  /** see VulkanReadbackRing::invalidate and flush */
+  inline void invalidate() const { mRing->invalidate(*mSlot); }
+  inline void flush() const { mRing->flush(*mSlot); }
+};
+
+/** Render targets copied together into one staging buffer. The pointers lead into that
+ *  buffer and stay valid until this object is destroyed, which recycles the buffer. Data is
+ *  in the storage format of each target. */
+class VulkanDownloadedTargets {
+public:
+  struct Target {
+    vk::Format mFormat;
+    vk::DeviceSize mOffset;
+    size_t mSize;
+  };
+
+private:
+  VulkanReadbackSlot mSlot;
+  std::vector<Target> mTargets;
+
+public:
+  VulkanDownloadedTargets(VulkanReadbackSlot slot, std::vector<Target> targets);
+
+  VulkanDownloadedTargets(VulkanDownloadedTargets &&other) = default;
+  VulkanDownloadedTargets &operator=(VulkanDownloadedTargets &&other) = default;
+
+  /** targets are in the order they were requested */
+  inline size_t count() const { return mTargets.size(); }
+  inline char const *data(size_t index) const { return mSlot->mMapped + mTargets[index].mOffset; }
+  inline size_t size(size_t index) const { return mTargets[index].mSize; }
+  inline vk::Format format(size_t index) const { return mTargets[index].mFormat; }
+};
+
+} // namespace svulkan
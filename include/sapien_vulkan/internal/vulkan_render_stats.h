@@ -0,0 +1,144 @@
+#pragma once
+#include "vulkan_util.h"
+#include <map>
+#include <string>
+
+namespace svulkan {
+
+/** Commands recorded for one pass, excluding nested passes, summed over a frame */
+struct PassStats {
+  std::string name;
+  uint32_t drawCalls{0};
+  uint64_t instances{0};
+  uint64_t triangles{0}; // of draws as recorded, assuming triangle lists, not multiplied by views
+  uint32_t pipelineBinds{0};
+  uint32_t descriptorSetBinds{0}; // descriptor sets, not calls
+  uint32_t vertexBufferBinds{0};
+  uint32_t indexBufferBinds{0};
+  uint32_t barriers{0}; // memory, buffer and image barriers
+
+  void add(PassStats const &other);
+};
+
+/** Commands and uploads of the last rendered frame */
+struct RenderStats {
+  std::vector<PassStats> passes; // in the order they were first recorded
+  PassStats total;               // including commands outside of named passes
+  uint64_t uploadedBytes{0};     // written by copyToDevice, object, camera and light data
+};
+
+/** Counts the commands of a frame into the innermost open pass */
+class VulkanRenderStatsCollector {
+  RenderStats mStats;
+  RenderStats mCurrent;
+  std::map<std::string, uint32_t> mIndices;
+  std::vector<uint32_t> mOpenPasses;
+  uint64_t mUploadedBytesStart{0};
+  bool mRecording{false};
+
+public:
+  /** start counting a frame, passes recorded outside of frames are ignored */
+  void beginFrame();
+  /** publish the frame to getStats */
+  void endFrame();
+
+  void begin(std::string const &name);
+  void end();
+
+  /** counters of the innermost open pass, or of the frame total outside of passes */
+  PassStats *current();
+
+  inline RenderStats const &getStats() const { return mStats; }
+};
+
+/** A command buffer that counts the draws, binds and barriers recorded through it. It converts
+ *  to vk::CommandBuffer, commands recorded through the plain handle are not counted. */
+class StatsCommandBuffer : public vk::CommandBuffer {
+  VulkanRenderStatsCollector *mCollector;
+
+public:
+  StatsCommandBuffer(vk::CommandBuffer commandBuffer, VulkanRenderStatsCollector &collector)
+      : vk::CommandBuffer(commandBuffer), mCollector(&collector) {}
+
+  inline VulkanRenderStatsCollector &getCollector() const { return *mCollector; }
+
+  inline void draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex,
+                   uint32_t firstInstance) const {
+    if (auto stats = mCollector->current()) {
+      stats->drawCalls++;
+      stats->instances += instanceCount;
+      stats->triangles += uint64_t(vertexCount / 3) * instanceCount;
+    }
+    vk::CommandBuffer::draw(vertexCount, instanceCount, firstVertex, firstInstance);
+  }
+
+  inline void drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex,
+                          int32_t vertexOffset, uint32_t firstInstance) const {
+    if (auto stats = mCollector->current()) {
+      stats->drawCalls++;
+      stats->instances += instanceCount;
+      stats->triangles += uint64_t(indexCount / 3) * instanceCount;
+    }
+    vk::CommandBuffer::drawIndexed(indexCount, instanceCount, firstIndex, vertexOffset,
+                                   firstInstance);
+  }
+
+  inline void bindPipeline(vk::PipelineBindPoint bindPoint, vk::Pipeline pipeline) const {
+    if (auto stats = mCollector->current()) {
+      stats->pipelineBinds++;
+    }
+    vk::CommandBuffer::bindPipeline(bindPoint, pipeline);
+  }
+
+  inline void bindDescriptorSets(vk::PipelineBindPoint bindPoint, vk::PipelineLayout layout,
+                                 uint32_t firstSet,
+                                 vk::ArrayProxy<const vk::DescriptorSet> const &sets,
+                                 vk::ArrayProxy<const uint32_t> const &dynamicOffsets) const {
+    if (auto stats = mCollector->current()) {
+      stats->descriptorSetBinds += sets.size();
+    }
+    vk::CommandBuffer::bindDescriptorSets(bindPoint, layout, firstSet, sets, dynamicOffsets);
+  }
+
+  inline void bindVertexBuffers(uint32_t firstBinding,
+                                vk::ArrayProxy<const vk::Buffer> const &buffers,
+                                vk::ArrayProxy<const vk::DeviceSize> const &offsets) const {
+    if (auto stats = mCollector->current()) {
+      stats->vertexBufferBinds += buffers.size();
+    }
+    vk::CommandBuffer::bindVertexBuffers(firstBinding, buffers, offsets);
+  }
+
+  inline void bindIndexBuffer(vk::Buffer buffer, vk::DeviceSize offset,
+                              vk::IndexType indexType) const {
+    if (auto stats = mCollector->current()) {
+      stats->indexBufferBinds++;
+    }
+    vk::CommandBuffer::bindIndexBuffer(buffer, offset, indexType);
+  }
+
+  inline void
+  pipelineBarrier(vk::PipelineStageFlags sourceStage, vk::PipelineStageFlags destStage,
+                  vk::DependencyFlags dependencyFlags,
+                  vk::ArrayProxy<const vk::MemoryBarrier> const &memoryBarriers,
+                  vk::ArrayProxy<const vk::BufferMemoryBarrier> const &bufferBarriers,
+                  vk::ArrayProxy<const vk::ImageMemoryBarrier> const &imageBarriers) const {
+    if (auto stats = mCollector->current()) {
+      stats->barriers += memoryBarriers.size() + bufferBarriers.size() + imageBarriers.size();
+    }
+    vk::CommandBuffer::pipelineBarrier(sourceStage, destStage, dependencyFlags, memoryBarriers,
+                                       bufferBarriers, imageBarriers);
+  }
+};
+
+/** transitionImageLayout recorded through a counting command buffer */
+template <typename... Args>
+inline void transitionImageLayout(StatsCommandBuffer commandBuffer, Args &&... args) {
+  if (auto stats = commandBuffer.getCollector().current()) {
+    stats->barriers++;
+  }
+  transitionImageLayout(static_cast<vk::CommandBuffer>(commandBuffer),
+                        std::forward<Args>(args)...);
+}
+
+} // namespace svulkan
@@ -1,22 +1,95 @@
 #pragma once
+#include "sapien_vulkan/uniform_buffers.h"
 #include "vulkan.h"
+#include "vulkan_pass_recorder.h"
+#include "vulkan_readback.h"
 #include "vulkan_renderer_config.h"
+#include <future>
+#include <map>
 
 namespace svulkan {
 
 class VulkanContext;
 
+/* a pixel of one tile (batch index) and view (multiview layer) of the targets */
+struct PixelQuery {
+  int32_t x;
+  int32_t y;
+  uint32_t tile{0};
+  uint32_t view{0};
+};
+
+/* Texels gathered by queryPixels, one uvec4 of raw 32-bit values per target and point.
+ * Float targets hold float bits, decoded like the download functions; points outside the
+ * targets read 0. */
+struct PixelQueryResult {
+  uint32_t pointCount{0};
+  std::vector<glm::uvec4> values; // all points of the first target, then the next target
+
+  inline glm::uvec4 getUint(uint32_t target, uint32_t point) const {
+    return values[target * pointCount + point];
+  }
+  inline glm::vec4 getFloat(uint32_t target, uint32_t point) const {
+    return glm::uintBitsToFloat(getUint(target, point));
+  }
+};
+
+/* pixels of one id in one tile and view; bounds are inclusive tile coordinates */
+struct SegmentationStats {
+  uint32_t pixelCount{0};
+  glm::uvec2 min{0};
+  glm::uvec2 max{0};
+};
+
+/* what computePointCloud emits besides positions */
+struct PointCloudConfig {
+  bool worldSpace{false}; // camera space otherwise
+  bool color{false};
+  DownloadTarget colorTarget{RenderTarget::eLighting};
+  bool segmentation{false};
+  uint32_t segmentationChannel{0};
+  float voxelSize{0.f}; // keep one point per voxel of this size, 0 keeps every point
+};
+
+/* points of all tiles and views, in no particular order */
+struct PointCloud {
+  std::vector<glm::vec3> positions;
+  std::vector<uint32_t> segmentation; // empty unless requested
+  std::vector<uint32_t> colors;       // sRGB RGBA8, empty unless requested
+};
+
+/* Result of computeSegmentationStats, ids at or above idCount are not counted */
+struct SegmentationStatsResult {
+  uint32_t idCount{0};
+  uint32_t imageCount{0}; // tiles times views, views of a tile are adjacent
+  std::vector<SegmentationStats> stats; // channel, then image, then id
+
+  inline SegmentationStats const &get(uint32_t channelIndex, uint32_t image, uint32_t id) const {
+    return stats[(size_t(channelIndex) * imageCount + image) * idCount + id];
+  }
+};
+
 class VulkanRenderer {
   VulkanContext *mContext;
   VulkanRendererConfig mConfig;
 
+  // size of the targets; with batchSize > 1 they hold a grid of tiles of the requested size
   int mWidth, mHeight;
+  int mTileWidth, mTileHeight;
+  uint32_t mTileColumns{1};
 
   struct DescriptorSetLayouts {
     vk::UniqueDescriptorSetLayout deferred;
     vk::UniqueDescriptorSetLayout composite;
+    vk::UniqueDescriptorSetLayout position;
+    vk::UniqueDescriptorSetLayout lightingInput;
+    vk::UniqueDescriptorSetLayout compositeInput;
+    vk::UniqueDescriptorSetLayout tiledLighting;
+    vk::UniqueDescriptorSetLayout segmentationStats;
+    vk::UniqueDescriptorSetLayout pointCloud;
   } mDescriptorSetLayouts;
   void initializeDescriptorLayouts();
+  void initializeSamplerDescriptorSets();
 
   struct RenderTargets {
     std::unique_ptr<VulkanImageData> albedo;
@@ -32,7 +105,12 @@ class VulkanRenderer {
   } mRenderTargets;
 
   struct RenderTargetFormats {
-    vk::Format colorFormat;
+    vk::Format albedoFormat;
+    vk::Format positionFormat;
+    vk::Format specularFormat;
+    vk::Format normalFormat;
+    vk::Format lightingFormat;
+    vk::Format customFormat;
     vk::Format segmentationFormat;
     vk::Format depthFormat;
   } mRenderTargetFormats;
@@ -48,24 +126,118 @@ class VulkanRenderer {
   vk::UniqueDescriptorSet mCompositeDescriptorSet;
   vk::UniqueSampler mCompositeSampler;
 
+  // single render pass used instead of the passes above when mergeRenderPasses is set
+  std::unique_ptr<class MergedPass> mMergedPass;
+  vk::UniqueDescriptorSet mLightingInputDescriptorSet;
+  vk::UniqueDescriptorSet mCompositeInputDescriptorSet;
+  // a scene drawn with its own camera into one tile of the targets
+  struct View {
+    class Scene *scene;
+    vk::DescriptorSet camera;
+    vk::Rect2D area;
+  };
+  vk::Extent2D getTileExtent() const;
+  vk::Rect2D getTile(uint32_t index) const;
+  void prepareScene(class Scene &scene);
+
+  void renderMerged(StatsCommandBuffer commandBuffer, std::vector<View> const &views);
+
+  // camera array read by the multiview shaders, indexed by view
+  std::unique_ptr<VulkanBufferData> mMultiviewCameraBuffer;
+  vk::UniqueDescriptorSet mMultiviewCameraDescriptorSet;
+
+  // depth and segmentation without the G-buffer, used when nothing else is an output
+  std::unique_ptr<class SensorPass> mSensorPass;
+  void renderSensor(StatsCommandBuffer commandBuffer, std::vector<View> const &views);
+
+  // compute lighting with per tile light lists, replaces the deferred pass
+  std::unique_ptr<class ComputePass> mTiledLightingPass;
+  vk::UniqueDescriptorSet mTiledLightingDescriptorSet;
+  void renderTiledLighting(StatsCommandBuffer commandBuffer, class Scene &scene,
+                           class Camera &camera);
+
+  // cached shadow maps of the scene, rendered before the G-buffer
+  std::unique_ptr<class ShadowPass> mShadowPass;
+  void renderShadows(StatsCommandBuffer commandBuffer, class Scene &scene, class Camera &camera);
+
+  // which targets and passes the configured outputs require
+  bool isOutput(RenderTarget target) const;
+  bool needsLighting() const;
+  bool needsTarget(RenderTarget target) const;
+  bool useMergedPass() const;
+  bool useTiledLighting() const;
+  bool useShadows() const;
+  bool useSensorPass() const;
+  bool isTransient(RenderTarget target) const;
+  VulkanImageData &getDownloadTarget(RenderTarget target);
+  VulkanImageData &getDownloadTarget(DownloadTarget const &target);
+
+  // reconstructs positions from depth when the position target is not kept
+  std::unique_ptr<class ComputePass> mPositionPass;
+  vk::UniqueDescriptorSet mPositionDescriptorSet;
+  std::unique_ptr<VulkanBufferData> mPositionBuffer;
+
+  // every camera of the last render, one per tile and view
+  std::vector<CameraUBO> mRenderedCameras;
+  /** inverse projections of mRenderedCameras for every tile and view, used to unproject depth */
+  std::vector<glm::mat4> getProjectionsInverse() const;
+
+  // persistent staging buffers of the asynchronous downloads
+  std::shared_ptr<VulkanReadbackRing> mReadbackRing;
+
+  // device local storage for compute results that are copied back, grown on demand
+  std::unique_ptr<VulkanBufferData> mScratchBuffer;
+  vk::DeviceSize mScratchBufferSize{0};
+  VulkanBufferData &getScratchBuffer(vk::DeviceSize size);
+
+  // converts targets before readback
+  std::unique_ptr<class ConvertPass> mConvertPass;
+
+  // gathers texels for pixel queries
+  std::unique_ptr<class PickPass> mPickPass;
+
+  // reduces segmentation to per id statistics, pipeline built on first use
+  std::unique_ptr<class ComputePass> mSegmentationStatsPass;
+  vk::UniqueDescriptorSet mSegmentationStatsDescriptorSet;
+
+  // compacted point clouds, pipelines keyed by segmentation, world space and color
+  std::map<std::tuple<bool, bool, bool>, std::unique_ptr<class ComputePass>> mPointCloudPasses;
+  vk::UniqueDescriptorSet mPointCloudDescriptorSet;
+
+  // debug labels, command counts and GPU timestamps around the passes of render and renderBatch
+  VulkanPassRecorder mPasses;
+
 public:
   VulkanRenderer(VulkanContext &context, VulkanRendererConfig const &config);
 
   VulkanRenderer(VulkanRenderer const &other) = delete;
   VulkanRenderer &operator=(VulkanRenderer const &other) = delete;
 
-  VulkanRenderer(VulkanRenderer &&other) = default;
-  VulkanRenderer &operator=(VulkanRenderer &&other) = default;
+  // defined where the pass types are complete
+  VulkanRenderer(VulkanRenderer &&other);
+  VulkanRenderer &operator=(VulkanRenderer &&other);
+  ~VulkanRenderer();
 
   void resize(int width, int height);
   void initializeRenderTextures();
   void initializeRenderPasses();
 
   void render(vk::CommandBuffer commandBuffer, class Scene &scene, class Camera &camera);
+  /* render viewCount cameras at once, camera i goes to layer i of every target */
+  void render(vk::CommandBuffer commandBuffer, class Scene &scene,
+              std::vector<class Camera *> const &cameras);
+  /* render up to batchSize independent scenes, pair i goes to tile i of every target. Pairs
+   * may share a scene unless shadows are enabled, shadow maps are fit to a single camera. */
+  void renderBatch(vk::CommandBuffer commandBuffer,
+                   std::vector<std::pair<class Scene *, class Camera *>> const &batch);
   /* blit image to screen */
   void display(vk::CommandBuffer commandBuffer, vk::Image swapchainImage,
                vk::Format swapchainFormat, uint32_t width, uint32_t height);
 
+  /* download functions return 4 floats per pixel (1 for depth) regardless of the
+   * storage format, segmentation returns one uint per channel of the target. With
+   * viewCount > 1 the views follow each other, view-major, and with batchSize > 1 every
+   * tile is returned, one after another. */
   std::vector<float> downloadAlbedo();
   std::vector<float> downloadPosition();
   std::vector<float> downloadSpecular();
@@ -75,6 +247,71 @@ public:
   std::vector<float> downloadLighting();
   std::vector<float> downloadCustom(uint32_t index);
 
+  /* Copy several targets with one submission into one staging buffer and wait once. Data is
+   * returned in the storage format of each target, without decoding, and stays valid while
+   * the returned object lives. */
+  VulkanDownloadedTargets downloadTargets(std::vector<DownloadTarget> const &targets);
+
+  /* Like downloadTargets, but each target is first converted on the GPU (type, channel
+   * selection, scaling, linear depth) so only the converted bytes are read back. Linear depth
+   * unprojects with the last rendered camera, views and tiles are assumed to share its
+   * projection. */
+  VulkanDownloadedTargets downloadConverted(std::vector<DownloadConversion> const &conversions);
+
+  /* Download straight into caller owned memory, e.g. a numpy array, with a single copy out
+   * of the persistently mapped staging memory. Data is laid out like downloadTargets (or
+   * downloadConverted) returns it: rows of getTileExtent().width pixels, for every layer and
+   * tile in turn, written rowStride bytes apart (0 for tightly packed). destination must hold
+   * getDownloadSize bytes when packed. For a view without any copy use downloadTargets or
+   * downloadConverted, whose data stays mapped while the result lives. */
+  void downloadInto(DownloadTarget const &target, void *destination, size_t rowStride = 0);
+  void downloadConvertedInto(DownloadConversion const &conversion, void *destination,
+                             size_t rowStride = 0);
+  size_t getDownloadSize(DownloadTarget const &target);
+  size_t getDownloadSize(DownloadConversion const &conversion);
+
+  /* Read the texels at points from every target with one compute dispatch per target and a
+   * single submission. queryPixelsAsync records into commandBuffer and follows the rules of
+   * downloadAsync below, its descriptor sets are also kept until the fence has signaled. */
+  PixelQueryResult queryPixels(std::vector<DownloadTarget> const &targets,
+                               std::vector<PixelQuery> const &points);
+  std::future<PixelQueryResult> queryPixelsAsync(vk::CommandBuffer commandBuffer,
+                                                 vk::Fence fence,
+                                                 std::vector<DownloadTarget> const &targets,
+                                                 std::vector<PixelQuery> const &points);
+
+  /* Pixel count and bounding box of every id below idCount in the given segmentation
+   * channels, for each tile and view. The reduction runs on the GPU and only the table is
+   * read back. */
+  SegmentationStatsResult computeSegmentationStats(std::vector<uint32_t> const &channels,
+                                                   uint32_t idCount);
+
+  /* Points of every pixel that hits geometry in the last render, compacted on the GPU so the
+   * transfer is proportional to the number of points. Depth is unprojected with the camera
+   * of each tile and view. */
+  PointCloud computePointCloud(PointCloudConfig const &config);
+
+  /* Asynchronous downloads record the copy into commandBuffer, after render, and return
+   * immediately. fence is the fence commandBuffer is submitted with; get() on the returned
+   * future waits for it and converts the result like the functions above. fence may be null
+   * when the caller waits for the submission itself. Results use persistent host cached
+   * staging memory owned by the future. Destroying the future waits for fence before that
+   * memory is recycled, so commandBuffer must be submitted and the fence not reset until
+   * get() returns or the future is destroyed. Position reconstructed from depth is not
+   * available asynchronously. */
+  std::future<std::vector<float>> downloadAsync(vk::CommandBuffer commandBuffer, vk::Fence fence,
+                                                RenderTarget target);
+  std::future<std::vector<uint32_t>> downloadSegmentationAsync(vk::CommandBuffer commandBuffer,
+                                                               vk::Fence fence);
+
+  /* Rolling GPU times of every pass and download recorded so far, empty unless passTimers is
+   * set. Each render starts a frame; its times appear a few frames later. */
+  std::vector<PassTiming> getPassTimings() const;
+
+  /* Draws, binds, barriers and uploaded bytes of the last render or renderBatch, counted on
+   * the CPU while recording. Always available. */
+  inline RenderStats const &getRenderStats() const { return mPasses.getStats(); }
+
   inline RenderTargets &getRenderTargets() { return mRenderTargets; }
 };
 
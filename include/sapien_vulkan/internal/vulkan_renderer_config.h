@@ -1,12 +1,142 @@
 #pragma once
+#include <cstdint>
+#include <set>
 #include <string>
+#include <vector>
 
 namespace svulkan {
 
+enum class RenderTarget { eAlbedo, ePosition, eSpecular, eNormal, eSegmentation, eDepth, eLighting };
+
+/* a target for downloadTargets, custom targets are selected by index */
+struct DownloadTarget {
+  RenderTarget target{RenderTarget::eLighting};
+  int32_t customIndex{-1};
+
+  DownloadTarget(RenderTarget target) : target(target) {}
+  static inline DownloadTarget custom(uint32_t index) {
+    DownloadTarget result(RenderTarget::eLighting);
+    result.customIndex = static_cast<int32_t>(index);
+    return result;
+  }
+};
+
+enum class ConvertedType { eUint8, eUint16, eUint32, eFloat32 };
+
+/* Conversion applied on the GPU by downloadConverted. The selected source channels are
+ * written in order, tightly packed. Float sources are multiplied by scale and, for integer
+ * types, rounded and clamped to the type's range; integer sources (segmentation) are copied
+ * and saturated. */
+struct DownloadConversion {
+  DownloadTarget target;
+  ConvertedType type{ConvertedType::eUint8};
+  std::vector<uint32_t> channels{0, 1, 2}; // 1 to 4 source channels
+  float scale{255.f};
+  bool srgb{false};        // encode clamped colors to sRGB before scaling
+  bool linearDepth{false}; // depth only: camera distance along the view axis, 0 for background
+
+  DownloadConversion(DownloadTarget target) : target(target) {}
+
+  /* 8 bit RGB, sRGB encoded like the displayed image */
+  static inline DownloadConversion rgb8(DownloadTarget target, bool srgb = true) {
+    DownloadConversion result(target);
+    result.srgb = srgb;
+    return result;
+  }
+  static inline DownloadConversion depthMeters() {
+    DownloadConversion result(RenderTarget::eDepth);
+    result.type = ConvertedType::eFloat32;
+    result.channels = {0};
+    result.scale = 1.f;
+    result.linearDepth = true;
+    return result;
+  }
+  static inline DownloadConversion depthMillimeters() {
+    DownloadConversion result(RenderTarget::eDepth);
+    result.type = ConvertedType::eUint16;
+    result.channels = {0};
+    result.scale = 1000.f;
+    result.linearDepth = true;
+    return result;
+  }
+  static inline DownloadConversion segmentationId(uint32_t channel = 0) {
+    DownloadConversion result(RenderTarget::eSegmentation);
+    result.type = ConvertedType::eUint32;
+    result.channels = {channel};
+    result.scale = 1.f;
+    return result;
+  }
+};
+
 struct VulkanRendererConfig {
   std::string shaderDir{};
   std::string culling{"back"};
   uint32_t customTextureCount{0};
+
+  // Targets that will be downloaded or displayed. Targets and passes that do not contribute
+  // to them are skipped, e.g. without eLighting no lighting or composite pass is run.
+  // Depth is always rendered, custom targets are controlled by customTextureCount.
+  std::set<RenderTarget> outputs{RenderTarget::eAlbedo,       RenderTarget::ePosition,
+                                 RenderTarget::eSpecular,     RenderTarget::eNormal,
+                                 RenderTarget::eSegmentation, RenderTarget::eDepth,
+                                 RenderTarget::eLighting};
+
+  // Store the G-buffer in packed formats: RGBA8 sRGB albedo, RG16 octahedral normal,
+  // RGBA8 specular/roughness/metallic, RGBA16F lighting and RG32 uint segmentation
+  bool compactGBuffer{false};
+
+  // Do not keep a position target; lighting reconstructs positions from depth and
+  // downloadPosition computes them on demand
+  bool positionFromDepth{false};
+
+  // Record G-buffer, lighting, transparency and composite as subpasses of a single render
+  // pass, lighting and composite read their inputs as input attachments
+  bool mergeRenderPasses{false};
+
+  // With mergeRenderPasses, albedo, position, specular, normal and the linear lighting target
+  // are never written to memory and cannot be downloaded. Targets that are only read by
+  // lighting and are not in outputs are always transient.
+  bool transientGBuffer{false};
+
+  // Shade in a compute pass that culls point lights per 16x16 tile instead of running every
+  // light on every pixel. Scales to many lights, ignored together with mergeRenderPasses.
+  bool tiledLighting{false};
+
+  // Point lights only reach pixels where emission / distance^2 is above this value
+  float tiledLightingCutoff{0.001f};
+
+  // Shadow maps for the first directional light (cascaded) and the first point lights.
+  // Static objects (Object::setStatic) are rendered into a cache that is only refreshed when
+  // they or the lights change; dynamic objects are drawn over a copy of it every frame. With
+  // static objects, cascades cover spheres around the camera that follow it in steps of a
+  // quarter of their radius, so camera rotations and small moves keep the cache.
+  bool shadows{false};
+  uint32_t shadowMapSize{2048};
+  uint32_t shadowCascadeCount{3};   // at most MaxShadowCascades
+  uint32_t shadowPointLightCount{1}; // at most MaxShadowPointLights
+  float shadowDistance{20.f};       // cascade range and point light shadow far plane
+
+  // Render this many cameras in one render pass with multiview (VulkanRenderer::render with a
+  // list of cameras). Every target becomes an array image with one layer per camera and
+  // downloads return the layers one after another. Scene uploads and draw recording are shared
+  // by all views. Requires the lighting output and implies mergeRenderPasses; shadows and
+  // positionFromDepth are not supported. At most MaxCameraViews.
+  uint32_t viewCount{1};
+
+  // Render this many independent scene/camera pairs with one VulkanRenderer::renderBatch call.
+  // The targets hold a grid of tiles of the size passed to resize, one per pair, drawn with
+  // per tile viewports in a single render pass; downloads copy all tiles in one transfer and
+  // return them one after another. Unless depth and segmentation are the only outputs this
+  // requires the lighting output and implies mergeRenderPasses. Not combined with viewCount.
+  uint32_t batchSize{1};
+
+  // Write GPU timestamps around every pass and download, see getPassTimings. Results are read
+  // a few frames later without waiting for the GPU. Ignored when the queue has no timestamps.
+  bool passTimers{false};
+
+  // With passTimers, also count vertex and fragment shader invocations of every outermost
+  // pass. Ignored when the device has no pipeline statistics queries.
+  bool pipelineStatistics{false};
 };
 
 } // namespace svulkan
@@ -1,5 +1,6 @@
 #pragma once
 #include "vulkan.h"
+#include "vulkan_pass_recorder.h"
 #include "vulkan_renderer_config.h"
 
 namespace svulkan {
@@ -49,6 +50,8 @@ class VulkanRendererForEditor {
   vk::UniqueDescriptorSet mCompositeDescriptorSet;
   vk::UniqueSampler mCompositeSampler;
 
+  VulkanPassRecorder mPasses;
+
 public:
   VulkanRendererForEditor(VulkanContext &context, VulkanRendererConfig const &config);
 
@@ -83,6 +86,12 @@ public:
 
   inline RenderTargets &getRenderTargets() { return mRenderTargets; }
 
+  /** GPU time per pass, empty unless passTimers is set in the config */
+  std::vector<PassTiming> getPassTimings() const;
+
+  /** draws, binds, barriers and uploads of the last render */
+  inline RenderStats const &getRenderStats() const { return mPasses.getStats(); }
+
   //=== axis drawing ===//
 private:
   // axis
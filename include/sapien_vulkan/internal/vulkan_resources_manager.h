@@ -33,6 +33,9 @@ public:
 
   std::shared_ptr<VulkanTextureData> loadTexture(std::string const &filename);
   std::shared_ptr<VulkanTextureData> getPlaceholderTexture();
+
+  /** memory held by the cached files, largest first */
+  std::vector<FileMemoryUsage> getFileMemoryUsage() const;
 };
 
 }; // namespace svulkan
@@ -1,5 +1,6 @@
 #pragma once
 #include "vulkan.h"
+#include "vulkan_shadow.h"
 #include "sapien_vulkan/uniform_buffers.h"
 
 namespace svulkan
@@ -7,13 +8,33 @@ namespace svulkan
 class VulkanScene {
   std::unique_ptr<VulkanBufferData> mUBO = nullptr;
   vk::UniqueDescriptorSet mDescriptorSet {};
+  DescriptorSetRecord mDescriptorSetRecord;
 
+  // light storage buffers, grown on demand
+  std::unique_ptr<VulkanBufferData> mDirectionalLightBuffer = nullptr;
+  std::unique_ptr<VulkanBufferData> mPointLightBuffer = nullptr;
+  uint32_t mDirectionalLightCapacity = 0;
+  uint32_t mPointLightCapacity = 0;
+
+  // shadow maps start as a single placeholder layer until a renderer asks for real ones
+  std::unique_ptr<VulkanBufferData> mShadowUBO = nullptr;
+  std::unique_ptr<VulkanShadowMaps> mShadowMaps = nullptr;
+
+  vk::PhysicalDevice mPhysicalDevice;
   vk::Device mDevice;
+  vk::CommandPool mCommandPool;
+  vk::Queue mQueue;
 
  public:
   VulkanScene(vk::PhysicalDevice physicalDevice, vk::Device device, vk::DescriptorPool descriptorPool,
-              vk::DescriptorSetLayout descriptorLayout);
+              vk::DescriptorSetLayout descriptorLayout, vk::CommandPool commandPool,
+              vk::Queue queue);
   void updateUBO(SceneUBO const&ubo);
+  void updateLights(std::vector<DirectionalLight> const &directionalLights,
+                    std::vector<PointLight> const &pointLights);
+  void updateShadowUBO(ShadowUBO const &ubo);
+  /** shadow maps with the given size and layer count, reallocated if they differ */
+  VulkanShadowMaps &getShadowMaps(uint32_t size, uint32_t layers);
   inline vk::DescriptorSet getDescriptorSet() const { return mDescriptorSet.get(); }
 };
 }
@@ -0,0 +1,41 @@
+#pragma once
+#include "vulkan_image.h"
+
+namespace svulkan {
+
+/** Shadow map array of a scene. Static casters are rendered into mStaticImage and only
+ *  re-rendered when a layer's light matrix or the static geometry changes. Each frame the
+ *  cache is copied into mImage and dynamic casters are drawn on top; mImage is what the
+ *  lighting shaders sample. */
+struct VulkanShadowMaps {
+  uint32_t mSize;
+  uint32_t mLayers;
+  vk::Format mFormat{vk::Format::eD32Sfloat};
+
+  std::unique_ptr<VulkanImageData> mStaticImage; // kept in TransferSrcOptimal
+  std::unique_ptr<VulkanImageData> mImage;       // kept in ShaderReadOnlyOptimal
+  vk::UniqueImageView mArrayView;
+  vk::UniqueSampler mSampler;
+  std::vector<vk::UniqueImageView> mStaticLayerViews;
+  std::vector<vk::UniqueImageView> mLayerViews;
+
+  // created from the first shadow render pass, usable with any compatible one
+  std::vector<vk::UniqueFramebuffer> mStaticFramebuffers;
+  std::vector<vk::UniqueFramebuffer> mFramebuffers;
+
+  // what each layer of the static cache was last rendered with
+  std::vector<glm::mat4> mCachedMatrices;
+  std::vector<uint64_t> mCachedVersions;
+  std::vector<bool> mCachedValid;
+
+  // state of mImage after the last update
+  uint32_t mUsedLayers{0};
+  bool mHasDynamicCasters{false};
+
+  VulkanShadowMaps(vk::PhysicalDevice physicalDevice, vk::Device device,
+                   vk::CommandPool commandPool, vk::Queue queue, uint32_t size, uint32_t layers);
+
+  void initializeFramebuffers(vk::Device device, vk::RenderPass renderPass);
+};
+
+} // namespace svulkan
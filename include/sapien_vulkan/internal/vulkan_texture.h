@@ -10,6 +10,10 @@ struct VulkanTextureData {
   std::unique_ptr<VulkanImageData> mImageData;
   vk::UniqueSampler mTextureSampler;
 
+  // whether some texels are fully transparent and get discarded, conservatively true unless
+  // the loader has checked the alpha channel
+  bool mHasTransparentTexels{true};
+
   VulkanTextureData(vk::PhysicalDevice physicalDevice, vk::Device device, const vk::Extent2D &extent,
                     vk::ImageTiling tiling = vk::ImageTiling::eLinear,
                     vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eTransferDst |
@@ -1,6 +1,7 @@
 #pragma once
 #include <vulkan/vulkan.hpp>
 #include "sapien_vulkan/common/log.h"
+#include "sapien_vulkan/common/profiler.h"
 
 namespace svulkan {
 /** Load shader file to create shader module
@@ -13,10 +14,14 @@ vk::UniqueDeviceMemory allocateMemory(vk::Device device,
                                       vk::MemoryRequirements const &memoryRequirements,
                                       vk::MemoryPropertyFlags memoryPropertyFlags);
 
+/** Bytes written by copyToDevice on the calling thread so far */
+uint64_t &getCopiedToDeviceBytes();
+
 /** Copy an array of data to device with given stride */
 template<class T>
 void copyToDevice(vk::Device device, vk::DeviceMemory memory, T const* pData, size_t count, size_t stride = sizeof(T)) {
   log::check(sizeof(T) <= stride, "copyToDevice failed: stride is smaller than data size");
+  getCopiedToDeviceBytes() += count * sizeof(T);
 
   uint8_t *deviceData = static_cast<uint8_t*>(device.mapMemory(memory, 0, count * stride));
 
@@ -48,6 +53,7 @@ void OneTimeSubmitNoWait(vk::CommandBuffer commandBuffer, vk::Queue queue, Func
 template <typename Func>
 void OneTimeSubmit(vk::CommandBuffer commandBuffer, vk::Queue queue, Func const &func) {
   OneTimeSubmitNoWait(commandBuffer, queue, func);
+  SVULKAN_PROFILE_SCOPE("OneTimeSubmit wait");
   queue.waitIdle();
 }
 
@@ -59,14 +65,25 @@ void OneTimeSubmit(vk::Device device, vk::CommandPool commandPool, vk::Queue que
                     vk::CommandBufferAllocateInfo(commandPool, vk::CommandBufferLevel::ePrimary, 1))
                 .front());
   OneTimeSubmitNoWait(commandBuffer.get(), queue, func);
+  SVULKAN_PROFILE_SCOPE("OneTimeSubmit wait");
   queue.waitIdle();
 }
 
+/** Size in bytes of a single texel of a render target format, 0 if the format is not supported */
+uint32_t getFormatSize(vk::Format format);
+
+/** Whether the format is a depth format */
+bool isDepthFormat(vk::Format format);
+
+/** Whether the format is an unsigned integer format read through usampler */
+bool isIntegerFormat(vk::Format format);
+
 void transitionImageLayout(vk::CommandBuffer commandBuffer, vk::Image image, vk::Format format,
                            vk::ImageLayout oldImageLayout, vk::ImageLayout newImageLayout,
                            vk::AccessFlags sourceAccessMask, vk::AccessFlags destAccessMask,
                            vk::PipelineStageFlags sourceStage, vk::PipelineStageFlags destStage,
-                           vk::ImageAspectFlags aspectMask, uint32_t mipLevels=1);
+                           vk::ImageAspectFlags aspectMask, uint32_t mipLevels=1,
+                           uint32_t arrayLayers=1);
 
 
 void updateDescriptorSets(
@@ -17,6 +17,9 @@ class Object {
 
   bool mMarkedForRemove = false;
 
+  // static objects are not expected to move, their shadows are cached
+  bool mStatic = false;
+
   glm::mat4 mUserData{1};
 
 public:
@@ -57,6 +60,9 @@ public:
   inline void setObjectId(uint32_t id) { mObjectId = id; }
   inline uint32_t getObjectId() const { return mObjectId; }
 
+  inline void setStatic(bool isStatic) { mStatic = isStatic; }
+  inline bool isStatic() const { return mStatic; }
+
   inline void setSegmentId(uint32_t id) { mSegmentId = id; }
   inline uint32_t getSegmentId() const { return mSegmentId; }
 
@@ -0,0 +1,32 @@
+#pragma once
+#include "sapien_vulkan/internal/vulkan.h"
+
+namespace svulkan {
+class VulkanContext;
+
+/** A compute pipeline built from a single glsl/<name>.comp shader */
+class ComputePass {
+  VulkanContext *mContext;
+  vk::UniquePipelineLayout mPipelineLayout;
+  vk::UniquePipeline mPipeline;
+
+public:
+  ComputePass(VulkanContext &context);
+
+  ComputePass(ComputePass const &other) = delete;
+  ComputePass &operator=(ComputePass const &other) = delete;
+
+  ComputePass(ComputePass &&other) = default;
+  ComputePass &operator=(ComputePass &&other) = default;
+
+  /** specialization constants are assigned to constant_id 0, 1, 2... in order */
+  void initializePipeline(std::string const &shaderDir,
+                          std::vector<vk::DescriptorSetLayout> const &layouts,
+                          std::string const &shaderName, uint32_t pushConstantSize = 0,
+                          std::vector<uint32_t> const &specializationConstants = {});
+
+  inline vk::PipelineLayout getPipelineLayout() { return mPipelineLayout.get(); }
+  inline vk::Pipeline getPipeline() { return mPipeline.get(); }
+};
+
+} // namespace svulkan
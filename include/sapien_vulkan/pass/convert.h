@@ -0,0 +1,53 @@
+#pragma once
+#include "sapien_vulkan/common/glm_common.h"
+#include "sapien_vulkan/internal/vulkan.h"
+#include "sapien_vulkan/internal/vulkan_renderer_config.h"
+#include "sapien_vulkan/pass/compute.h"
+#include <map>
+
+namespace svulkan {
+class VulkanContext;
+struct VulkanImageData;
+
+/** Converts render targets into tightly packed buffers before they are read back, see
+ *  glsl/convert.glsl. A pipeline is created on first use of each source kind and
+ *  specialization. */
+class ConvertPass {
+  VulkanContext *mContext;
+  std::string mShaderDir;
+  vk::UniqueDescriptorSetLayout mDescriptorSetLayout;
+
+  // keyed by integer source, output type, linear depth and sRGB
+  std::map<std::tuple<bool, ConvertedType, bool, bool>, std::unique_ptr<ComputePass>> mPipelines;
+  // one set per conversion recorded into the same submission
+  std::vector<vk::UniqueDescriptorSet> mDescriptorSets;
+
+  ComputePass &getPipeline(bool integer, DownloadConversion const &conversion);
+
+public:
+  ConvertPass(VulkanContext &context);
+
+  ConvertPass(ConvertPass const &other) = delete;
+  ConvertPass &operator=(ConvertPass const &other) = delete;
+
+  ConvertPass(ConvertPass &&other) = default;
+  ConvertPass &operator=(ConvertPass &&other) = default;
+
+  void initializePipeline(std::string const &shaderDir);
+
+  static uint32_t getElementSize(ConvertedType type);
+  /** format describing the converted data of image */
+  static vk::Format getOutputFormat(DownloadConversion const &conversion,
+                                    VulkanImageData const &image);
+
+  /** Record the conversion of the first elementCount elements of image into buffer at offset,
+   *  with the index-th descriptor set. The image must be in ShaderReadOnlyOptimal and the
+   *  buffer range is written in whole 32-bit words. projections holds the inverse projection
+   *  of every tile and layer, tile-major, for linear depth. */
+  void record(vk::CommandBuffer commandBuffer, uint32_t index, VulkanImageData const &image,
+              vk::Sampler sampler, DownloadConversion const &conversion, vk::Extent2D tile,
+              uint32_t tileColumns, vk::DescriptorBufferInfo const &projections,
+              vk::Buffer buffer, vk::DeviceSize offset, uint32_t elementCount);
+};
+
+} // namespace svulkan
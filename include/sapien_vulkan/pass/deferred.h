@@ -29,7 +29,8 @@ public:
 
   void initializePipeline(std::string shaderDir,
                           std::vector<vk::DescriptorSetLayout> const &layouts,
-                          std::vector<vk::Format> const &outputFormats);
+                          std::vector<vk::Format> const &outputFormats,
+                          bool octahedralNormal = false, bool reconstructPosition = false);
 
   void initializeFramebuffer(std::vector<vk::ImageView> const &outputImageViews,
                              vk::Extent2D const &extent);
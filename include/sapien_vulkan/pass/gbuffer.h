@@ -23,7 +23,8 @@ public:
   void initializePipeline(std::string const &shaderDir,
                           std::vector<vk::DescriptorSetLayout> const &layouts,
                           std::vector<vk::Format> const &colorFormats, vk::Format depthFormat,
-                          vk::CullModeFlags cullMode, vk::FrontFace frontFace);
+                          vk::CullModeFlags cullMode, vk::FrontFace frontFace,
+                          bool octahedralNormal = false);
   void initializeFramebuffer(std::vector<vk::ImageView> const &colorImageViews,
                              vk::ImageView depthImageView, vk::Extent2D const &extent);
 
@@ -0,0 +1,68 @@
+#pragma once
+#include "sapien_vulkan/internal/vulkan.h"
+
+namespace svulkan {
+class VulkanContext;
+
+/** G-buffer, deferred lighting, transparency and composite as subpasses of one render pass.
+ *  Framebuffer attachments are the used G-buffer targets (albedo, position, specular, normal,
+ *  segmentation, custom...), followed by depth, lighting and the composite output. */
+class MergedPass {
+  VulkanContext *mContext;
+  vk::UniqueRenderPass mRenderPass;
+  vk::UniqueFramebuffer mFramebuffer;
+
+  vk::UniquePipelineLayout mGBufferPipelineLayout;
+  vk::UniquePipelineLayout mLightingPipelineLayout;
+  vk::UniquePipelineLayout mTransparencyPipelineLayout;
+  vk::UniquePipelineLayout mCompositePipelineLayout;
+
+  vk::UniquePipeline mGBufferPipeline;
+  vk::UniquePipeline mLightingPipeline;
+  vk::UniquePipeline mTransparencyPipeline;
+  vk::UniquePipeline mCompositePipeline;
+
+public:
+  MergedPass(VulkanContext &context);
+
+  MergedPass(MergedPass const &other) = delete;
+  MergedPass &operator=(MergedPass const &other) = delete;
+
+  MergedPass(MergedPass &&other) = default;
+  MergedPass &operator=(MergedPass &&other) = default;
+
+  /** gbufferFormats uses eUndefined for targets that are not kept; transient targets are
+   *  neither loaded nor stored. viewCount > 1 renders that many array layers at once with
+   *  multiview, each view reads its camera from an array in the camera UBO. */
+  void initializePipeline(std::string const &shaderDir,
+                          std::vector<vk::DescriptorSetLayout> const &geometryLayouts,
+                          std::vector<vk::DescriptorSetLayout> const &lightingLayouts,
+                          std::vector<vk::DescriptorSetLayout> const &compositeLayouts,
+                          std::vector<vk::Format> const &gbufferFormats,
+                          std::vector<bool> const &gbufferTransient, vk::Format depthFormat,
+                          vk::Format lightingFormat, bool lightingTransient,
+                          vk::CullModeFlags cullMode, vk::FrontFace frontFace,
+                          bool octahedralNormal, bool reconstructPosition,
+                          uint32_t viewCount = 1);
+  void initializeFramebuffer(std::vector<vk::ImageView> const &imageViews,
+                             vk::Extent2D const &extent);
+
+  inline vk::Framebuffer getFramebuffer() { return mFramebuffer.get(); }
+  inline vk::RenderPass getRenderPass() { return mRenderPass.get(); }
+
+  inline vk::PipelineLayout getGBufferPipelineLayout() { return mGBufferPipelineLayout.get(); }
+  inline vk::PipelineLayout getLightingPipelineLayout() { return mLightingPipelineLayout.get(); }
+  inline vk::PipelineLayout getTransparencyPipelineLayout() {
+    return mTransparencyPipelineLayout.get();
+  }
+  inline vk::PipelineLayout getCompositePipelineLayout() {
+    return mCompositePipelineLayout.get();
+  }
+
+  inline vk::Pipeline getGBufferPipeline() { return mGBufferPipeline.get(); }
+  inline vk::Pipeline getLightingPipeline() { return mLightingPipeline.get(); }
+  inline vk::Pipeline getTransparencyPipeline() { return mTransparencyPipeline.get(); }
+  inline vk::Pipeline getCompositePipeline() { return mCompositePipeline.get(); }
+};
+
+} // namespace svulkan
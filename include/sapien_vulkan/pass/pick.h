@@ -0,0 +1,40 @@
+#pragma once
+#include "sapien_vulkan/internal/vulkan.h"
+#include "sapien_vulkan/pass/compute.h"
+
+namespace svulkan {
+class VulkanContext;
+struct VulkanImageData;
+
+/** Gathers texels at a list of points from render targets, see glsl/pick.glsl. Every query
+ *  allocates its own descriptor sets so several can be in flight. Each pipeline is created
+ *  on its first query. */
+class PickPass {
+  VulkanContext *mContext;
+  std::string mShaderDir;
+  vk::UniqueDescriptorSetLayout mDescriptorSetLayout;
+  std::unique_ptr<ComputePass> mFloatPipeline;
+  std::unique_ptr<ComputePass> mUintPipeline;
+
+  ComputePass &getPipeline(bool integer);
+
+public:
+  PickPass(VulkanContext &context);
+
+  PickPass(PickPass const &other) = delete;
+  PickPass &operator=(PickPass const &other) = delete;
+
+  PickPass(PickPass &&other) = default;
+  PickPass &operator=(PickPass &&other) = default;
+
+  void initializePipeline(std::string const &shaderDir);
+
+  /** Record the gather of pointCount points from image into the values range, starting at
+   *  value outputOffset. The image must be in ShaderReadOnlyOptimal. */
+  vk::UniqueDescriptorSet record(vk::CommandBuffer commandBuffer, VulkanImageData const &image,
+                                 vk::Sampler sampler, vk::DescriptorBufferInfo const &points,
+                                 vk::DescriptorBufferInfo const &values, uint32_t pointCount,
+                                 uint32_t outputOffset);
+};
+
+} // namespace svulkan
@@ -0,0 +1,46 @@
+#pragma once
+#include "sapien_vulkan/internal/vulkan.h"
+
+namespace svulkan {
+class VulkanContext;
+
+/** Depth and optional segmentation without the G-buffer. Objects without alpha tested
+ *  materials are drawn with a vertex-only (depth) or trivial fragment (segmentation)
+ *  pipeline that does not use the material set. */
+class SensorPass {
+  VulkanContext *mContext;
+  vk::UniqueRenderPass mRenderPass;
+  vk::UniqueFramebuffer mFramebuffer;
+
+  vk::UniquePipelineLayout mPipelineLayout;
+  vk::UniquePipelineLayout mAlphaTestPipelineLayout;
+  vk::UniquePipeline mPipeline;
+  vk::UniquePipeline mAlphaTestPipeline;
+
+public:
+  SensorPass(VulkanContext &context);
+
+  SensorPass(SensorPass const &other) = delete;
+  SensorPass &operator=(SensorPass const &other) = delete;
+
+  SensorPass(SensorPass &&other) = default;
+  SensorPass &operator=(SensorPass &&other) = default;
+
+  /** layouts are scene, camera, object and material; segmentationFormat is eUndefined for a
+   *  depth-only pass */
+  void initializePipeline(std::string const &shaderDir,
+                          std::vector<vk::DescriptorSetLayout> const &layouts,
+                          vk::Format segmentationFormat, vk::Format depthFormat,
+                          vk::CullModeFlags cullMode, vk::FrontFace frontFace);
+  void initializeFramebuffer(std::vector<vk::ImageView> const &colorImageViews,
+                             vk::ImageView depthImageView, vk::Extent2D const &extent);
+
+  inline vk::Framebuffer getFramebuffer() { return mFramebuffer.get(); }
+  inline vk::RenderPass getRenderPass() { return mRenderPass.get(); }
+  inline vk::PipelineLayout getPipelineLayout() { return mPipelineLayout.get(); }
+  inline vk::PipelineLayout getAlphaTestPipelineLayout() { return mAlphaTestPipelineLayout.get(); }
+  inline vk::Pipeline getPipeline() { return mPipeline.get(); }
+  inline vk::Pipeline getAlphaTestPipeline() { return mAlphaTestPipeline.get(); }
+};
+
+} // namespace svulkan
@@ -0,0 +1,37 @@
+#pragma once
+#include "sapien_vulkan/internal/vulkan.h"
+
+namespace svulkan {
+class VulkanContext;
+
+/** Depth-only rendering of shadow casters into one layer of a shadow map array. The static
+ *  render pass clears and leaves the layer ready to be copied, the dynamic render pass keeps
+ *  the copied content and leaves the layer ready to be sampled. Both share one pipeline. */
+class ShadowPass {
+  VulkanContext *mContext;
+  vk::UniqueRenderPass mStaticRenderPass;
+  vk::UniqueRenderPass mDynamicRenderPass;
+
+  vk::UniquePipelineLayout mPipelineLayout;
+  vk::UniquePipeline mPipeline;
+
+public:
+  ShadowPass(VulkanContext &context);
+
+  ShadowPass(ShadowPass const &other) = delete;
+  ShadowPass &operator=(ShadowPass const &other) = delete;
+
+  ShadowPass(ShadowPass &&other) = default;
+  ShadowPass &operator=(ShadowPass &&other) = default;
+
+  /** objectLayout is bound at set 0, the light matrix is a vertex push constant */
+  void initializePipeline(std::string const &shaderDir, vk::DescriptorSetLayout objectLayout,
+                          vk::Format depthFormat);
+
+  inline vk::RenderPass getStaticRenderPass() { return mStaticRenderPass.get(); }
+  inline vk::RenderPass getDynamicRenderPass() { return mDynamicRenderPass.get(); }
+  inline vk::PipelineLayout getPipelineLayout() { return mPipelineLayout.get(); }
+  inline vk::Pipeline getPipeline() { return mPipeline.get(); }
+};
+
+} // namespace svulkan
@@ -23,6 +23,11 @@ class Scene {
 
   bool mNeedsForceRemove = false;
 
+  // static opaque objects and their transforms as of the last prepareObjectsForRender,
+  // mStaticVersion changes whenever this set does
+  std::vector<std::pair<Object *, glm::mat4>> mStaticSnapshot {};
+  uint64_t mStaticVersion = 0;
+
  public:
   Scene(std::unique_ptr<VulkanScene> vulkanScene);
 
@@ -34,6 +39,8 @@ class Scene {
   inline const std::vector<std::unique_ptr<Object>> &getObjects() const { return objects; }
   inline const std::vector<Object *> &getOpaqueObjects() const { return opaque_objects; }
   inline const std::vector<Object *> &getTransparentObjects() const { return transparent_objects; }
+  /* changes when a static object is added, removed, moved or its static flag changes */
+  inline uint64_t getStaticVersion() const { return mStaticVersion; }
 
   void addObject(std::unique_ptr<Object> obj);
   /*  mark an object for removal */
@@ -10,6 +10,9 @@ struct CameraUBO {
   glm::mat4 projectionMatrixInverse;
 };
 
+// cameras rendered together with multiview, must match MAX_VIEWS in the *_multiview shaders
+constexpr uint32_t MaxCameraViews = 16;
+
 struct PBRMaterialUBO {
   glm::vec4 baseColor{0.3, 0.3, 0.3, 1};
   float specular{0};
@@ -28,12 +31,25 @@ struct ObjectUBO {
   glm::mat4 userData;
 };
 
-constexpr int NumDirectionalLights = 3;
-constexpr int NumPointLights = 10;
+// lights themselves live in storage buffers next to the scene UBO
 struct SceneUBO {
   glm::vec4 ambientLight;
-  DirectionalLight directionalLights[NumDirectionalLights];
-  PointLight pointLights[NumPointLights];
+  uint32_t numDirectionalLights;
+  uint32_t numPointLights;
+};
+
+// shadow map array layers: cascades of the first directional light, then 6 faces per point light
+constexpr uint32_t MaxShadowCascades = 4;
+constexpr uint32_t MaxShadowPointLights = 4;
+constexpr uint32_t MaxShadowLayers = MaxShadowCascades + 6 * MaxShadowPointLights;
+
+struct ShadowUBO {
+  glm::mat4 lightMatrices[MaxShadowLayers];
+  glm::vec4 cascadeSplits; // view space distance where each cascade ends
+  uint32_t numCascades;
+  uint32_t numPointLightShadows;
+  float texelSize;
+  uint32_t padding;
 };
 
 } // namespace svulkan
@@ -1,4 +1,5 @@
 #include "sapien_vulkan/camera.h"
+#include "sapien_vulkan/common/profiler.h"
 
 namespace svulkan
 {
@@ -11,12 +12,14 @@ Camera::Camera(vk::PhysicalDevice physicalDevice, vk::Device device, vk::Descrip
   mDescriptorSet = std::move(
       device.allocateDescriptorSetsUnique(vk::DescriptorSetAllocateInfo(descriptorPool, 1, &descriptorLayout))
       .front());
+  mDescriptorSetRecord = DescriptorSetRecord(device);
 
   updateDescriptorSets(device, mDescriptorSet.get(),
                        {{vk::DescriptorType::eUniformBuffer, mUBO.mBuffer.get(), vk::BufferView()}}, {}, 0);
 }
 
 void Camera::updateUBO() {
+  SVULKAN_PROFILE_SCOPE("Camera::updateUBO");
   copyToDevice<CameraUBO>(
       mDevice, mUBO.mMemory.get(),
       {getViewMat(), getProjectionMat(), glm::inverse(getViewMat()), glm::inverse(getProjectionMat())});
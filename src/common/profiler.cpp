@@ -0,0 +1,239 @@
+#include "sapien_vulkan/common/profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace svulkan {
+namespace profiler {
+
+std::atomic<bool> gEnabled{false};
+
+namespace {
+
+struct Event {
+  char const *name;
+  int64_t begin;
+  int64_t end;
+};
+
+/** Ring of the events of one thread or track. The mutex is only contended while exporting. */
+struct EventBuffer {
+  std::mutex mutex;
+  uint32_t id;
+  std::string name;
+  bool track{false};
+  std::vector<Event> events;
+  uint64_t written{0};
+
+  void push(Event const &event) {
+    std::lock_guard<std::mutex> lock(mutex);
+    events[written % events.size()] = event;
+    ++written;
+  }
+};
+
+struct Registry {
+  std::mutex mutex;
+  uint32_t capacity{16384};
+  uint32_t nextId{1};
+  std::vector<std::shared_ptr<EventBuffer>> buffers;
+  std::map<std::string, std::shared_ptr<EventBuffer>> tracks;
+  std::unordered_set<std::string> names; // event names of tracks, never freed
+
+  std::shared_ptr<EventBuffer> createBuffer(std::string const &name) {
+    auto buffer = std::make_shared<EventBuffer>();
+    buffer->id = nextId++;
+    buffer->name = name.empty() ? "thread " + std::to_string(buffer->id) : name;
+    buffer->events.resize(capacity);
+    buffers.push_back(buffer);
+    return buffer;
+  }
+};
+
+} // namespace
+
+static Registry &getRegistry() {
+  static Registry registry;
+  return registry;
+}
+
+// buffers outlive their threads so events of finished threads can still be exported
+static EventBuffer &getThreadBuffer() {
+  thread_local std::shared_ptr<EventBuffer> buffer = [] {
+    auto &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    return registry.createBuffer("");
+  }();
+  return *buffer;
+}
+
+void setEnabled(bool enabled) { gEnabled.store(enabled, std::memory_order_relaxed); }
+
+int64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void setThreadName(std::string const &name) {
+  auto &buffer = getThreadBuffer();
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  buffer.name = name;
+}
+
+void setThreadCapacity(uint32_t capacity) {
+  auto &registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.capacity = std::max(capacity, 1u);
+}
+
+void record(char const *name, int64_t begin, int64_t end) {
+  getThreadBuffer().push({name, begin, end});
+}
+
+void recordTrack(std::string const &track, std::string const &name, int64_t begin,
+                 int64_t end) {
+  auto &registry = getRegistry();
+  std::shared_ptr<EventBuffer> buffer;
+  char const *interned;
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto &slot = registry.tracks[track];
+    if (!slot) {
+      slot = registry.createBuffer(track);
+      slot->track = true;
+    }
+    buffer = slot;
+    interned = registry.names.insert(name).first->c_str();
+  }
+  buffer->push({interned, begin, end});
+}
+
+void clear() {
+  auto &registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (auto &buffer : registry.buffers) {
+    std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+    buffer->written = 0;
+  }
+}
+
+std::vector<ScopeSummary> summarize() {
+  std::map<std::string, ScopeSummary> summaries;
+  auto &registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (auto &buffer : registry.buffers) {
+    if (buffer->track) {
+      continue;
+    }
+    std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+    uint64_t size = buffer->events.size();
+    uint64_t first = buffer->written > size ? buffer->written - size : 0;
+    for (uint64_t i = first; i < buffer->written; ++i) {
+      auto &event = buffer->events[i % size];
+      auto &summary = summaries[event.name];
+      double milliseconds = (event.end - event.begin) * 1e-6;
+      summary.count += 1;
+      summary.totalMilliseconds += milliseconds;
+      summary.maxMilliseconds = std::max(summary.maxMilliseconds, milliseconds);
+    }
+  }
+
+  std::vector<ScopeSummary> result;
+  for (auto &[name, summary] : summaries) {
+    result.push_back(summary);
+    result.back().name = name;
+  }
+  std::sort(result.begin(), result.end(), [](auto const &a, auto const &b) {
+    return a.totalMilliseconds > b.totalMilliseconds;
+  });
+  return result;
+}
+
+static void writeJsonString(std::string &out, char const *str) {
+  out += '"';
+  for (; *str; ++str) {
+    char c = *str;
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out += escaped;
+    } else {
+      out += c;
+    }
+  }
+  out += '"';
+}
+
+std::string exportChromeTrace() {
+  struct Thread {
+    uint32_t id;
+    std::string name;
+    std::vector<Event> events;
+  };
+  std::vector<Thread> threads;
+  {
+    auto &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (auto &buffer : registry.buffers) {
+      std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+      Thread thread{buffer->id, buffer->name, {}};
+      uint64_t size = buffer->events.size();
+      uint64_t first = buffer->written > size ? buffer->written - size : 0;
+      for (uint64_t i = first; i < buffer->written; ++i) {
+        thread.events.push_back(buffer->events[i % size]);
+      }
+      threads.push_back(std::move(thread));
+    }
+  }
+
+  // timestamps relative to the first event keep the numbers short
+  int64_t origin = INT64_MAX;
+  for (auto &thread : threads) {
+    for (auto &event : thread.events) {
+      origin = std::min(origin, event.begin);
+    }
+  }
+
+  std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  char number[64];
+  for (auto &thread : threads) {
+    out += first ? "\n" : ",\n";
+    first = false;
+    out += "{\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(thread.id) +
+           ",\"name\":\"thread_name\",\"args\":{\"name\":";
+    writeJsonString(out, thread.name.c_str());
+    out += "}}";
+    for (auto &event : thread.events) {
+      out += ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(thread.id) + ",\"name\":";
+      writeJsonString(out, event.name);
+      snprintf(number, sizeof(number), ",\"ts\":%.3f,\"dur\":%.3f}",
+               (event.begin - origin) * 1e-3, (event.end - event.begin) * 1e-3);
+      out += number;
+    }
+  }
+  out += "\n]}\n";
+  return out;
+}
+
+bool writeChromeTrace(std::string const &filename) {
+  std::ofstream file(filename, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  file << exportChromeTrace();
+  return static_cast<bool>(file);
+}
+
+} // namespace profiler
+} // namespace svulkan
@@ -0,0 +1,502 @@
+#include "sapien_vulkan/frame_writer.h"
+#include "sapien_vulkan/common/log.h"
+#include "sapien_vulkan/common/profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "sapien_vulkan/common/stb_image_write.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace svulkan {
+
+namespace {
+
+enum class ChannelKind { eFloat, eUnorm, eUint };
+
+struct FormatInfo {
+  uint32_t channels{0}; // 0 for formats that cannot be written
+  uint32_t channelSize{0};
+  ChannelKind kind{ChannelKind::eFloat};
+};
+
+} // namespace
+
+static FormatInfo getFormatInfo(vk::Format format) {
+  switch (format) {
+  case vk::Format::eR32Sfloat:
+  case vk::Format::eD32Sfloat:
+    return {1, 4, ChannelKind::eFloat};
+  case vk::Format::eR32G32Sfloat:
+    return {2, 4, ChannelKind::eFloat};
+  case vk::Format::eR32G32B32Sfloat:
+    return {3, 4, ChannelKind::eFloat};
+  case vk::Format::eR32G32B32A32Sfloat:
+    return {4, 4, ChannelKind::eFloat};
+  case vk::Format::eR8Unorm:
+    return {1, 1, ChannelKind::eUnorm};
+  case vk::Format::eR8G8Unorm:
+    return {2, 1, ChannelKind::eUnorm};
+  case vk::Format::eR8G8B8Unorm:
+    return {3, 1, ChannelKind::eUnorm};
+  case vk::Format::eR8G8B8A8Unorm:
+  case vk::Format::eR8G8B8A8Srgb:
+    return {4, 1, ChannelKind::eUnorm};
+  case vk::Format::eR16Unorm:
+    return {1, 2, ChannelKind::eUnorm};
+  case vk::Format::eR16G16Unorm:
+    return {2, 2, ChannelKind::eUnorm};
+  case vk::Format::eR16G16B16Unorm:
+    return {3, 2, ChannelKind::eUnorm};
+  case vk::Format::eR16G16B16A16Unorm:
+    return {4, 2, ChannelKind::eUnorm};
+  case vk::Format::eR8Uint:
+    return {1, 1, ChannelKind::eUint};
+  case vk::Format::eR8G8Uint:
+    return {2, 1, ChannelKind::eUint};
+  case vk::Format::eR8G8B8Uint:
+    return {3, 1, ChannelKind::eUint};
+  case vk::Format::eR8G8B8A8Uint:
+    return {4, 1, ChannelKind::eUint};
+  case vk::Format::eR16Uint:
+    return {1, 2, ChannelKind::eUint};
+  case vk::Format::eR16G16Uint:
+    return {2, 2, ChannelKind::eUint};
+  case vk::Format::eR16G16B16Uint:
+    return {3, 2, ChannelKind::eUint};
+  case vk::Format::eR16G16B16A16Uint:
+    return {4, 2, ChannelKind::eUint};
+  case vk::Format::eR32Uint:
+    return {1, 4, ChannelKind::eUint};
+  case vk::Format::eR32G32Uint:
+    return {2, 4, ChannelKind::eUint};
+  case vk::Format::eR32G32B32Uint:
+    return {3, 4, ChannelKind::eUint};
+  case vk::Format::eR32G32B32A32Uint:
+    return {4, 4, ChannelKind::eUint};
+  default:
+    // half floats (compact lighting) are converted on the GPU with downloadConverted
+    return {};
+  }
+}
+
+// the conversion an image is written with, eAuto only remains for raw source data
+static ImageConversion resolveConversion(FrameImage const &image, FormatInfo const &info) {
+  if (image.conversion != ImageConversion::eAuto || image.encoding != ImageEncoding::ePng) {
+    return image.conversion;
+  }
+  if (info.kind == ChannelKind::eUint && info.channelSize == 4) {
+    return ImageConversion::ePalette;
+  }
+  if (info.kind == ChannelKind::eFloat) {
+    return info.channels == 1 ? ImageConversion::eUint16 : ImageConversion::eUint8;
+  }
+  return info.channelSize == 1 ? ImageConversion::eUint8 : ImageConversion::eUint16;
+}
+
+static void validate(VulkanDownloadedTargets const &targets, vk::Extent2D extent,
+                     std::vector<FrameImage> const &images) {
+  for (auto &image : images) {
+    if (image.target >= targets.count()) {
+      throw std::runtime_error("Frame image " + image.filename + ": invalid target index");
+    }
+    auto info = getFormatInfo(targets.format(image.target));
+    if (info.channels == 0) {
+      throw std::runtime_error("Frame image " + image.filename +
+                               ": unsupported format, convert it with downloadConverted");
+    }
+    size_t imageSize = size_t(extent.width) * extent.height * info.channels * info.channelSize;
+    if ((image.image + 1) * imageSize > targets.size(image.target)) {
+      throw std::runtime_error("Frame image " + image.filename + ": image index out of range");
+    }
+    if (image.channels > info.channels || image.channel >= info.channels) {
+      throw std::runtime_error("Frame image " + image.filename + ": invalid channels");
+    }
+
+    auto conversion = resolveConversion(image, info);
+    bool integer = info.kind == ChannelKind::eUint && info.channelSize == 4;
+    bool valid = true;
+    switch (conversion) {
+    case ImageConversion::eAuto:
+      valid = image.encoding != ImageEncoding::ePng;
+      break;
+    case ImageConversion::eUint8:
+      valid = info.kind == ChannelKind::eFloat || integer || info.channelSize == 1;
+      break;
+    case ImageConversion::eUint16:
+      valid = info.kind == ChannelKind::eFloat || integer || info.channelSize == 2;
+      break;
+    case ImageConversion::ePalette:
+      valid = integer;
+      break;
+    }
+    if (image.encoding == ImageEncoding::eHdr) {
+      valid = conversion == ImageConversion::eAuto && info.kind == ChannelKind::eFloat;
+    }
+    if (!valid) {
+      throw std::runtime_error("Frame image " + image.filename +
+                               ": conversion does not apply to this target");
+    }
+  }
+}
+
+// value * scale clamped to [0, 255] and rounded to nearest
+static void floatToUint8(float const *source, uint8_t *destination, size_t count, float scale) {
+  size_t i = 0;
+#ifdef __SSE2__
+  __m128 s = _mm_set1_ps(scale);
+  __m128 lower = _mm_setzero_ps();
+  __m128 upper = _mm_set1_ps(255.f);
+  auto convert = [&](float const *p) {
+    // max returns its second operand for NaN, so NaN becomes 0
+    return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(p), s), lower), upper));
+  };
+  for (; i + 16 <= count; i += 16) {
+    __m128i a = _mm_packs_epi32(convert(source + i), convert(source + i + 4));
+    __m128i b = _mm_packs_epi32(convert(source + i + 8), convert(source + i + 12));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i), _mm_packus_epi16(a, b));
+  }
+#endif
+  for (; i < count; ++i) {
+    float value = source[i] * scale;
+    value = value > 0.f ? std::min(value, 255.f) : 0.f;
+    destination[i] = static_cast<uint8_t>(std::nearbyint(value));
+  }
+}
+
+// value * scale clamped to [0, 65535] and rounded to nearest
+static void floatToUint16(float const *source, uint16_t *destination, size_t count,
+                          float scale) {
+  size_t i = 0;
+#ifdef __SSE2__
+  __m128 s = _mm_set1_ps(scale);
+  __m128 lower = _mm_setzero_ps();
+  __m128 upper = _mm_set1_ps(65535.f);
+  __m128i bias = _mm_set1_epi32(32768);
+  __m128i flip = _mm_set1_epi16(-32768);
+  auto convert = [&](float const *p) {
+    // SSE2 only packs to signed 16 bit, so shift into its range and flip the sign bit back
+    return _mm_sub_epi32(
+        _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(p), s), lower), upper)),
+        bias);
+  };
+  for (; i + 8 <= count; i += 8) {
+    __m128i packed = _mm_packs_epi32(convert(source + i), convert(source + i + 4));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i),
+                     _mm_xor_si128(packed, flip));
+  }
+#endif
+  for (; i < count; ++i) {
+    float value = source[i] * scale;
+    value = value > 0.f ? std::min(value, 65535.f) : 0.f;
+    destination[i] = static_cast<uint16_t>(std::nearbyint(value));
+  }
+}
+
+// keep the leading channels of each pixel, destination may be source
+template <typename T>
+static void selectChannels(T const *source, T *destination, size_t pixelCount,
+                           uint32_t sourceChannels, uint32_t channels) {
+  for (size_t i = 0; i < pixelCount; ++i) {
+    for (uint32_t c = 0; c < channels; ++c) {
+      destination[i * channels + c] = source[i * sourceChannels + c];
+    }
+  }
+}
+
+template <typename T>
+static void saturateChannel(uint32_t const *source, T *destination, size_t pixelCount,
+                            uint32_t sourceChannels, uint32_t channel) {
+  constexpr uint32_t maximum = std::numeric_limits<T>::max();
+  for (size_t i = 0; i < pixelCount; ++i) {
+    destination[i] = static_cast<T>(std::min(source[i * sourceChannels + channel], maximum));
+  }
+}
+
+// distinct, stable colors for ids, 0 (background) is black
+static void paletteColors(uint32_t const *source, uint8_t *destination, size_t pixelCount,
+                          uint32_t sourceChannels, uint32_t channel) {
+  for (size_t i = 0; i < pixelCount; ++i) {
+    uint32_t id = source[i * sourceChannels + channel];
+    uint32_t h = id * 2654435761u;
+    h ^= h >> 15;
+    h = id == 0 ? 0 : h | 0x404040;
+    destination[3 * i] = h & 0xff;
+    destination[3 * i + 1] = (h >> 8) & 0xff;
+    destination[3 * i + 2] = (h >> 16) & 0xff;
+  }
+}
+
+static void appendBigEndian(std::vector<unsigned char> &data, uint32_t value) {
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    data.push_back((value >> shift) & 0xff);
+  }
+}
+
+static void appendChunk(std::vector<unsigned char> &png, char const *type,
+                        unsigned char const *data, uint32_t length) {
+  appendBigEndian(png, length);
+  size_t start = png.size();
+  png.insert(png.end(), type, type + 4);
+  png.insert(png.end(), data, data + length);
+  appendBigEndian(png, stbiw__crc32(png.data() + start, static_cast<int>(length + 4)));
+}
+
+// stb_image_write only writes 8 bit PNGs, 16 bit ones reuse its deflate with the Sub filter
+static std::vector<unsigned char> encodePng16(uint16_t const *data, uint32_t width,
+                                              uint32_t height, uint32_t channels) {
+  size_t rowSize = size_t(width) * channels * 2;
+  size_t bpp = channels * 2;
+  std::vector<unsigned char> filtered((rowSize + 1) * height);
+  for (uint32_t y = 0; y < height; ++y) {
+    unsigned char *row = filtered.data() + y * (rowSize + 1);
+    row[0] = 1;
+    unsigned char *bytes = row + 1;
+    uint16_t const *values = data + size_t(y) * width * channels;
+    for (size_t i = 0; i < size_t(width) * channels; ++i) {
+      bytes[2 * i] = values[i] >> 8;
+      bytes[2 * i + 1] = values[i] & 0xff;
+    }
+    for (size_t i = rowSize; i-- > bpp;) {
+      bytes[i] -= bytes[i - bpp];
+    }
+  }
+
+  int compressedSize;
+  unsigned char *compressed =
+      stbi_zlib_compress(filtered.data(), static_cast<int>(filtered.size()), &compressedSize,
+                         stbi_write_png_compression_level);
+  if (!compressed) {
+    return {};
+  }
+
+  static const unsigned char colorTypes[4] = {0, 4, 2, 6};
+  std::vector<unsigned char> header;
+  appendBigEndian(header, width);
+  appendBigEndian(header, height);
+  header.insert(header.end(), {16, colorTypes[channels - 1], 0, 0, 0});
+
+  std::vector<unsigned char> png = {137, 80, 78, 71, 13, 10, 26, 10};
+  appendChunk(png, "IHDR", header.data(), static_cast<uint32_t>(header.size()));
+  appendChunk(png, "IDAT", compressed, compressedSize);
+  appendChunk(png, "IEND", nullptr, 0);
+  STBIW_FREE(compressed);
+  return png;
+}
+
+static void writeFile(std::string const &filename, void const *data, size_t size) {
+  std::ofstream file(filename, std::ios::binary);
+  file.write(static_cast<char const *>(data), size);
+  if (!file) {
+    throw std::runtime_error("failed to write file " + filename);
+  }
+}
+
+FrameWriter::FrameWriter(uint32_t threadCount, uint32_t maxPendingFrames)
+    : mMaxPendingFrames(std::max(maxPendingFrames, 1u)) {
+  if (threadCount == 0) {
+    threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+  }
+  for (uint32_t i = 0; i < threadCount; ++i) {
+    mWorkers.emplace_back(&FrameWriter::work, this);
+  }
+}
+
+FrameWriter::~FrameWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+  }
+  mJobAvailable.notify_all();
+  for (auto &worker : mWorkers) {
+    worker.join();
+  }
+}
+
+void FrameWriter::enqueue(VulkanDownloadedTargets targets, vk::Extent2D extent,
+                          std::vector<FrameImage> images) {
+  auto frame = std::make_shared<Frame>(std::move(targets), extent,
+                                       static_cast<uint32_t>(images.size()));
+  ++mPendingFrames;
+  for (auto &image : images) {
+    mJobs.push_back({frame, std::move(image)});
+  }
+  mJobAvailable.notify_all();
+}
+
+void FrameWriter::write(VulkanDownloadedTargets targets, vk::Extent2D extent,
+                        std::vector<FrameImage> images) {
+  validate(targets, extent, images);
+  if (images.empty()) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mMutex);
+  mFrameDone.wait(lock, [this] { return mPendingFrames < mMaxPendingFrames; });
+  enqueue(std::move(targets), extent, std::move(images));
+}
+
+bool FrameWriter::tryWrite(VulkanDownloadedTargets &targets, vk::Extent2D extent,
+                           std::vector<FrameImage> images) {
+  validate(targets, extent, images);
+  std::lock_guard<std::mutex> lock(mMutex);
+  if (mPendingFrames >= mMaxPendingFrames) {
+    return false;
+  }
+  if (!images.empty()) {
+    enqueue(std::move(targets), extent, std::move(images));
+  }
+  return true;
+}
+
+void FrameWriter::flush() {
+  std::unique_lock<std::mutex> lock(mMutex);
+  mFrameDone.wait(lock, [this] { return mPendingFrames == 0; });
+}
+
+uint32_t FrameWriter::getPendingFrames() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mPendingFrames;
+}
+
+void FrameWriter::work() {
+  profiler::setThreadName("frame writer");
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mJobAvailable.wait(lock, [this] { return mStopping || !mJobs.empty(); });
+      if (mJobs.empty()) {
+        return;
+      }
+      job = std::move(mJobs.front());
+      mJobs.pop_front();
+    }
+
+    try {
+      writeImage(*job.frame, job.image);
+    } catch (std::exception const &e) {
+      log::error("Failed to write {}: {}", job.image.filename, e.what());
+      ++mFailureCount;
+    }
+
+    if (--job.frame->remaining == 0) {
+      // recycles the staging buffer before another frame may be queued
+      job.frame.reset();
+      {
+        std::lock_guard<std::mutex> lock(mMutex);
+        --mPendingFrames;
+      }
+      mFrameDone.notify_all();
+    }
+  }
+}
+
+void FrameWriter::writeImage(Frame const &frame, FrameImage const &image) {
+  SVULKAN_PROFILE_SCOPE("FrameWriter::writeImage");
+  auto info = getFormatInfo(frame.targets.format(image.target));
+  uint32_t width = frame.extent.width;
+  uint32_t height = frame.extent.height;
+  size_t pixelCount = size_t(width) * height;
+  size_t valueCount = pixelCount * info.channels;
+  char const *source =
+      frame.targets.data(image.target) + image.image * valueCount * info.channelSize;
+  uint32_t channels = image.channels ? image.channels : info.channels;
+
+  if (image.encoding == ImageEncoding::eHdr) {
+    std::vector<float> values(valueCount);
+    auto floats = reinterpret_cast<float const *>(source);
+    std::transform(floats, floats + valueCount, values.begin(),
+                   [&](float value) { return value * image.scale; });
+    selectChannels(values.data(), values.data(), pixelCount, info.channels, channels);
+    if (!stbi_write_hdr(image.filename.c_str(), width, height, channels, values.data())) {
+      throw std::runtime_error("failed to write file " + image.filename);
+    }
+    return;
+  }
+
+  // converted data, or the source itself when it is written unchanged
+  std::vector<char> buffer;
+  void const *data = source;
+  uint32_t channelSize = info.channelSize;
+  bool integer = info.kind == ChannelKind::eUint && info.channelSize == 4;
+  auto integers = reinterpret_cast<uint32_t const *>(source);
+
+  auto conversion = resolveConversion(image, info);
+  switch (conversion) {
+  case ImageConversion::eAuto:
+    channels = info.channels;
+    break;
+  case ImageConversion::eUint8:
+  case ImageConversion::eUint16:
+    channelSize = conversion == ImageConversion::eUint8 ? 1 : 2;
+    if (integer) {
+      channels = 1;
+      buffer.resize(pixelCount * channelSize);
+      if (channelSize == 1) {
+        saturateChannel(integers, reinterpret_cast<uint8_t *>(buffer.data()), pixelCount,
+                        info.channels, image.channel);
+      } else {
+        saturateChannel(integers, reinterpret_cast<uint16_t *>(buffer.data()), pixelCount,
+                        info.channels, image.channel);
+      }
+    } else if (info.kind == ChannelKind::eFloat) {
+      buffer.resize(valueCount * channelSize);
+      auto floats = reinterpret_cast<float const *>(source);
+      if (channelSize == 1) {
+        auto values = reinterpret_cast<uint8_t *>(buffer.data());
+        floatToUint8(floats, values, valueCount, image.scale * 255.f);
+        selectChannels(values, values, pixelCount, info.channels, channels);
+      } else {
+        auto values = reinterpret_cast<uint16_t *>(buffer.data());
+        floatToUint16(floats, values, valueCount, image.scale * 65535.f);
+        selectChannels(values, values, pixelCount, info.channels, channels);
+      }
+    } else if (channels != info.channels) {
+      buffer.resize(pixelCount * channels * channelSize);
+      if (channelSize == 1) {
+        selectChannels(reinterpret_cast<uint8_t const *>(source),
+                       reinterpret_cast<uint8_t *>(buffer.data()), pixelCount, info.channels,
+                       channels);
+      } else {
+        selectChannels(reinterpret_cast<uint16_t const *>(source),
+                       reinterpret_cast<uint16_t *>(buffer.data()), pixelCount, info.channels,
+                       channels);
+      }
+    }
+    if (!buffer.empty()) {
+      data = buffer.data();
+    }
+    break;
+  case ImageConversion::ePalette:
+    channels = 3;
+    channelSize = 1;
+    buffer.resize(pixelCount * 3);
+    paletteColors(integers, reinterpret_cast<uint8_t *>(buffer.data()), pixelCount,
+                  info.channels, image.channel);
+    data = buffer.data();
+    break;
+  }
+
+  size_t size = pixelCount * channels * channelSize;
+  if (image.encoding == ImageEncoding::eRaw) {
+    writeFile(image.filename, data, size);
+  } else if (channelSize == 1) {
+    if (!stbi_write_png(image.filename.c_str(), width, height, channels, data,
+                        width * channels)) {
+      throw std::runtime_error("failed to write file " + image.filename);
+    }
+  } else {
+    auto png = encodePng16(static_cast<uint16_t const *>(data), width, height, channels);
+    if (png.empty()) {
+      throw std::runtime_error("failed to encode " + image.filename);
+    }
+    writeFile(image.filename, png.data(), png.size());
+  }
+}
+
+} // namespace svulkan
@@ -324,4 +324,62 @@ VulkanWindow::~VulkanWindow() {
   glfwDestroyWindow(mWindow);
 }
 
+void drawPassTimings(std::vector<PassTiming> const &timings) {
+  ImGui::Begin("GPU Passes");
+  if (timings.empty()) {
+    ImGui::Text("Pass timers are disabled");
+  } else {
+    ImGui::Columns(3);
+    ImGui::Text("Pass");
+    ImGui::NextColumn();
+    ImGui::Text("Last (ms)");
+    ImGui::NextColumn();
+    ImGui::Text("Average (ms)");
+    ImGui::NextColumn();
+    ImGui::Separator();
+    for (auto &timing : timings) {
+      ImGui::Text("%s", timing.name.c_str());
+      ImGui::NextColumn();
+      ImGui::Text("%.3f", timing.lastMilliseconds);
+      ImGui::NextColumn();
+      ImGui::Text("%.3f", timing.averageMilliseconds);
+      ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+  }
+  ImGui::End();
+}
+
+void drawRenderStats(RenderStats const &stats) {
+  ImGui::Begin("Render Stats");
+  ImGui::Text("Uploaded: %.1f KB", stats.uploadedBytes / 1024.0);
+  ImGui::Columns(6);
+  for (char const *header : {"Pass", "Draws", "Triangles", "Pipelines", "Sets", "Barriers"}) {
+    ImGui::Text("%s", header);
+    ImGui::NextColumn();
+  }
+  ImGui::Separator();
+  auto drawRow = [](PassStats const &pass) {
+    ImGui::Text("%s", pass.name.c_str());
+    ImGui::NextColumn();
+    ImGui::Text("%u", pass.drawCalls);
+    ImGui::NextColumn();
+    ImGui::Text("%llu", static_cast<unsigned long long>(pass.triangles));
+    ImGui::NextColumn();
+    ImGui::Text("%u", pass.pipelineBinds);
+    ImGui::NextColumn();
+    ImGui::Text("%u", pass.descriptorSetBinds);
+    ImGui::NextColumn();
+    ImGui::Text("%u", pass.barriers);
+    ImGui::NextColumn();
+  };
+  for (auto &pass : stats.passes) {
+    drawRow(pass);
+  }
+  ImGui::Separator();
+  drawRow(stats.total);
+  ImGui::Columns(1);
+  ImGui::End();
+}
+
 }
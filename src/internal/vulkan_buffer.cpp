@@ -7,8 +7,12 @@ VulkanBufferData::VulkanBufferData(vk::PhysicalDevice physicalDevice, vk::Device
                  vk::BufferUsageFlags usage,
                  vk::MemoryPropertyFlags propertyFlags) {
   mBuffer = device.createBufferUnique(vk::BufferCreateInfo(vk::BufferCreateFlags(), size, usage));
-  mMemory = allocateMemory(device, physicalDevice.getMemoryProperties(),
-                           device.getBufferMemoryRequirements(mBuffer.get()), propertyFlags);
+  vk::MemoryRequirements requirements = device.getBufferMemoryRequirements(mBuffer.get());
+  mMemory = allocateMemory(device, physicalDevice.getMemoryProperties(), requirements,
+                           propertyFlags);
+  bool deviceLocal = static_cast<bool>(propertyFlags & vk::MemoryPropertyFlagBits::eDeviceLocal);
+  mMemoryRecord = MemoryRecord(device, getBufferMemoryCategory(usage, propertyFlags),
+                               requirements.size, deviceLocal);
   device.bindBufferMemory(mBuffer.get(), mMemory.get(), 0);
 
 #if !defined(NDEBUG)
@@ -12,21 +12,30 @@
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <iostream>
 
 #include <vulkan/vulkan_beta.h>
 
 namespace svulkan {
 
+#ifdef ON_SCREEN
 static void glfwErrorCallback(int error_code, const char *description) {
   log::error("GLFW error: {}", description);
 }
+#endif
 
-VulkanContext::VulkanContext(bool requirePresent, uint32_t objectBufferSize)
+VulkanContext::VulkanContext(bool requirePresent, uint32_t objectBufferSize,
+                             std::string const &device)
     : mRequirePresent(requirePresent), mObjectBufferSize(objectBufferSize),
       mResourcesManager(*this) {
+#ifndef ON_SCREEN
+  mRequirePresent = false;
+#endif
   createInstance();
-  pickPhysicalDevice();
+  pickPhysicalDevice(device);
   createLogicalDevice();
   createCommandPool();
   createDescriptorPool();
@@ -116,13 +125,116 @@ void VulkanContext::createInstance() {
   }
 #endif
 
+  // names and labels for external tools, the loader provides the extension on most systems
+  bool debugUtils = false;
+  for (auto &p : extensionProperties) {
+    debugUtils = debugUtils || strcmp(p.extensionName, VK_EXT_DEBUG_UTILS_EXTENSION_NAME) == 0;
+  }
+  if (debugUtils) {
+    instanceExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+  }
+
   vk::InstanceCreateInfo createInfo({}, &appInfo, enabledLayers.size(), enabledLayers.data(),
                                     instanceExtensions.size(), instanceExtensions.data());
 
   mInstance = vk::createInstanceUnique(createInfo);
+
+  if (debugUtils) {
+    mSetDebugUtilsObjectName = reinterpret_cast<PFN_vkSetDebugUtilsObjectNameEXT>(
+        mInstance->getProcAddr("vkSetDebugUtilsObjectNameEXT"));
+    mCmdBeginDebugUtilsLabel = reinterpret_cast<PFN_vkCmdBeginDebugUtilsLabelEXT>(
+        mInstance->getProcAddr("vkCmdBeginDebugUtilsLabelEXT"));
+    mCmdEndDebugUtilsLabel = reinterpret_cast<PFN_vkCmdEndDebugUtilsLabelEXT>(
+        mInstance->getProcAddr("vkCmdEndDebugUtilsLabelEXT"));
+    mDebugUtils =
+        mSetDebugUtilsObjectName && mCmdBeginDebugUtilsLabel && mCmdEndDebugUtilsLabel;
+  }
+  log::info("Debug utils {}", mDebugUtils ? "enabled" : "not available");
+}
+
+void VulkanContext::setDebugUtilsEnabled(bool enabled) {
+  mDebugUtils = enabled && mSetDebugUtilsObjectName && mCmdBeginDebugUtilsLabel &&
+                mCmdEndDebugUtilsLabel;
+}
+
+void VulkanContext::setDebugName(vk::ObjectType type, uint64_t handle,
+                                 std::string const &name) const {
+  if (!mDebugUtils || !handle) {
+    return;
+  }
+  VkDebugUtilsObjectNameInfoEXT info{};
+  info.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
+  info.objectType = static_cast<VkObjectType>(type);
+  info.objectHandle = handle;
+  info.pObjectName = name.c_str();
+  mSetDebugUtilsObjectName(mDevice.get(), &info);
+}
+
+void VulkanContext::setDebugName(vk::Image image, std::string const &name) const {
+  setDebugName(vk::ObjectType::eImage, (uint64_t) static_cast<VkImage>(image), name);
+}
+
+void VulkanContext::setDebugName(vk::Buffer buffer, std::string const &name) const {
+  setDebugName(vk::ObjectType::eBuffer, (uint64_t) static_cast<VkBuffer>(buffer), name);
+}
+
+void VulkanContext::setDebugName(vk::DescriptorSet set, std::string const &name) const {
+  setDebugName(vk::ObjectType::eDescriptorSet, (uint64_t) static_cast<VkDescriptorSet>(set),
+               name);
+}
+
+void VulkanContext::beginDebugLabel(vk::CommandBuffer commandBuffer, char const *name) const {
+  if (!mDebugUtils) {
+    return;
+  }
+  VkDebugUtilsLabelEXT label{};
+  label.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
+  label.pLabelName = name;
+  mCmdBeginDebugUtilsLabel(static_cast<VkCommandBuffer>(commandBuffer), &label);
+}
+
+void VulkanContext::endDebugLabel(vk::CommandBuffer commandBuffer) const {
+  if (!mDebugUtils) {
+    return;
+  }
+  mCmdEndDebugUtilsLabel(static_cast<VkCommandBuffer>(commandBuffer));
+}
+
+static std::string toLower(std::string text) {
+  std::transform(text.begin(), text.end(), text.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return text;
 }
 
-void VulkanContext::pickPhysicalDevice() {
+static std::string getDeviceUUID(vk::PhysicalDevice device) {
+  static const char digits[] = "0123456789abcdef";
+  auto uuid = device.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceIDProperties>()
+                  .get<vk::PhysicalDeviceIDProperties>()
+                  .deviceUUID;
+  std::string text;
+  for (uint32_t i = 0; i < VK_UUID_SIZE; ++i) {
+    text += digits[uuid[i] >> 4];
+    text += digits[uuid[i] & 0xf];
+  }
+  return text;
+}
+
+// whether the index-th device is the one selected by index, UUID or name
+static bool matchesDevice(std::string const &selector, uint32_t index, vk::PhysicalDevice device) {
+  if (std::all_of(selector.begin(), selector.end(), ::isdigit)) {
+    return std::stoul(selector) == index;
+  }
+  std::string uuid = toLower(selector);
+  uuid.erase(std::remove(uuid.begin(), uuid.end(), '-'), uuid.end());
+  if (uuid.size() == 2 * VK_UUID_SIZE && std::all_of(uuid.begin(), uuid.end(), ::isxdigit)) {
+    return uuid == getDeviceUUID(device);
+  }
+  std::string name = device.getProperties().deviceName;
+  return toLower(name).find(toLower(selector)) != std::string::npos;
+}
+
+void VulkanContext::pickPhysicalDevice(std::string const &selector) {
+#ifdef ON_SCREEN
   GLFWwindow *window;
   VkSurfaceKHR tmpSurface;
 
@@ -135,18 +247,31 @@ void VulkanContext::pickPhysicalDevice() {
       throw std::runtime_error("create window failed: glfwCreateWindowSurface failed");
     }
   }
+#endif
 
   vk::PhysicalDevice pickedDevice;
   uint32_t pickedIndex;
-  for (auto device : mInstance->enumeratePhysicalDevices()) {
+  auto devices = mInstance->enumeratePhysicalDevices();
+  for (uint32_t d = 0; d < devices.size(); ++d) {
+    auto properties = devices[d].getProperties();
+    log::info("Vulkan device {}: {}, {}, UUID {}", d, properties.deviceName,
+              vk::to_string(properties.deviceType), getDeviceUUID(devices[d]));
+  }
+  for (uint32_t d = 0; d < devices.size(); ++d) {
+    if (!selector.empty() && !matchesDevice(selector, d, devices[d])) {
+      continue;
+    }
+    auto device = devices[d];
     std::vector<vk::QueueFamilyProperties> queueFamilyProperties =
         device.getQueueFamilyProperties();
     pickedIndex = queueFamilyProperties.size();
     for (uint32_t i = 0; i < queueFamilyProperties.size(); ++i) {
       if (queueFamilyProperties[i].queueFlags & vk::QueueFlagBits::eGraphics) {
+#ifdef ON_SCREEN
         if (mRequirePresent && !device.getSurfaceSupportKHR(i, tmpSurface)) {
           continue;
         }
+#endif
         pickedIndex = i;
       }
     }
@@ -161,15 +286,21 @@ void VulkanContext::pickPhysicalDevice() {
     break;
   }
   if (!pickedDevice) {
+    if (!selector.empty()) {
+      throw std::runtime_error("pickPhysicalDevice: no compatible device matches " + selector);
+    }
     throw std::runtime_error("pickPhysicalDevice: no compatible device found.");
   }
+  log::info("Picked Vulkan device {}", pickedDevice.getProperties().deviceName);
   mPhysicalDevice = pickedDevice;
   graphicsQueueFamilyIndex = pickedIndex;
+#ifdef ON_SCREEN
   if (mRequirePresent) {
     vkDestroySurfaceKHR(mInstance.get(), tmpSurface, nullptr);
     glfwDestroyWindow(window);
     glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
   }
+#endif
 }
 
 void VulkanContext::createLogicalDevice() {
@@ -180,15 +311,46 @@ void VulkanContext::createLogicalDevice() {
   std::vector<const char *> deviceExtensions{};
   vk::PhysicalDeviceFeatures features;
   features.independentBlend = true;
+  // lets the tiled lighting shader write the lighting target without a fixed format
+  features.shaderStorageImageWriteWithoutFormat =
+      mPhysicalDevice.getFeatures().shaderStorageImageWriteWithoutFormat;
+  // shader invocation counts of the pass timers
+  mPipelineStatisticsQuery = mPhysicalDevice.getFeatures().pipelineStatisticsQuery;
+  features.pipelineStatisticsQuery = mPipelineStatisticsQuery;
+
+  // multiview is core in Vulkan 1.1 but optional, used to render several cameras at once
+  auto multiviewFeatures =
+      mPhysicalDevice
+          .getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceMultiviewFeatures>()
+          .get<vk::PhysicalDeviceMultiviewFeatures>();
+  if (multiviewFeatures.multiview) {
+    mMaxMultiviewViewCount =
+        mPhysicalDevice
+            .getProperties2<vk::PhysicalDeviceProperties2,
+                            vk::PhysicalDeviceMultiviewProperties>()
+            .get<vk::PhysicalDeviceMultiviewProperties>()
+            .maxMultiviewViewCount;
+  }
+  vk::PhysicalDeviceMultiviewFeatures enabledMultiview(multiviewFeatures.multiview);
+
+  // heap budgets reported by getMemoryStats
+  for (auto &extension : mPhysicalDevice.enumerateDeviceExtensionProperties()) {
+    if (std::string(extension.extensionName) == VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) {
+      deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+      mMemoryBudget = true;
+    }
+  }
 
 #ifdef ON_SCREEN
   if (mRequirePresent) {
     deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
   }
 #endif
-  mDevice = mPhysicalDevice.createDeviceUnique(
-      vk::DeviceCreateInfo(vk::DeviceCreateFlags(), 1, &deviceQueueCreateInfo, 0, nullptr,
-                           deviceExtensions.size(), deviceExtensions.data(), &features));
+  vk::DeviceCreateInfo deviceCreateInfo(vk::DeviceCreateFlags(), 1, &deviceQueueCreateInfo, 0,
+                                        nullptr, deviceExtensions.size(),
+                                        deviceExtensions.data(), &features);
+  deviceCreateInfo.pNext = &enabledMultiview;
+  mDevice = mPhysicalDevice.createDeviceUnique(deviceCreateInfo);
 }
 
 vk::Queue VulkanContext::getGraphicsQueue() const {
@@ -201,29 +363,66 @@ void VulkanContext::createCommandPool() {
 }
 
 void VulkanContext::createDescriptorPool() {
-  mDescriptorPool = svulkan::createDescriptorPool(
-      mDevice.get(), {{vk::DescriptorType::eSampler, 1000},
-                      {vk::DescriptorType::eCombinedImageSampler, 1000},
-                      {vk::DescriptorType::eSampledImage, 1000},
-                      {vk::DescriptorType::eStorageImage, 1000},
-                      {vk::DescriptorType::eUniformTexelBuffer, 1000},
-                      {vk::DescriptorType::eStorageTexelBuffer, 1000},
-                      {vk::DescriptorType::eUniformBuffer, 1000 + mObjectBufferSize},
-                      {vk::DescriptorType::eStorageBuffer, 1000},
-                      {vk::DescriptorType::eUniformBufferDynamic, 1000},
-                      {vk::DescriptorType::eStorageBufferDynamic, 1000},
-                      {vk::DescriptorType::eInputAttachment, 1000}});
+  std::vector<vk::DescriptorPoolSize> poolSizes = {
+      {vk::DescriptorType::eSampler, 1000},
+      {vk::DescriptorType::eCombinedImageSampler, 1000},
+      {vk::DescriptorType::eSampledImage, 1000},
+      {vk::DescriptorType::eStorageImage, 1000},
+      {vk::DescriptorType::eUniformTexelBuffer, 1000},
+      {vk::DescriptorType::eStorageTexelBuffer, 1000},
+      {vk::DescriptorType::eUniformBuffer, 1000 + mObjectBufferSize},
+      {vk::DescriptorType::eStorageBuffer, 1000},
+      {vk::DescriptorType::eUniformBufferDynamic, 1000},
+      {vk::DescriptorType::eStorageBufferDynamic, 1000},
+      {vk::DescriptorType::eInputAttachment, 1000}};
+  mDescriptorPool = svulkan::createDescriptorPool(mDevice.get(), poolSizes);
+  // createDescriptorPool allows as many sets as descriptors
+  for (auto &poolSize : poolSizes) {
+    mMaxDescriptorSets += poolSize.descriptorCount;
+  }
+}
+
+MemoryStats VulkanContext::getMemoryStats() const {
+  MemoryStats stats = getRecordedMemoryStats(mDevice.get());
+  stats.maxDescriptorSets = mMaxDescriptorSets;
+  if (mMemoryBudget) {
+    auto properties =
+        mPhysicalDevice.getMemoryProperties2<vk::PhysicalDeviceMemoryProperties2,
+                                             vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+    auto &memoryProperties = properties.get<vk::PhysicalDeviceMemoryProperties2>().memoryProperties;
+    auto &budget = properties.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; ++i) {
+      MemoryHeapBudget heap;
+      heap.size = memoryProperties.memoryHeaps[i].size;
+      heap.budget = budget.heapBudget[i];
+      heap.usage = budget.heapUsage[i];
+      heap.deviceLocal = static_cast<bool>(memoryProperties.memoryHeaps[i].flags &
+                                           vk::MemoryHeapFlagBits::eDeviceLocal);
+      stats.heaps.push_back(heap);
+    }
+  }
+  return stats;
+}
+
+std::vector<FileMemoryUsage> VulkanContext::getFileMemoryUsage() const {
+  return mResourcesManager.getFileMemoryUsage();
 }
 
 void VulkanContext::initializeDescriptorSetLayouts() {
-  // uniform buffers
-  mDescriptorSetLayouts.scene = createDescriptorSetLayout(
-      getDevice(), {{vk::DescriptorType::eUniformBuffer, 1,
-                     vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment}});
+  // uniform buffers, scene also holds the light storage buffers and the shadow maps
+  vk::ShaderStageFlags stages = vk::ShaderStageFlagBits::eVertex |
+                                vk::ShaderStageFlagBits::eFragment |
+                                vk::ShaderStageFlagBits::eCompute;
+  mDescriptorSetLayouts.scene =
+      createDescriptorSetLayout(getDevice(), {{vk::DescriptorType::eUniformBuffer, 1, stages},
+                                              {vk::DescriptorType::eStorageBuffer, 1, stages},
+                                              {vk::DescriptorType::eStorageBuffer, 1, stages},
+                                              {vk::DescriptorType::eUniformBuffer, 1, stages},
+                                              {vk::DescriptorType::eCombinedImageSampler, 1,
+                                               stages}});
 
   mDescriptorSetLayouts.camera = createDescriptorSetLayout(
-      getDevice(), {{vk::DescriptorType::eUniformBuffer, 1,
-                     vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment}});
+      getDevice(), {{vk::DescriptorType::eUniformBuffer, 1, stages}});
 
   mDescriptorSetLayouts.object = createDescriptorSetLayout(
       getDevice(), {{vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex}});
@@ -291,7 +490,8 @@ std::shared_ptr<VulkanMaterial> VulkanContext::createMaterial() {
 
 std::unique_ptr<VulkanScene> VulkanContext::createVulkanScene() const {
   return std::make_unique<VulkanScene>(getPhysicalDevice(), getDevice(), getDescriptorPool(),
-                                       getDescriptorSetLayouts().scene.get());
+                                       getDescriptorSetLayouts().scene.get(), getCommandPool(),
+                                       getGraphicsQueue());
 }
 
 std::unique_ptr<VulkanObject> VulkanContext::createVulkanObject() const {
@@ -315,6 +515,7 @@ std::unique_ptr<struct Camera> VulkanContext::createCamera() const {
 }
 
 VulkanContext::~VulkanContext() {
+  clearRecordedMemoryStats(mDevice.get());
 #ifdef ON_SCREEN
   if (mRequirePresent) {
     glfwTerminate();
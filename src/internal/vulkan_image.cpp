@@ -7,31 +7,39 @@ VulkanImageData::VulkanImageData(vk::PhysicalDevice physicalDevice, vk::Device d
                                  vk::Extent2D const &extent, uint32_t mipLevels,
                                  vk::ImageTiling tiling, vk::ImageUsageFlags usage,
                                  vk::ImageLayout initialLayout, vk::MemoryPropertyFlags memoryProperties,
-                                 vk::ImageAspectFlags aspectMask)
-    : mFormat(format), mExtent(extent), mMipLevels(mipLevels), mMemoryProperties(memoryProperties)
+                                 vk::ImageAspectFlags aspectMask, uint32_t arrayLayers)
+    : mFormat(format), mExtent(extent), mMipLevels(mipLevels), mArrayLayers(arrayLayers),
+      mMemoryProperties(memoryProperties)
 {
+  MemoryCategory category = getImageMemoryCategory(usage);
 
   vk::ImageCreateInfo imageInfo (
       {}, vk::ImageType::e2D, mFormat,
-      vk::Extent3D(extent, 1), mipLevels, 1, vk::SampleCountFlagBits::e1, tiling,
-      usage | vk::ImageUsageFlagBits::eSampled, vk::SharingMode::eExclusive, 0, nullptr, initialLayout);
+      vk::Extent3D(extent, 1), mipLevels, arrayLayers, vk::SampleCountFlagBits::e1, tiling,
+      usage, vk::SharingMode::eExclusive, 0, nullptr, initialLayout);
 
   mImage = device.createImageUnique(imageInfo);
   if (!mImage) {
     throw std::runtime_error("Image creation failed");
   }
-  mMemory = allocateMemory(device, physicalDevice.getMemoryProperties(),
-                           device.getImageMemoryRequirements(mImage.get()), memoryProperties);
+  vk::MemoryRequirements requirements = device.getImageMemoryRequirements(mImage.get());
+  mMemory = allocateMemory(device, physicalDevice.getMemoryProperties(), requirements,
+                           memoryProperties);
   if (!mMemory) {
     throw std::runtime_error("Memory allocation failed");
   }
+  mMemoryRecord = MemoryRecord(
+      device, category, requirements.size,
+      static_cast<bool>(memoryProperties & vk::MemoryPropertyFlagBits::eDeviceLocal));
 
   device.bindImageMemory(mImage.get(), mMemory.get(), 0);
   vk::ComponentMapping componentMapping(vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eG,
                                         vk::ComponentSwizzle::eB, vk::ComponentSwizzle::eA);
-  vk::ImageViewCreateInfo imageViewInfo(vk::ImageViewCreateFlags(), mImage.get(), vk::ImageViewType::e2D,
-                                        mFormat, componentMapping,
-                                        vk::ImageSubresourceRange(aspectMask, 0, mipLevels, 0, 1));
+  // array images get a view over all layers
+  vk::ImageViewCreateInfo imageViewInfo(
+      vk::ImageViewCreateFlags(), mImage.get(),
+      arrayLayers > 1 ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D, mFormat,
+      componentMapping, vk::ImageSubresourceRange(aspectMask, 0, mipLevels, 0, arrayLayers));
 
   mImageView = device.createImageViewUnique(imageViewInfo);
   if (!mImageView.get()) {
@@ -39,4 +47,90 @@ VulkanImageData::VulkanImageData(vk::PhysicalDevice physicalDevice, vk::Device d
   }
 }
 
+void VulkanImageData::createArrayImageView(vk::Device device) {
+  if (mArrayLayers > 1 || mArrayImageView) {
+    return;
+  }
+  vk::ImageAspectFlags aspect =
+      isDepthFormat(mFormat) ? vk::ImageAspectFlagBits::eDepth : vk::ImageAspectFlagBits::eColor;
+  mArrayImageView = device.createImageViewUnique(vk::ImageViewCreateInfo(
+      {}, mImage.get(), vk::ImageViewType::e2DArray, mFormat, {},
+      vk::ImageSubresourceRange(aspect, 0, mMipLevels, 0, 1)));
+}
+
+std::vector<vk::BufferImageCopy>
+VulkanImageData::getDownloadRegions(vk::DeviceSize offset, size_t size, vk::Extent2D tile) const {
+  vk::ImageAspectFlags aspect =
+      isDepthFormat(mFormat) ? vk::ImageAspectFlagBits::eDepth : vk::ImageAspectFlagBits::eColor;
+  if (tile.width == 0 || tile.height == 0) {
+    tile = mExtent;
+  }
+  uint32_t columns = mExtent.width / tile.width;
+  size_t tileSize = size_t(tile.width) * tile.height * getFormatSize(mFormat) * mArrayLayers;
+  std::vector<vk::BufferImageCopy> copyRegions;
+  for (size_t copied = 0, i = 0; copied < size; copied += tileSize, ++i) {
+    vk::Offset3D origin(static_cast<int32_t>(i % columns * tile.width),
+                        static_cast<int32_t>(i / columns * tile.height), 0);
+    copyRegions.push_back(vk::BufferImageCopy(offset + copied, tile.width, tile.height,
+                                              {aspect, 0, 0, mArrayLayers}, origin,
+                                              vk::Extent3D(tile, 1)));
+  }
+  return copyRegions;
+}
+
+vk::PipelineStageFlags VulkanImageData::getAttachmentStages() const {
+  if (isDepthFormat(mFormat)) {
+    return vk::PipelineStageFlagBits::eEarlyFragmentTests |
+           vk::PipelineStageFlagBits::eLateFragmentTests;
+  }
+  return vk::PipelineStageFlagBits::eColorAttachmentOutput;
+}
+
+vk::ImageMemoryBarrier VulkanImageData::getAttachmentBarrier(vk::ImageLayout layout,
+                                                             vk::AccessFlags access,
+                                                             bool fromAttachment) const {
+  vk::ImageLayout attachmentLayout;
+  vk::AccessFlags writeAccess;
+  vk::AccessFlags readWriteAccess;
+  vk::ImageAspectFlags aspect;
+  if (isDepthFormat(mFormat)) {
+    attachmentLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+    writeAccess = vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+    readWriteAccess = vk::AccessFlagBits::eDepthStencilAttachmentWrite |
+                      vk::AccessFlagBits::eDepthStencilAttachmentRead;
+    aspect = vk::ImageAspectFlagBits::eDepth;
+  } else {
+    attachmentLayout = vk::ImageLayout::eColorAttachmentOptimal;
+    writeAccess = vk::AccessFlagBits::eColorAttachmentWrite;
+    readWriteAccess =
+        vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eColorAttachmentRead;
+    aspect = vk::ImageAspectFlagBits::eColor;
+  }
+  vk::ImageSubresourceRange range(aspect, 0, mMipLevels, 0, mArrayLayers);
+  if (fromAttachment) {
+    return vk::ImageMemoryBarrier(writeAccess, access, attachmentLayout, layout,
+                                  VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, mImage.get(),
+                                  range);
+  }
+  return vk::ImageMemoryBarrier(access, readWriteAccess, layout, attachmentLayout,
+                                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, mImage.get(),
+                                range);
+}
+
+vk::ImageMemoryBarrier VulkanImageData::getDownloadBarrier(bool toTransfer) const {
+  return getAttachmentBarrier(vk::ImageLayout::eTransferSrcOptimal,
+                              vk::AccessFlagBits::eTransferRead, toTransfer);
+}
+
+void VulkanImageData::recordDownload(vk::CommandBuffer commandBuffer, vk::Buffer buffer,
+                                     vk::DeviceSize offset, size_t size,
+                                     vk::Extent2D tile) const {
+  commandBuffer.pipelineBarrier(getAttachmentStages(), vk::PipelineStageFlagBits::eTransfer, {},
+                                nullptr, nullptr, getDownloadBarrier(true));
+  commandBuffer.copyImageToBuffer(mImage.get(), vk::ImageLayout::eTransferSrcOptimal, buffer,
+                                  getDownloadRegions(offset, size, tile));
+  commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, getAttachmentStages(), {},
+                                nullptr, nullptr, getDownloadBarrier(false));
+}
+
 }
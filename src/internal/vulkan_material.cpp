@@ -11,6 +11,7 @@ VulkanMaterial::VulkanMaterial(vk::PhysicalDevice physicalDevice, vk::Device dev
   mDescriptorSet = std::move(
       device.allocateDescriptorSetsUnique(vk::DescriptorSetAllocateInfo(descriptorPool, 1, &descriptorLayout))
       .front());
+  mDescriptorSetRecord = DescriptorSetRecord(device);
   svulkan::updateDescriptorSets(
       mDevice, mDescriptorSet.get(),
       {{vk::DescriptorType::eUniformBuffer, mUBO.mBuffer.get(), vk::BufferView()}},
@@ -35,6 +36,16 @@ void VulkanMaterial::setNormalTexture(std::shared_ptr<VulkanTextureData> tex) {
   mNormalMap = tex;
   svulkan::updateDescriptorSets(mDevice, mDescriptorSet.get(), {}, {mNormalMap}, 3);
 }
+bool VulkanMaterial::isAlphaTested() const {
+  if (mMaterial.additionalTransparency >= 1.f) {
+    return true;
+  }
+  if (mMaterial.hasColorMap) {
+    return mDiffuseMap && mDiffuseMap->mHasTransparentTexels;
+  }
+  return mMaterial.baseColor.a <= 0.f;
+}
+
 void VulkanMaterial::setHeightTexture(std::shared_ptr<VulkanTextureData> tex) {
   mHeightMap = tex;
   svulkan::updateDescriptorSets(mDevice, mDescriptorSet.get(), {}, {mHeightMap}, 4);
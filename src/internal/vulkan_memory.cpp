@@ -0,0 +1,192 @@
+#include "sapien_vulkan/internal/vulkan_memory.h"
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+namespace svulkan {
+
+namespace {
+
+struct Registry {
+  std::mutex mutex;
+  std::map<VkDevice, MemoryStats> devices;
+};
+
+} // namespace
+
+// allocations happen on loader and render threads alike
+static Registry &getRegistry() {
+  static Registry registry;
+  return registry;
+}
+
+char const *getMemoryCategoryName(MemoryCategory category) {
+  switch (category) {
+  case MemoryCategory::eMeshVertex:
+    return "mesh vertex";
+  case MemoryCategory::eMeshIndex:
+    return "mesh index";
+  case MemoryCategory::eTexture:
+    return "texture";
+  case MemoryCategory::eRenderTarget:
+    return "render target";
+  case MemoryCategory::eUniform:
+    return "uniform";
+  case MemoryCategory::eStorage:
+    return "storage";
+  case MemoryCategory::eStaging:
+    return "staging";
+  default:
+    return "other";
+  }
+}
+
+MemoryCategory getBufferMemoryCategory(vk::BufferUsageFlags usage,
+                                       vk::MemoryPropertyFlags memoryProperties) {
+  if (usage & vk::BufferUsageFlagBits::eVertexBuffer) {
+    return MemoryCategory::eMeshVertex;
+  }
+  if (usage & vk::BufferUsageFlagBits::eIndexBuffer) {
+    return MemoryCategory::eMeshIndex;
+  }
+  if (usage & vk::BufferUsageFlagBits::eUniformBuffer) {
+    return MemoryCategory::eUniform;
+  }
+  if ((usage & (vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst)) &&
+      (memoryProperties & vk::MemoryPropertyFlagBits::eHostVisible)) {
+    return MemoryCategory::eStaging;
+  }
+  if (usage & vk::BufferUsageFlagBits::eStorageBuffer) {
+    return MemoryCategory::eStorage;
+  }
+  return MemoryCategory::eOther;
+}
+
+MemoryCategory getImageMemoryCategory(vk::ImageUsageFlags usage) {
+  if (usage & (vk::ImageUsageFlagBits::eColorAttachment |
+               vk::ImageUsageFlagBits::eDepthStencilAttachment)) {
+    return MemoryCategory::eRenderTarget;
+  }
+  if (usage & (vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst)) {
+    return MemoryCategory::eTexture;
+  }
+  return MemoryCategory::eOther;
+}
+
+static void recordAllocation(vk::Device device, MemoryCategory category, uint64_t bytes,
+                             bool deviceLocal, bool allocated) {
+  auto &registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto it = registry.devices.find(static_cast<VkDevice>(device));
+  if (it == registry.devices.end()) {
+    if (!allocated) {
+      return; // freed after its context
+    }
+    it = registry.devices.insert({static_cast<VkDevice>(device), {}}).first;
+  }
+  auto &stats = it->second;
+  auto &categoryStats = stats.categories[static_cast<size_t>(category)];
+  uint64_t &placement = deviceLocal ? stats.deviceLocalBytes : stats.hostVisibleBytes;
+  if (allocated) {
+    categoryStats.bytes += bytes;
+    categoryStats.allocations++;
+    stats.bytes += bytes;
+    placement += bytes;
+  } else {
+    categoryStats.bytes -= bytes;
+    categoryStats.allocations--;
+    stats.bytes -= bytes;
+    placement -= bytes;
+  }
+  categoryStats.peakBytes = std::max(categoryStats.peakBytes, categoryStats.bytes);
+  stats.peakBytes = std::max(stats.peakBytes, stats.bytes);
+}
+
+MemoryRecord::MemoryRecord(vk::Device device, MemoryCategory category, uint64_t bytes,
+                           bool deviceLocal)
+    : mDevice(device), mCategory(category), mBytes(bytes), mDeviceLocal(deviceLocal) {
+  recordAllocation(mDevice, mCategory, mBytes, mDeviceLocal, true);
+}
+
+MemoryRecord::~MemoryRecord() {
+  if (mDevice) {
+    recordAllocation(mDevice, mCategory, mBytes, mDeviceLocal, false);
+  }
+}
+
+MemoryRecord::MemoryRecord(MemoryRecord &&other)
+    : mDevice(other.mDevice), mCategory(other.mCategory), mBytes(other.mBytes),
+      mDeviceLocal(other.mDeviceLocal) {
+  other.mDevice = vk::Device{};
+}
+
+MemoryRecord &MemoryRecord::operator=(MemoryRecord &&other) {
+  if (this != &other) {
+    if (mDevice) {
+      recordAllocation(mDevice, mCategory, mBytes, mDeviceLocal, false);
+    }
+    mDevice = other.mDevice;
+    mCategory = other.mCategory;
+    mBytes = other.mBytes;
+    mDeviceLocal = other.mDeviceLocal;
+    other.mDevice = vk::Device{};
+  }
+  return *this;
+}
+
+static void recordDescriptorSet(vk::Device device, bool allocated) {
+  auto &registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto it = registry.devices.find(static_cast<VkDevice>(device));
+  if (it == registry.devices.end()) {
+    if (!allocated) {
+      return;
+    }
+    it = registry.devices.insert({static_cast<VkDevice>(device), {}}).first;
+  }
+  if (allocated) {
+    it->second.descriptorSets++;
+  } else {
+    it->second.descriptorSets--;
+  }
+}
+
+DescriptorSetRecord::DescriptorSetRecord(vk::Device device) : mDevice(device) {
+  recordDescriptorSet(mDevice, true);
+}
+
+DescriptorSetRecord::~DescriptorSetRecord() {
+  if (mDevice) {
+    recordDescriptorSet(mDevice, false);
+  }
+}
+
+DescriptorSetRecord::DescriptorSetRecord(DescriptorSetRecord &&other) : mDevice(other.mDevice) {
+  other.mDevice = vk::Device{};
+}
+
+DescriptorSetRecord &DescriptorSetRecord::operator=(DescriptorSetRecord &&other) {
+  if (this != &other) {
+    if (mDevice) {
+      recordDescriptorSet(mDevice, false);
+    }
+    mDevice = other.mDevice;
+    other.mDevice = vk::Device{};
+  }
+  return *this;
+}
+
+MemoryStats getRecordedMemoryStats(vk::Device device) {
+  auto &registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto it = registry.devices.find(static_cast<VkDevice>(device));
+  return it == registry.devices.end() ? MemoryStats{} : it->second;
+}
+
+void clearRecordedMemoryStats(vk::Device device) {
+  auto &registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.devices.erase(static_cast<VkDevice>(device));
+}
+
+} // namespace svulkan
@@ -11,6 +11,7 @@ VulkanObject::VulkanObject(vk::PhysicalDevice physicalDevice, vk::Device device,
   mDescriptorSet = std::move(
       device.allocateDescriptorSetsUnique(vk::DescriptorSetAllocateInfo(descriptorPool, 1, &descriptorLayout))
       .front());
+  mDescriptorSetRecord = DescriptorSetRecord(device);
 
   updateDescriptorSets(device, mDescriptorSet.get(),
                        {{vk::DescriptorType::eUniformBuffer, mUBO.mBuffer.get(), vk::BufferView()}}, {}, 0);
@@ -0,0 +1,60 @@
+#include "sapien_vulkan/internal/vulkan_pass_recorder.h"
+#include "sapien_vulkan/internal/vulkan_context.h"
+
+namespace svulkan {
+
+VulkanPassRecorder::VulkanPassRecorder(VulkanContext &context, VulkanRendererConfig &config)
+    : mContext(&context) {
+  if (!config.passTimers) {
+    return;
+  }
+  if (!VulkanPassTimer::isSupported(mContext->getPhysicalDevice(),
+                                    mContext->getGraphicsQueueFamilyIndex())) {
+    log::warn("The graphics queue does not support timestamps, passes are not timed");
+    config.passTimers = false;
+    return;
+  }
+  mTimer = std::make_unique<VulkanPassTimer>(mContext->getPhysicalDevice(),
+                                             mContext->getDevice(),
+                                             mContext->getGraphicsQueueFamilyIndex());
+  mTimer->calibrate(mContext->getCommandPool(), mContext->getGraphicsQueue());
+  if (config.pipelineStatistics) {
+    if (mContext->supportsPipelineStatistics()) {
+      mTimer->enablePipelineStatistics();
+    } else {
+      log::warn("The device does not support pipeline statistics queries");
+      config.pipelineStatistics = false;
+    }
+  }
+}
+
+void VulkanPassRecorder::beginFrame(vk::CommandBuffer commandBuffer) {
+  mStats.beginFrame();
+  if (mTimer) {
+    mTimer->beginFrame(commandBuffer);
+  }
+}
+
+void VulkanPassRecorder::endFrame() { mStats.endFrame(); }
+
+void VulkanPassRecorder::begin(vk::CommandBuffer commandBuffer, char const *name) {
+  mStats.begin(name);
+  mContext->beginDebugLabel(commandBuffer, name);
+  if (mTimer) {
+    mTimer->begin(commandBuffer, name);
+  }
+}
+
+void VulkanPassRecorder::end(vk::CommandBuffer commandBuffer) {
+  mStats.end();
+  if (mTimer) {
+    mTimer->end(commandBuffer);
+  }
+  mContext->endDebugLabel(commandBuffer);
+}
+
+std::vector<PassTiming> VulkanPassRecorder::getTimings() const {
+  return mTimer ? mTimer->getTimings() : std::vector<PassTiming>{};
+}
+
+} // namespace svulkan
@@ -0,0 +1,201 @@
+#include "sapien_vulkan/internal/vulkan_pass_timer.h"
+#include "sapien_vulkan/common/profiler.h"
+#include <algorithm>
+
+namespace svulkan {
+
+bool VulkanPassTimer::isSupported(vk::PhysicalDevice physicalDevice, uint32_t queueFamily) {
+  return physicalDevice.getProperties().limits.timestampComputeAndGraphics &&
+         physicalDevice.getQueueFamilyProperties()[queueFamily].timestampValidBits > 0;
+}
+
+VulkanPassTimer::VulkanPassTimer(vk::PhysicalDevice physicalDevice, vk::Device device,
+                                 uint32_t queueFamily, uint32_t frameCount, uint32_t maxPasses,
+                                 uint32_t window)
+    : mDevice(device), mMaxQueries(2 * maxPasses), mWindow(std::max(window, 1u)) {
+  mNanosecondsPerTick = physicalDevice.getProperties().limits.timestampPeriod;
+  uint32_t validBits = physicalDevice.getQueueFamilyProperties()[queueFamily].timestampValidBits;
+  mTimestampMask = validBits >= 64 ? ~uint64_t(0) : (uint64_t(1) << validBits) - 1;
+
+  mFrames.resize(std::max(frameCount, 1u));
+  for (auto &frame : mFrames) {
+    frame.mPool = mDevice.createQueryPoolUnique(
+        vk::QueryPoolCreateInfo({}, vk::QueryType::eTimestamp, mMaxQueries));
+  }
+}
+
+void VulkanPassTimer::calibrate(vk::CommandPool commandPool, vk::Queue queue) {
+  auto pool =
+      mDevice.createQueryPoolUnique(vk::QueryPoolCreateInfo({}, vk::QueryType::eTimestamp, 1));
+  OneTimeSubmit(mDevice, commandPool, queue, [&](vk::CommandBuffer commandBuffer) {
+    commandBuffer.resetQueryPool(pool.get(), 0, 1);
+    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, pool.get(), 0);
+  });
+  int64_t cpuTime = profiler::now();
+  uint64_t ticks = 0;
+  vkGetQueryPoolResults(static_cast<VkDevice>(mDevice), static_cast<VkQueryPool>(pool.get()), 0,
+                        1, sizeof(ticks), &ticks, sizeof(ticks),
+                        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+  mCpuOffset = cpuTime - static_cast<int64_t>((ticks & mTimestampMask) * mNanosecondsPerTick);
+  mCalibrated = true;
+}
+
+void VulkanPassTimer::enablePipelineStatistics() {
+  for (auto &frame : mFrames) {
+    frame.mStatisticsPool = mDevice.createQueryPoolUnique(vk::QueryPoolCreateInfo(
+        {}, vk::QueryType::ePipelineStatistics, mMaxQueries / 2,
+        vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations |
+            vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations));
+  }
+}
+
+void VulkanPassTimer::resolve(Frame &frame) {
+  if (frame.mQueryCount == 0) {
+    return;
+  }
+  // value and availability of every query, without waiting
+  std::vector<uint64_t> results(2 * frame.mQueryCount);
+  vkGetQueryPoolResults(static_cast<VkDevice>(mDevice), static_cast<VkQueryPool>(frame.mPool.get()),
+                        0, frame.mQueryCount, results.size() * sizeof(uint64_t), results.data(),
+                        2 * sizeof(uint64_t),
+                        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+  std::map<uint32_t, double> frameTimes;
+  for (auto [index, query] : frame.mPasses) {
+    uint64_t const *begin = &results[2 * query];
+    uint64_t const *end = &results[2 * (query + 1)];
+    if (!begin[1] || !end[1]) {
+      // the frame has not finished or was never submitted
+      return;
+    }
+    uint64_t ticks = (end[0] - begin[0]) & mTimestampMask;
+    frameTimes[index] += ticks * mNanosecondsPerTick * 1e-6;
+  }
+
+  // vertex and fragment invocations, in the order of the statistic bits, and availability
+  std::map<uint32_t, std::pair<uint64_t, uint64_t>> frameInvocations;
+  if (frame.mStatistics.size()) {
+    std::vector<uint64_t> statistics(3 * frame.mStatistics.size());
+    vkGetQueryPoolResults(static_cast<VkDevice>(mDevice),
+                          static_cast<VkQueryPool>(frame.mStatisticsPool.get()), 0,
+                          static_cast<uint32_t>(frame.mStatistics.size()),
+                          statistics.size() * sizeof(uint64_t), statistics.data(),
+                          3 * sizeof(uint64_t),
+                          VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    for (uint32_t query = 0; query < frame.mStatistics.size(); ++query) {
+      uint64_t const *result = &statistics[3 * query];
+      if (!result[2]) {
+        return;
+      }
+      auto &invocations = frameInvocations[frame.mStatistics[query]];
+      invocations.first += result[0];
+      invocations.second += result[1];
+    }
+  }
+
+  if (mCalibrated && profiler::isEnabled()) {
+    for (auto [index, query] : frame.mPasses) {
+      uint64_t beginTicks = results[2 * query] & mTimestampMask;
+      uint64_t endTicks = results[2 * (query + 1)] & mTimestampMask;
+      int64_t begin = static_cast<int64_t>(beginTicks * mNanosecondsPerTick) + mCpuOffset;
+      int64_t end = static_cast<int64_t>(endTicks * mNanosecondsPerTick) + mCpuOffset;
+      profiler::recordTrack("GPU", mHistory[index].timing.name, begin, end);
+    }
+  }
+
+  for (auto [index, milliseconds] : frameTimes) {
+    auto &history = mHistory[index];
+    if (history.samples.size() < mWindow) {
+      history.samples.push_back(milliseconds);
+    } else {
+      history.samples[history.next] = milliseconds;
+    }
+    history.next = (history.next + 1) % mWindow;
+
+    double sum = 0;
+    for (double sample : history.samples) {
+      sum += sample;
+    }
+    history.timing.lastMilliseconds = milliseconds;
+    history.timing.sampleCount = static_cast<uint32_t>(history.samples.size());
+    history.timing.averageMilliseconds = sum / history.samples.size();
+  }
+  for (auto [index, invocations] : frameInvocations) {
+    mHistory[index].timing.vertexInvocations = invocations.first;
+    mHistory[index].timing.fragmentInvocations = invocations.second;
+  }
+}
+
+void VulkanPassTimer::beginFrame(vk::CommandBuffer commandBuffer) {
+  mFrameIndex = (mFrameIndex + 1) % mFrames.size();
+  auto &frame = mFrames[mFrameIndex];
+  resolve(frame);
+
+  frame.mPasses.clear();
+  frame.mQueryCount = 0;
+  frame.mStatistics.clear();
+  mOpenPasses.clear();
+  mStatisticsDepth = -1;
+  commandBuffer.resetQueryPool(frame.mPool.get(), 0, mMaxQueries);
+  if (frame.mStatisticsPool) {
+    commandBuffer.resetQueryPool(frame.mStatisticsPool.get(), 0, mMaxQueries / 2);
+  }
+  mFrameStarted = true;
+}
+
+void VulkanPassTimer::begin(vk::CommandBuffer commandBuffer, std::string const &name) {
+  auto &frame = mFrames[mFrameIndex];
+  if (!mFrameStarted || frame.mQueryCount + 2 > mMaxQueries) {
+    mOpenPasses.push_back(-1);
+    return;
+  }
+
+  auto it = mHistoryIndices.find(name);
+  if (it == mHistoryIndices.end()) {
+    it = mHistoryIndices.insert({name, static_cast<uint32_t>(mHistory.size())}).first;
+    mHistory.push_back({});
+    mHistory.back().timing.name = name;
+  }
+
+  uint32_t query = frame.mQueryCount;
+  frame.mQueryCount += 2;
+  mOpenPasses.push_back(static_cast<int32_t>(frame.mPasses.size()));
+  frame.mPasses.push_back({it->second, query});
+  commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, frame.mPool.get(), query);
+
+  if (frame.mStatisticsPool && mStatisticsDepth < 0) {
+    mStatisticsDepth = static_cast<int32_t>(mOpenPasses.size()) - 1;
+    commandBuffer.beginQuery(frame.mStatisticsPool.get(),
+                             static_cast<uint32_t>(frame.mStatistics.size()), {});
+    frame.mStatistics.push_back(it->second);
+  }
+}
+
+void VulkanPassTimer::end(vk::CommandBuffer commandBuffer) {
+  if (mOpenPasses.empty()) {
+    throw std::runtime_error("VulkanPassTimer::end called without a matching begin");
+  }
+  int32_t pass = mOpenPasses.back();
+  mOpenPasses.pop_back();
+  if (pass < 0) {
+    return;
+  }
+  auto &frame = mFrames[mFrameIndex];
+  if (mStatisticsDepth == static_cast<int32_t>(mOpenPasses.size())) {
+    commandBuffer.endQuery(frame.mStatisticsPool.get(),
+                           static_cast<uint32_t>(frame.mStatistics.size()) - 1);
+    mStatisticsDepth = -1;
+  }
+  commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, frame.mPool.get(),
+                               frame.mPasses[pass].second + 1);
+}
+
+std::vector<PassTiming> VulkanPassTimer::getTimings() const {
+  std::vector<PassTiming> timings;
+  for (auto &history : mHistory) {
+    timings.push_back(history.timing);
+  }
+  return timings;
+}
+
+} // namespace svulkan
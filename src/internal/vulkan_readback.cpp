@@ -0,0 +1,111 @@
+#include "sapien_vulkan/internal/vulkan_readback.h"
+
+namespace svulkan {
+
+VulkanReadbackRing::VulkanReadbackRing(vk::PhysicalDevice physicalDevice, vk::Device device)
+    : mPhysicalDevice(physicalDevice), mDevice(device) {}
+
+// every slot handle holds the ring, so none is in use here
+VulkanReadbackRing::~VulkanReadbackRing() {
+  for (auto &slot : mSlots) {
+    if (slot->mMapped) {
+      mDevice.unmapMemory(slot->mBuffer->getMemory());
+    }
+  }
+}
+
+void VulkanReadbackRing::allocate(Slot &slot, vk::DeviceSize size) {
+  if (slot.mMapped) {
+    mDevice.unmapMemory(slot.mBuffer->getMemory());
+    slot.mMapped = nullptr;
+  }
+  // compute shaders write small results directly
+  vk::BufferUsageFlags usage =
+      vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer;
+  try {
+    slot.mBuffer = std::make_unique<VulkanBufferData>(
+        mPhysicalDevice, mDevice, size, usage,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCached);
+  } catch (std::runtime_error const &) {
+    slot.mBuffer = std::make_unique<VulkanBufferData>(mPhysicalDevice, mDevice, size, usage);
+  }
+  slot.mSize = size;
+  slot.mMapped =
+      static_cast<char *>(mDevice.mapMemory(slot.mBuffer->getMemory(), 0, VK_WHOLE_SIZE));
+}
+
+VulkanReadbackSlot VulkanReadbackRing::acquire(vk::DeviceSize size) {
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  // prefer a free buffer that is large enough, otherwise grow a free one
+  Slot *candidate = nullptr;
+  for (auto &slot : mSlots) {
+    if (slot->mInUse) {
+      continue;
+    }
+    if (slot->mSize >= size) {
+      candidate = slot.get();
+      break;
+    }
+    if (!candidate) {
+      candidate = slot.get();
+    }
+  }
+  if (!candidate) {
+    mSlots.push_back(std::make_unique<Slot>());
+    candidate = mSlots.back().get();
+  }
+  if (candidate->mSize < size) {
+    allocate(*candidate, size);
+  }
+  candidate->mInUse = true;
+  return VulkanReadbackSlot(shared_from_this(), *candidate);
+}
+
+void VulkanReadbackRing::release(Slot &slot) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  slot.mInUse = false;
+}
+
+void VulkanReadbackRing::invalidate(Slot const &slot) const {
+  mDevice.invalidateMappedMemoryRanges(
+      vk::MappedMemoryRange(slot.mBuffer->getMemory(), 0, VK_WHOLE_SIZE));
+}
+
+void VulkanReadbackRing::flush(Slot const &slot) const {
+  mDevice.flushMappedMemoryRanges(
+      vk::MappedMemoryRange(slot.mBuffer->getMemory(), 0, VK_WHOLE_SIZE));
+}
+
+VulkanReadbackSlot::VulkanReadbackSlot(std::shared_ptr<VulkanReadbackRing> ring,
+                                       VulkanReadbackRing::Slot &slot)
+    : mRing(std::move(ring)), mSlot(&slot) {}
+
+VulkanReadbackSlot::~VulkanReadbackSlot() {
+  if (mSlot) {
+    mRing->release(*mSlot);
+  }
+}
+
+VulkanReadbackSlot::VulkanReadbackSlot(VulkanReadbackSlot &&other)
+    : mRing(std::move(other.mRing)), mSlot(other.mSlot) {
+  other.mSlot = nullptr;
+}
+
+VulkanReadbackSlot &VulkanReadbackSlot::operator=(VulkanReadbackSlot &&other) {
+  if (this != &other) {
+    if (mSlot) {
+      mRing->release(*mSlot);
+    }
+    mRing = std::move(other.mRing);
+    mSlot = other.mSlot;
+    other.mSlot = nullptr;
+  }
+  return *this;
+}
+
+VulkanDownloadedTargets::VulkanDownloadedTargets(VulkanReadbackSlot slot,
+                                                 std::vector<Target> targets)
+    : mSlot(std::move(slot)), mTargets(std::move(targets)) {}
+
+} // namespace svulkan
@@ -0,0 +1,68 @@
+#include "sapien_vulkan/internal/vulkan_render_stats.h"
+
+namespace svulkan {
+
+void PassStats::add(PassStats const &other) {
+  drawCalls += other.drawCalls;
+  instances += other.instances;
+  triangles += other.triangles;
+  pipelineBinds += other.pipelineBinds;
+  descriptorSetBinds += other.descriptorSetBinds;
+  vertexBufferBinds += other.vertexBufferBinds;
+  indexBufferBinds += other.indexBufferBinds;
+  barriers += other.barriers;
+}
+
+void VulkanRenderStatsCollector::beginFrame() {
+  mCurrent = {};
+  mCurrent.total.name = "total";
+  mIndices.clear();
+  mOpenPasses.clear();
+  mUploadedBytesStart = getCopiedToDeviceBytes();
+  mRecording = true;
+}
+
+void VulkanRenderStatsCollector::endFrame() {
+  if (!mRecording) {
+    return;
+  }
+  // the total so far only holds the commands recorded outside of passes
+  for (auto &pass : mCurrent.passes) {
+    mCurrent.total.add(pass);
+  }
+  mCurrent.uploadedBytes = getCopiedToDeviceBytes() - mUploadedBytesStart;
+  mStats = std::move(mCurrent);
+  mOpenPasses.clear();
+  mRecording = false;
+}
+
+void VulkanRenderStatsCollector::begin(std::string const &name) {
+  if (!mRecording) {
+    return;
+  }
+  auto it = mIndices.find(name);
+  if (it == mIndices.end()) {
+    it = mIndices.insert({name, static_cast<uint32_t>(mCurrent.passes.size())}).first;
+    mCurrent.passes.push_back({});
+    mCurrent.passes.back().name = name;
+  }
+  mOpenPasses.push_back(it->second);
+}
+
+void VulkanRenderStatsCollector::end() {
+  if (mRecording && !mOpenPasses.empty()) {
+    mOpenPasses.pop_back();
+  }
+}
+
+PassStats *VulkanRenderStatsCollector::current() {
+  if (!mRecording) {
+    return nullptr;
+  }
+  if (mOpenPasses.empty()) {
+    return &mCurrent.total;
+  }
+  return &mCurrent.passes[mOpenPasses.back()];
+}
+
+} // namespace svulkan
@@ -2,20 +2,119 @@
 #include "sapien_vulkan/camera.h"
 #include "sapien_vulkan/internal/vulkan_context.h"
 #include "sapien_vulkan/pass/composite.h"
+#include "sapien_vulkan/pass/compute.h"
+#include "sapien_vulkan/pass/convert.h"
 #include "sapien_vulkan/pass/deferred.h"
 #include "sapien_vulkan/pass/gbuffer.h"
+#include "sapien_vulkan/pass/merged.h"
+#include "sapien_vulkan/pass/pick.h"
+#include "sapien_vulkan/pass/sensor.h"
+#include "sapien_vulkan/pass/shadow.h"
 #include "sapien_vulkan/pass/transparency.h"
 #include "sapien_vulkan/scene.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <glm/gtc/packing.hpp>
+#include <utility>
 
 namespace svulkan {
 
 VulkanRenderer::VulkanRenderer(VulkanContext &context, VulkanRendererConfig const &config)
-    : mContext(&context), mConfig(config) {
+    : mContext(&context), mConfig(config), mPasses(context, mConfig) {
   mGBufferPass = std::make_unique<GBufferPass>(context);
   mDeferredPass = std::make_unique<DeferredPass>(context);
   mTransparencyPass = std::make_unique<TransparencyPass>(context);
   mCompositePass = std::make_unique<CompositePass>(context);
+  mPositionPass = std::make_unique<ComputePass>(context);
+  mMergedPass = std::make_unique<MergedPass>(context);
+  mSensorPass = std::make_unique<SensorPass>(context);
+  mTiledLightingPass = std::make_unique<ComputePass>(context);
+  mShadowPass = std::make_unique<ShadowPass>(context);
+  mReadbackRing =
+      std::make_shared<VulkanReadbackRing>(context.getPhysicalDevice(), context.getDevice());
+  mConvertPass = std::make_unique<ConvertPass>(context);
+  mPickPass = std::make_unique<PickPass>(context);
 
+  if (mConfig.viewCount == 0) {
+    mConfig.viewCount = 1;
+  }
+  if (mConfig.viewCount > 1) {
+    uint32_t maxViews = std::min(MaxCameraViews, mContext->getMaxMultiviewViewCount());
+    if (maxViews < 2) {
+      log::warn("Multiview is not supported by the device, rendering a single view");
+      mConfig.viewCount = 1;
+    } else if (mConfig.viewCount > maxViews) {
+      log::warn("At most {} views can be rendered together", maxViews);
+      mConfig.viewCount = maxViews;
+    }
+  }
+  if (mConfig.viewCount > 1) {
+    // only the merged pass has multiview shaders
+    if (!needsLighting()) {
+      log::warn("viewCount requires the lighting output, adding it");
+      mConfig.outputs.insert(RenderTarget::eLighting);
+    }
+    if (!mConfig.mergeRenderPasses) {
+      log::warn("viewCount requires mergeRenderPasses, enabling it");
+      mConfig.mergeRenderPasses = true;
+    }
+    if (mConfig.shadows) {
+      log::warn("Shadows are not available with viewCount, disabling them");
+      mConfig.shadows = false;
+    }
+    if (mConfig.positionFromDepth) {
+      log::warn("positionFromDepth is not available with viewCount, storing positions");
+      mConfig.positionFromDepth = false;
+    }
+  }
+  if (mConfig.batchSize == 0) {
+    mConfig.batchSize = 1;
+  }
+  if (mConfig.batchSize > 1 && mConfig.viewCount > 1) {
+    log::warn("batchSize cannot be combined with viewCount, rendering one scene at a time");
+    mConfig.batchSize = 1;
+  }
+  if (mConfig.batchSize > 1) {
+    // tiles are drawn with viewports, the separate lighting and composite passes sample the
+    // whole target and only work with a single tile
+    if (!useSensorPass()) {
+      if (!needsLighting()) {
+        log::warn("batchSize requires the lighting output, adding it");
+        mConfig.outputs.insert(RenderTarget::eLighting);
+      }
+      if (!mConfig.mergeRenderPasses) {
+        log::warn("batchSize requires mergeRenderPasses, enabling it");
+        mConfig.mergeRenderPasses = true;
+      }
+    }
+    if (mConfig.positionFromDepth) {
+      log::warn("positionFromDepth is not available with batchSize, storing positions");
+      mConfig.positionFromDepth = false;
+    }
+  }
+  if (mConfig.transientGBuffer && !mConfig.mergeRenderPasses) {
+    log::warn("transientGBuffer requires mergeRenderPasses, G-buffer will be stored");
+    mConfig.transientGBuffer = false;
+  }
+  if (mConfig.tiledLighting && mConfig.mergeRenderPasses) {
+    log::warn("tiledLighting is not available with mergeRenderPasses, using the merged pass");
+    mConfig.tiledLighting = false;
+  }
+  if (mConfig.tiledLighting &&
+      !mContext->getPhysicalDevice().getFeatures().shaderStorageImageWriteWithoutFormat) {
+    log::warn("tiledLighting requires shaderStorageImageWriteWithoutFormat, using the deferred "
+              "pass");
+    mConfig.tiledLighting = false;
+  }
+  if (mConfig.shadowCascadeCount > MaxShadowCascades) {
+    log::warn("At most {} shadow cascades are supported", MaxShadowCascades);
+    mConfig.shadowCascadeCount = MaxShadowCascades;
+  }
+  if (mConfig.shadowPointLightCount > MaxShadowPointLights) {
+    log::warn("At most {} point lights can cast shadows", MaxShadowPointLights);
+    mConfig.shadowPointLightCount = MaxShadowPointLights;
+  }
   initializeDescriptorLayouts();
 
   mDeferredDescriptorSet =
@@ -28,139 +127,335 @@ VulkanRenderer::VulkanRenderer(VulkanContext &context, VulkanRendererConfig cons
                     .allocateDescriptorSetsUnique(vk::DescriptorSetAllocateInfo(
                         mContext->getDescriptorPool(), 1, &mDescriptorSetLayouts.composite.get()))
                     .front());
+  if (mConfig.positionFromDepth) {
+    mPositionDescriptorSet =
+        std::move(mContext->getDevice()
+                      .allocateDescriptorSetsUnique(vk::DescriptorSetAllocateInfo(
+                          mContext->getDescriptorPool(), 1, &mDescriptorSetLayouts.position.get()))
+                      .front());
+  }
+  mPointCloudDescriptorSet =
+      std::move(mContext->getDevice()
+                    .allocateDescriptorSetsUnique(vk::DescriptorSetAllocateInfo(
+                        mContext->getDescriptorPool(), 1, &mDescriptorSetLayouts.pointCloud.get()))
+                    .front());
+  if (isOutput(RenderTarget::eSegmentation)) {
+    mSegmentationStatsDescriptorSet =
+        std::move(mContext->getDevice()
+                      .allocateDescriptorSetsUnique(vk::DescriptorSetAllocateInfo(
+                          mContext->getDescriptorPool(), 1,
+                          &mDescriptorSetLayouts.segmentationStats.get()))
+                      .front());
+  }
+  if (useTiledLighting()) {
+    mTiledLightingDescriptorSet =
+        std::move(mContext->getDevice()
+                      .allocateDescriptorSetsUnique(vk::DescriptorSetAllocateInfo(
+                          mContext->getDescriptorPool(), 1,
+                          &mDescriptorSetLayouts.tiledLighting.get()))
+                      .front());
+  }
+  if (useMergedPass()) {
+    mLightingInputDescriptorSet =
+        std::move(mContext->getDevice()
+                      .allocateDescriptorSetsUnique(vk::DescriptorSetAllocateInfo(
+                          mContext->getDescriptorPool(), 1,
+                          &mDescriptorSetLayouts.lightingInput.get()))
+                      .front());
+    mCompositeInputDescriptorSet =
+        std::move(mContext->getDevice()
+                      .allocateDescriptorSetsUnique(vk::DescriptorSetAllocateInfo(
+                          mContext->getDescriptorPool(), 1,
+                          &mDescriptorSetLayouts.compositeInput.get()))
+                      .front());
+  }
+  if (mConfig.viewCount > 1) {
+    auto cameraLayout = mContext->getDescriptorSetLayouts().camera.get();
+    mMultiviewCameraBuffer = std::make_unique<VulkanBufferData>(
+        mContext->getPhysicalDevice(), mContext->getDevice(), sizeof(CameraUBO) * MaxCameraViews,
+        vk::BufferUsageFlagBits::eUniformBuffer);
+    mMultiviewCameraDescriptorSet =
+        std::move(mContext->getDevice()
+                      .allocateDescriptorSetsUnique(vk::DescriptorSetAllocateInfo(
+                          mContext->getDescriptorPool(), 1, &cameraLayout))
+                      .front());
+    updateDescriptorSets(mContext->getDevice(), mMultiviewCameraDescriptorSet.get(),
+                         {{vk::DescriptorType::eUniformBuffer,
+                           mMultiviewCameraBuffer->mBuffer.get(), vk::BufferView()}},
+                         {}, 0);
+  }
 }
 
+VulkanRenderer::VulkanRenderer(VulkanRenderer &&other) = default;
+VulkanRenderer &VulkanRenderer::operator=(VulkanRenderer &&other) = default;
+VulkanRenderer::~VulkanRenderer() = default;
+
 void VulkanRenderer::resize(int width, int height) {
   log::info("Resizing renderer to {} x {}", width, height);
-  mWidth = width;
-  mHeight = height;
+  mTileWidth = width;
+  mTileHeight = height;
+
+  // batches are laid out on a roughly square grid
+  mTileColumns = static_cast<uint32_t>(std::ceil(std::sqrt(mConfig.batchSize)));
+  uint32_t rows = (mConfig.batchSize + mTileColumns - 1) / mTileColumns;
+  mWidth = width * mTileColumns;
+  mHeight = height * rows;
+  auto limits = mContext->getPhysicalDevice().getProperties().limits;
+  if (static_cast<uint32_t>(mWidth) > limits.maxFramebufferWidth ||
+      static_cast<uint32_t>(mHeight) > limits.maxFramebufferHeight) {
+    throw std::runtime_error("The batch does not fit in a render target of " +
+                             std::to_string(limits.maxFramebufferWidth) + " x " +
+                             std::to_string(limits.maxFramebufferHeight));
+  }
 
   initializeRenderTextures();
   initializeRenderPasses();
 }
 
-void VulkanRenderer::initializeRenderTextures() {
-  mRenderTargetFormats.colorFormat = vk::Format::eR32G32B32A32Sfloat;
-  mRenderTargetFormats.segmentationFormat = vk::Format::eR32G32B32A32Uint;
-  mRenderTargetFormats.depthFormat = vk::Format::eD32Sfloat;
+static std::unique_ptr<VulkanImageData>
+createRenderTarget(VulkanContext &context, vk::Format format, int width, int height,
+                   bool inputAttachment = false, bool transient = false, bool storage = false,
+                   uint32_t layers = 1) {
+  bool depth = isDepthFormat(format);
+  vk::ImageUsageFlags usage = depth ? vk::ImageUsageFlagBits::eDepthStencilAttachment
+                                    : vk::ImageUsageFlagBits::eColorAttachment;
+  if (inputAttachment) {
+    usage |= vk::ImageUsageFlagBits::eInputAttachment;
+  }
+  if (storage) {
+    usage |= vk::ImageUsageFlagBits::eStorage;
+  }
+  vk::ImageAspectFlags aspect =
+      depth ? vk::ImageAspectFlagBits::eDepth : vk::ImageAspectFlagBits::eColor;
 
-  mRenderTargets.albedo = std::make_unique<VulkanImageData>(
-      mContext->getPhysicalDevice(), mContext->getDevice(), mRenderTargetFormats.colorFormat,
-      vk::Extent2D(mWidth, mHeight), 1, vk::ImageTiling::eOptimal,
-      vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled |
-          vk::ImageUsageFlagBits::eTransferSrc,
-      vk::ImageLayout::eUndefined, vk::MemoryPropertyFlagBits::eDeviceLocal,
-      vk::ImageAspectFlagBits::eColor);
+  if (transient) {
+    // tile memory on devices that support it
+    try {
+      return std::make_unique<VulkanImageData>(
+          context.getPhysicalDevice(), context.getDevice(), format, vk::Extent2D(width, height),
+          1, vk::ImageTiling::eOptimal, usage | vk::ImageUsageFlagBits::eTransientAttachment,
+          vk::ImageLayout::eUndefined,
+          vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eLazilyAllocated,
+          aspect, layers);
+    } catch (std::runtime_error const &) {
+      return std::make_unique<VulkanImageData>(
+          context.getPhysicalDevice(), context.getDevice(), format, vk::Extent2D(width, height),
+          1, vk::ImageTiling::eOptimal, usage | vk::ImageUsageFlagBits::eTransientAttachment,
+          vk::ImageLayout::eUndefined, vk::MemoryPropertyFlagBits::eDeviceLocal, aspect, layers);
+    }
+  }
+  auto image = std::make_unique<VulkanImageData>(
+      context.getPhysicalDevice(), context.getDevice(), format, vk::Extent2D(width, height), 1,
+      vk::ImageTiling::eOptimal,
+      usage | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc,
+      vk::ImageLayout::eUndefined, vk::MemoryPropertyFlagBits::eDeviceLocal, aspect, layers);
+  // conversion, pixel queries, segmentation stats and point clouds read targets as arrays
+  image->createArrayImageView(context.getDevice());
+  return image;
+}
 
-  mRenderTargets.position = std::make_unique<VulkanImageData>(
-      mContext->getPhysicalDevice(), mContext->getDevice(), mRenderTargetFormats.colorFormat,
-      vk::Extent2D(mWidth, mHeight), 1, vk::ImageTiling::eOptimal,
-      vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled |
-          vk::ImageUsageFlagBits::eTransferSrc,
-      vk::ImageLayout::eUndefined, vk::MemoryPropertyFlagBits::eDeviceLocal,
-      vk::ImageAspectFlagBits::eColor);
+static bool supportsFormat(vk::PhysicalDevice device, vk::Format format,
+                           vk::FormatFeatureFlags features) {
+  return (device.getFormatProperties(format).optimalTilingFeatures & features) == features;
+}
 
-  mRenderTargets.specular = std::make_unique<VulkanImageData>(
-      mContext->getPhysicalDevice(), mContext->getDevice(), mRenderTargetFormats.colorFormat,
-      vk::Extent2D(mWidth, mHeight), 1, vk::ImageTiling::eOptimal,
-      vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled |
-          vk::ImageUsageFlagBits::eTransferSrc,
-      vk::ImageLayout::eUndefined, vk::MemoryPropertyFlagBits::eDeviceLocal,
-      vk::ImageAspectFlagBits::eColor);
+// features a render target needs beyond being an attachment
+static void checkRenderTargetFormat(vk::PhysicalDevice device, vk::Format format, bool transient,
+                                    bool storage, bool blend) {
+  vk::FormatFeatureFlags features = isDepthFormat(format)
+                                        ? vk::FormatFeatureFlagBits::eDepthStencilAttachment
+                                        : vk::FormatFeatureFlagBits::eColorAttachment;
+  if (!transient) {
+    features |= vk::FormatFeatureFlagBits::eSampledImage;
+  }
+  if (storage) {
+    features |= vk::FormatFeatureFlagBits::eStorageImage;
+  }
+  if (blend) {
+    features |= vk::FormatFeatureFlagBits::eColorAttachmentBlend;
+  }
+  if (!supportsFormat(device, format, features)) {
+    throw std::runtime_error("Render target format " + vk::to_string(format) +
+                             " does not support " + vk::to_string(features) +
+                             " on this device");
+  }
+}
 
-  mRenderTargets.normal = std::make_unique<VulkanImageData>(
-      mContext->getPhysicalDevice(), mContext->getDevice(), mRenderTargetFormats.colorFormat,
-      vk::Extent2D(mWidth, mHeight), 1, vk::ImageTiling::eOptimal,
-      vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled |
-          vk::ImageUsageFlagBits::eTransferSrc,
-      vk::ImageLayout::eUndefined, vk::MemoryPropertyFlagBits::eDeviceLocal,
-      vk::ImageAspectFlagBits::eColor);
+bool VulkanRenderer::isOutput(RenderTarget target) const {
+  return mConfig.outputs.count(target);
+}
 
-  mRenderTargets.segmentation = std::make_unique<VulkanImageData>(
-      mContext->getPhysicalDevice(), mContext->getDevice(),
-      mRenderTargetFormats.segmentationFormat, vk::Extent2D(mWidth, mHeight), 1,
-      vk::ImageTiling::eOptimal,
-      vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled |
-          vk::ImageUsageFlagBits::eTransferSrc,
-      vk::ImageLayout::eUndefined, vk::MemoryPropertyFlagBits::eDeviceLocal,
-      vk::ImageAspectFlagBits::eColor);
+bool VulkanRenderer::needsLighting() const { return isOutput(RenderTarget::eLighting); }
 
-  mRenderTargets.depth = std::make_unique<VulkanImageData>(
-      mContext->getPhysicalDevice(), mContext->getDevice(), mRenderTargetFormats.depthFormat,
-      vk::Extent2D(mWidth, mHeight), 1, vk::ImageTiling::eOptimal,
-      vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eSampled |
-          vk::ImageUsageFlagBits::eTransferSrc,
-      vk::ImageLayout::eUndefined, vk::MemoryPropertyFlagBits::eDeviceLocal,
-      vk::ImageAspectFlagBits::eDepth);
-
-  mRenderTargets.lighting = std::make_unique<VulkanImageData>(
-      mContext->getPhysicalDevice(), mContext->getDevice(), mRenderTargetFormats.colorFormat,
-      vk::Extent2D(mWidth, mHeight), 1, vk::ImageTiling::eOptimal,
-      vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled |
-          vk::ImageUsageFlagBits::eTransferSrc,
-      vk::ImageLayout::eUndefined, vk::MemoryPropertyFlagBits::eDeviceLocal,
-      vk::ImageAspectFlagBits::eColor);
+bool VulkanRenderer::needsTarget(RenderTarget target) const {
+  switch (target) {
+  case RenderTarget::ePosition:
+    if (mConfig.positionFromDepth) {
+      return false;
+    }
+    [[fallthrough]];
+  case RenderTarget::eAlbedo:
+  case RenderTarget::eSpecular:
+  case RenderTarget::eNormal:
+    return isOutput(target) || needsLighting();
+  case RenderTarget::eDepth:
+    return true;
+  default:
+    return isOutput(target);
+  }
+}
 
-  mRenderTargets.lighting2 = std::make_unique<VulkanImageData>(
-      mContext->getPhysicalDevice(), mContext->getDevice(), mRenderTargetFormats.colorFormat,
-      vk::Extent2D(mWidth, mHeight), 1, vk::ImageTiling::eOptimal,
-      vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled |
-          vk::ImageUsageFlagBits::eTransferSrc,
-      vk::ImageLayout::eUndefined, vk::MemoryPropertyFlagBits::eDeviceLocal,
-      vk::ImageAspectFlagBits::eColor);
+bool VulkanRenderer::useMergedPass() const {
+  // nothing to merge when only the G-buffer is rendered
+  return mConfig.mergeRenderPasses && needsLighting();
+}
+
+bool VulkanRenderer::useTiledLighting() const {
+  return mConfig.tiledLighting && needsLighting() && !useMergedPass();
+}
+
+bool VulkanRenderer::useShadows() const {
+  return mConfig.shadows && needsLighting() &&
+         mConfig.shadowCascadeCount + mConfig.shadowPointLightCount > 0;
+}
+
+bool VulkanRenderer::useSensorPass() const {
+  if (mConfig.customTextureCount || mConfig.viewCount > 1) {
+    return false;
+  }
+  for (auto target : mConfig.outputs) {
+    if (target != RenderTarget::eDepth && target != RenderTarget::eSegmentation) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool VulkanRenderer::isTransient(RenderTarget target) const {
+  if (!useMergedPass()) {
+    return false;
+  }
+  switch (target) {
+  case RenderTarget::eAlbedo:
+  case RenderTarget::ePosition:
+  case RenderTarget::eSpecular:
+  case RenderTarget::eNormal:
+    return mConfig.transientGBuffer || !isOutput(target);
+  case RenderTarget::eLighting:
+    return mConfig.transientGBuffer;
+  default:
+    return false;
+  }
+}
+
+void VulkanRenderer::initializeRenderTextures() {
+  if (mConfig.compactGBuffer) {
+    mRenderTargetFormats.albedoFormat = vk::Format::eR8G8B8A8Srgb;
+    mRenderTargetFormats.specularFormat = vk::Format::eR8G8B8A8Unorm;
+    mRenderTargetFormats.normalFormat = vk::Format::eR16G16Snorm;
+    mRenderTargetFormats.lightingFormat = vk::Format::eR16G16B16A16Sfloat;
+    mRenderTargetFormats.segmentationFormat = vk::Format::eR32G32Uint;
+  } else {
+    mRenderTargetFormats.albedoFormat = vk::Format::eR32G32B32A32Sfloat;
+    mRenderTargetFormats.specularFormat = vk::Format::eR32G32B32A32Sfloat;
+    mRenderTargetFormats.normalFormat = vk::Format::eR32G32B32A32Sfloat;
+    mRenderTargetFormats.lightingFormat = vk::Format::eR32G32B32A32Sfloat;
+    mRenderTargetFormats.segmentationFormat = vk::Format::eR32G32B32A32Uint;
+  }
+  // positions and user data are not packed, half precision is not enough for either
+  mRenderTargetFormats.positionFormat = vk::Format::eR32G32B32A32Sfloat;
+  mRenderTargetFormats.customFormat = vk::Format::eR32G32B32A32Sfloat;
+  mRenderTargetFormats.depthFormat = vk::Format::eD32Sfloat;
 
+  auto &f = mRenderTargetFormats;
+  auto physicalDevice = mContext->getPhysicalDevice();
+  // RG16 snorm attachments are optional, RG16 float holds the octahedral normal as well
+  if (mConfig.compactGBuffer &&
+      !supportsFormat(physicalDevice, f.normalFormat,
+                      vk::FormatFeatureFlagBits::eColorAttachment |
+                          vk::FormatFeatureFlagBits::eSampledImage)) {
+    log::warn("R16G16Snorm render targets are not supported, normals are stored as R16G16Sfloat");
+    f.normalFormat = vk::Format::eR16G16Sfloat;
+  }
+
+  // targets that are not needed for the outputs are not allocated
+  bool input = useMergedPass();
+  auto create = [&](RenderTarget target, vk::Format &format) -> std::unique_ptr<VulkanImageData> {
+    if (!needsTarget(target)) {
+      format = vk::Format::eUndefined;
+      return nullptr;
+    }
+    // tiled lighting writes the lighting target from a compute shader, transparency blends
+    // into it
+    bool storage = target == RenderTarget::eLighting && useTiledLighting();
+    bool blend = target == RenderTarget::eLighting;
+    checkRenderTargetFormat(physicalDevice, format, isTransient(target), storage, blend);
+    return createRenderTarget(*mContext, format, mWidth, mHeight, input, isTransient(target),
+                              storage, mConfig.viewCount);
+  };
+  mRenderTargets.albedo = create(RenderTarget::eAlbedo, f.albedoFormat);
+  mRenderTargets.position = create(RenderTarget::ePosition, f.positionFormat);
+  mRenderTargets.specular = create(RenderTarget::eSpecular, f.specularFormat);
+  mRenderTargets.normal = create(RenderTarget::eNormal, f.normalFormat);
+  mRenderTargets.segmentation = create(RenderTarget::eSegmentation, f.segmentationFormat);
+  mRenderTargets.depth = create(RenderTarget::eDepth, f.depthFormat);
+  mRenderTargets.lighting = create(RenderTarget::eLighting, f.lightingFormat);
+  if (needsLighting()) {
+    checkRenderTargetFormat(physicalDevice, f.lightingFormat, false, false, false);
+  }
+  if (mConfig.customTextureCount) {
+    checkRenderTargetFormat(physicalDevice, f.customFormat, false, false, false);
+  }
+  mRenderTargets.lighting2 =
+      needsLighting() ? createRenderTarget(*mContext, f.lightingFormat, mWidth, mHeight, false,
+                                           false, false, mConfig.viewCount)
+                      : nullptr;
   mRenderTargets.custom.resize(mConfig.customTextureCount);
   for (uint32_t i = 0; i < mConfig.customTextureCount; ++i) {
-    mRenderTargets.custom[i] = std::make_unique<VulkanImageData>(
-        mContext->getPhysicalDevice(), mContext->getDevice(), mRenderTargetFormats.colorFormat,
-        vk::Extent2D(mWidth, mHeight), 1, vk::ImageTiling::eOptimal,
-        vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled |
-            vk::ImageUsageFlagBits::eTransferSrc,
-        vk::ImageLayout::eUndefined, vk::MemoryPropertyFlagBits::eDeviceLocal,
-        vk::ImageAspectFlagBits::eColor);
+    mRenderTargets.custom[i] = createRenderTarget(*mContext, f.customFormat, mWidth, mHeight,
+                                                  false, false, false, mConfig.viewCount);
   }
 
-  auto commandBuffer = createCommandBuffer(mContext->getDevice(), mContext->getCommandPool(),
-                                           vk::CommandBufferLevel::ePrimary);
+  auto name = [this](std::unique_ptr<VulkanImageData> const &target, std::string const &name) {
+    if (target) {
+      mContext->setDebugName(target->mImage.get(), "render target " + name);
+    }
+  };
+  name(mRenderTargets.albedo, "albedo");
+  name(mRenderTargets.position, "position");
+  name(mRenderTargets.specular, "specular");
+  name(mRenderTargets.normal, "normal");
+  name(mRenderTargets.segmentation, "segmentation");
+  name(mRenderTargets.depth, "depth");
+  name(mRenderTargets.lighting, "lighting");
+  name(mRenderTargets.lighting2, "lighting2");
+  for (uint32_t i = 0; i < mConfig.customTextureCount; ++i) {
+    name(mRenderTargets.custom[i], "custom " + std::to_string(i));
+  }
 
   OneTimeSubmit(
       mContext->getDevice(), mContext->getCommandPool(), mContext->getGraphicsQueue(),
       [this](vk::CommandBuffer commandBuffer) {
-        transitionImageLayout(
-            commandBuffer, mRenderTargets.albedo.get()->mImage.get(),
-            mRenderTargetFormats.colorFormat, vk::ImageLayout::eUndefined,
-            vk::ImageLayout::eColorAttachmentOptimal, {},
-            vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
-            vk::PipelineStageFlagBits::eTopOfPipe,
-            vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::ImageAspectFlagBits::eColor);
-        transitionImageLayout(
-            commandBuffer, mRenderTargets.position.get()->mImage.get(),
-            mRenderTargetFormats.colorFormat, vk::ImageLayout::eUndefined,
-            vk::ImageLayout::eColorAttachmentOptimal, {},
-            vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
-            vk::PipelineStageFlagBits::eTopOfPipe,
-            vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::ImageAspectFlagBits::eColor);
-        transitionImageLayout(
-            commandBuffer, mRenderTargets.normal.get()->mImage.get(),
-            mRenderTargetFormats.colorFormat, vk::ImageLayout::eUndefined,
-            vk::ImageLayout::eColorAttachmentOptimal, {},
-            vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
-            vk::PipelineStageFlagBits::eTopOfPipe,
-            vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::ImageAspectFlagBits::eColor);
-        transitionImageLayout(
-            commandBuffer, mRenderTargets.lighting.get()->mImage.get(),
-            mRenderTargetFormats.colorFormat, vk::ImageLayout::eUndefined,
-            vk::ImageLayout::eColorAttachmentOptimal, {},
-            vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
-            vk::PipelineStageFlagBits::eTopOfPipe,
-            vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::ImageAspectFlagBits::eColor);
-        transitionImageLayout(
-            commandBuffer, mRenderTargets.lighting2.get()->mImage.get(),
-            mRenderTargetFormats.colorFormat, vk::ImageLayout::eUndefined,
-            vk::ImageLayout::eColorAttachmentOptimal, {},
-            vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
-            vk::PipelineStageFlagBits::eTopOfPipe,
-            vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::ImageAspectFlagBits::eColor);
+        std::vector<VulkanImageData *> colorTargets = {
+            mRenderTargets.albedo.get(),       mRenderTargets.position.get(),
+            mRenderTargets.specular.get(),     mRenderTargets.normal.get(),
+            mRenderTargets.segmentation.get(), mRenderTargets.lighting.get(),
+            mRenderTargets.lighting2.get()};
+        for (auto &target : mRenderTargets.custom) {
+          colorTargets.push_back(target.get());
+        }
+        for (auto target : colorTargets) {
+          if (!target) {
+            continue;
+          }
+          transitionImageLayout(
+              commandBuffer, target->mImage.get(), target->mFormat, vk::ImageLayout::eUndefined,
+              vk::ImageLayout::eColorAttachmentOptimal, {},
+              vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
+              vk::PipelineStageFlagBits::eTopOfPipe,
+              vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::ImageAspectFlagBits::eColor,
+              1, target->mArrayLayers);
+        }
         transitionImageLayout(commandBuffer, mRenderTargets.depth.get()->mImage.get(),
                               mRenderTargetFormats.depthFormat, vk::ImageLayout::eUndefined,
                               vk::ImageLayout::eDepthStencilAttachmentOptimal, {},
@@ -169,35 +464,103 @@ void VulkanRenderer::initializeRenderTextures() {
                               vk::PipelineStageFlagBits::eTopOfPipe,
                               vk::PipelineStageFlagBits::eEarlyFragmentTests |
                                   vk::PipelineStageFlagBits::eLateFragmentTests,
-                              vk::ImageAspectFlagBits::eDepth);
-
-        for (uint32_t i = 0; i < mConfig.customTextureCount; ++i) {
-          transitionImageLayout(
-              commandBuffer, mRenderTargets.custom[i].get()->mImage.get(),
-              mRenderTargetFormats.colorFormat, vk::ImageLayout::eUndefined,
-              vk::ImageLayout::eColorAttachmentOptimal, {},
-              vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
-              vk::PipelineStageFlagBits::eTopOfPipe,
-              vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::ImageAspectFlagBits::eColor);
-        }
+                              vk::ImageAspectFlagBits::eDepth, 1,
+                              mRenderTargets.depth->mArrayLayers);
       });
 
-  // bind textures to deferred descriptor set
+  // targets that are not kept are replaced by depth, the shaders do not read them
+  auto view = [this](std::unique_ptr<VulkanImageData> const &target) {
+    return (target ? target : mRenderTargets.depth)->mImageView.get();
+  };
+
   mDeferredSampler = mContext->getDevice().createSamplerUnique(vk::SamplerCreateInfo(
       vk::SamplerCreateFlags(), vk::Filter::eNearest, vk::Filter::eNearest,
       vk::SamplerMipmapMode::eNearest, vk::SamplerAddressMode::eClampToBorder,
       vk::SamplerAddressMode::eClampToBorder, vk::SamplerAddressMode::eClampToBorder, 0.f, false,
       0.f, false, vk::CompareOp::eNever, 0.f, 0.f, vk::BorderColor::eFloatOpaqueBlack));
+  if (useMergedPass()) {
+    // G-buffer and lighting are read as input attachments of the merged pass
+    std::vector<vk::DescriptorImageInfo> inputInfos = {
+        vk::DescriptorImageInfo({}, view(mRenderTargets.albedo),
+                                vk::ImageLayout::eShaderReadOnlyOptimal),
+        vk::DescriptorImageInfo({}, view(mRenderTargets.position),
+                                mRenderTargets.position
+                                    ? vk::ImageLayout::eShaderReadOnlyOptimal
+                                    : vk::ImageLayout::eDepthStencilReadOnlyOptimal),
+        vk::DescriptorImageInfo({}, view(mRenderTargets.specular),
+                                vk::ImageLayout::eShaderReadOnlyOptimal),
+        vk::DescriptorImageInfo({}, view(mRenderTargets.normal),
+                                vk::ImageLayout::eShaderReadOnlyOptimal),
+        vk::DescriptorImageInfo({}, view(mRenderTargets.depth),
+                                vk::ImageLayout::eDepthStencilReadOnlyOptimal)};
+    vk::DescriptorImageInfo lightingInfo({}, view(mRenderTargets.lighting),
+                                         vk::ImageLayout::eShaderReadOnlyOptimal);
+    std::vector<vk::WriteDescriptorSet> writeDescriptorSets = {
+        vk::WriteDescriptorSet(mLightingInputDescriptorSet.get(), 0, 0, inputInfos.size(),
+                               vk::DescriptorType::eInputAttachment, inputInfos.data()),
+        vk::WriteDescriptorSet(mCompositeInputDescriptorSet.get(), 0, 0, 1,
+                               vk::DescriptorType::eInputAttachment, &lightingInfo)};
+    mContext->getDevice().updateDescriptorSets(writeDescriptorSets, nullptr);
+  } else if (needsLighting()) {
+    initializeSamplerDescriptorSets();
+  }
+
+  if (useTiledLighting()) {
+    std::vector<vk::DescriptorImageInfo> imageInfos = {
+        vk::DescriptorImageInfo(mDeferredSampler.get(), view(mRenderTargets.albedo),
+                                vk::ImageLayout::eShaderReadOnlyOptimal),
+        vk::DescriptorImageInfo(mDeferredSampler.get(), view(mRenderTargets.position),
+                                vk::ImageLayout::eShaderReadOnlyOptimal),
+        vk::DescriptorImageInfo(mDeferredSampler.get(), view(mRenderTargets.specular),
+                                vk::ImageLayout::eShaderReadOnlyOptimal),
+        vk::DescriptorImageInfo(mDeferredSampler.get(), view(mRenderTargets.normal),
+                                vk::ImageLayout::eShaderReadOnlyOptimal),
+        vk::DescriptorImageInfo(mDeferredSampler.get(), view(mRenderTargets.depth),
+                                vk::ImageLayout::eShaderReadOnlyOptimal)};
+    vk::DescriptorImageInfo outputInfo({}, mRenderTargets.lighting->mImageView.get(),
+                                       vk::ImageLayout::eGeneral);
+    std::vector<vk::WriteDescriptorSet> writeDescriptorSets = {
+        vk::WriteDescriptorSet(mTiledLightingDescriptorSet.get(), 0, 0, imageInfos.size(),
+                               vk::DescriptorType::eCombinedImageSampler, imageInfos.data()),
+        vk::WriteDescriptorSet(mTiledLightingDescriptorSet.get(), 5, 0, 1,
+                               vk::DescriptorType::eStorageImage, &outputInfo)};
+    mContext->getDevice().updateDescriptorSets(writeDescriptorSets, nullptr);
+  }
+
+  // bind depth and output buffer to position reconstruction descriptor set
+  if (mConfig.positionFromDepth) {
+    mPositionBuffer = std::make_unique<VulkanBufferData>(
+        mContext->getPhysicalDevice(), mContext->getDevice(), mWidth * mHeight * sizeof(glm::vec4),
+        vk::BufferUsageFlagBits::eStorageBuffer);
+    vk::DescriptorImageInfo depthInfo(mDeferredSampler.get(), view(mRenderTargets.depth),
+                                      vk::ImageLayout::eShaderReadOnlyOptimal);
+    vk::DescriptorBufferInfo bufferInfo(mPositionBuffer->getBuffer(), 0, VK_WHOLE_SIZE);
+    std::vector<vk::WriteDescriptorSet> writeDescriptorSets = {
+        vk::WriteDescriptorSet(mPositionDescriptorSet.get(), 0, 0, 1,
+                               vk::DescriptorType::eCombinedImageSampler, &depthInfo),
+        vk::WriteDescriptorSet(mPositionDescriptorSet.get(), 1, 0, 1,
+                               vk::DescriptorType::eStorageBuffer, nullptr, &bufferInfo)};
+    mContext->getDevice().updateDescriptorSets(writeDescriptorSets, nullptr);
+  }
+}
+
+void VulkanRenderer::initializeSamplerDescriptorSets() {
+  // targets that are not kept are replaced by depth, the shaders do not read them
+  auto view = [this](std::unique_ptr<VulkanImageData> const &target) {
+    return (target ? target : mRenderTargets.depth)->mImageView.get();
+  };
+
+  // bind textures to deferred descriptor set
   std::vector<vk::DescriptorImageInfo> imageInfos = {
-      vk::DescriptorImageInfo(mDeferredSampler.get(), mRenderTargets.albedo->mImageView.get(),
+      vk::DescriptorImageInfo(mDeferredSampler.get(), view(mRenderTargets.albedo),
                               vk::ImageLayout::eShaderReadOnlyOptimal),
-      vk::DescriptorImageInfo(mDeferredSampler.get(), mRenderTargets.position->mImageView.get(),
+      vk::DescriptorImageInfo(mDeferredSampler.get(), view(mRenderTargets.position),
                               vk::ImageLayout::eShaderReadOnlyOptimal),
-      vk::DescriptorImageInfo(mDeferredSampler.get(), mRenderTargets.specular->mImageView.get(),
+      vk::DescriptorImageInfo(mDeferredSampler.get(), view(mRenderTargets.specular),
                               vk::ImageLayout::eShaderReadOnlyOptimal),
-      vk::DescriptorImageInfo(mDeferredSampler.get(), mRenderTargets.normal->mImageView.get(),
+      vk::DescriptorImageInfo(mDeferredSampler.get(), view(mRenderTargets.normal),
                               vk::ImageLayout::eShaderReadOnlyOptimal),
-      vk::DescriptorImageInfo(mDeferredSampler.get(), mRenderTargets.depth->mImageView.get(),
+      vk::DescriptorImageInfo(mDeferredSampler.get(), view(mRenderTargets.depth),
                               vk::ImageLayout::eShaderReadOnlyOptimal)};
   for (uint32_t i = 0; i < mConfig.customTextureCount; ++i) {
     imageInfos.push_back(vk::DescriptorImageInfo(mDeferredSampler.get(),
@@ -216,20 +579,20 @@ void VulkanRenderer::initializeRenderTextures() {
       vk::SamplerAddressMode::eClampToBorder, vk::SamplerAddressMode::eClampToBorder, 0.f, false,
       0.f, false, vk::CompareOp::eNever, 0.f, 0.f, vk::BorderColor::eFloatOpaqueBlack));
   imageInfos = {
-      vk::DescriptorImageInfo(mCompositeSampler.get(), mRenderTargets.lighting->mImageView.get(),
+      vk::DescriptorImageInfo(mCompositeSampler.get(), view(mRenderTargets.lighting),
                               vk::ImageLayout::eShaderReadOnlyOptimal),
-      vk::DescriptorImageInfo(mCompositeSampler.get(), mRenderTargets.albedo->mImageView.get(),
+      vk::DescriptorImageInfo(mCompositeSampler.get(), view(mRenderTargets.albedo),
                               vk::ImageLayout::eShaderReadOnlyOptimal),
-      vk::DescriptorImageInfo(mCompositeSampler.get(), mRenderTargets.position->mImageView.get(),
+      vk::DescriptorImageInfo(mCompositeSampler.get(), view(mRenderTargets.position),
                               vk::ImageLayout::eShaderReadOnlyOptimal),
-      vk::DescriptorImageInfo(mCompositeSampler.get(), mRenderTargets.specular->mImageView.get(),
+      vk::DescriptorImageInfo(mCompositeSampler.get(), view(mRenderTargets.specular),
                               vk::ImageLayout::eShaderReadOnlyOptimal),
-      vk::DescriptorImageInfo(mCompositeSampler.get(), mRenderTargets.normal->mImageView.get(),
+      vk::DescriptorImageInfo(mCompositeSampler.get(), view(mRenderTargets.normal),
                               vk::ImageLayout::eShaderReadOnlyOptimal),
       vk::DescriptorImageInfo(mCompositeSampler.get(),
-                              mRenderTargets.segmentation->mImageView.get(),
+                              view(mRenderTargets.segmentation),
                               vk::ImageLayout::eShaderReadOnlyOptimal),
-      vk::DescriptorImageInfo(mCompositeSampler.get(), mRenderTargets.depth->mImageView.get(),
+      vk::DescriptorImageInfo(mCompositeSampler.get(), view(mRenderTargets.depth),
                               vk::ImageLayout::eShaderReadOnlyOptimal)};
   for (uint32_t i = 0; i < mConfig.customTextureCount; ++i) {
     imageInfos.push_back(vk::DescriptorImageInfo(mDeferredSampler.get(),
@@ -263,35 +626,125 @@ void VulkanRenderer::initializeRenderPasses() {
     cullMode = vk::CullModeFlagBits::eNone;
   }
 
+  // initialize position reconstruction
+  if (mConfig.positionFromDepth) {
+    mPositionPass->initializePipeline(shaderDir, {mDescriptorSetLayouts.position.get()},
+                                      "position", sizeof(glm::mat4) + sizeof(glm::uvec2));
+  }
+
+  // conversion and pick pipelines are built on first use
+  mConvertPass->initializePipeline(shaderDir);
+  mPickPass->initializePipeline(shaderDir);
+  // point cloud and segmentation stats pipelines are built on first use
+  mPointCloudPasses.clear();
+  mSegmentationStatsPass.reset();
+
+  if (useShadows()) {
+    mShadowPass->initializePipeline(shaderDir, l.object.get(), vk::Format::eD32Sfloat);
+  }
+
+  if (useSensorPass()) {
+    std::vector<vk::DescriptorSetLayout> layouts = {l.scene.get(), l.camera.get(), l.object.get(),
+                                                    l.material.get()};
+    std::vector<vk::ImageView> imageViews;
+    if (mRenderTargets.segmentation) {
+      imageViews.push_back(mRenderTargets.segmentation->mImageView.get());
+    }
+    mSensorPass->initializePipeline(shaderDir, layouts, mRenderTargetFormats.segmentationFormat,
+                                    mRenderTargetFormats.depthFormat, cullMode,
+                                    vk::FrontFace::eCounterClockwise);
+    mSensorPass->initializeFramebuffer(
+        imageViews, mRenderTargets.depth->mImageView.get(),
+        {static_cast<uint32_t>(mWidth), static_cast<uint32_t>(mHeight)});
+    return;
+  }
+
+  if (useMergedPass()) {
+    std::vector<vk::DescriptorSetLayout> geometryLayouts = {l.scene.get(), l.camera.get(),
+                                                            l.object.get(), l.material.get()};
+    std::vector<vk::DescriptorSetLayout> lightingLayouts = {
+        l.scene.get(), l.camera.get(), mDescriptorSetLayouts.lightingInput.get()};
+    std::vector<vk::DescriptorSetLayout> compositeLayouts = {
+        mDescriptorSetLayouts.compositeInput.get()};
+
+    std::vector<vk::Format> colorFormats = {
+        mRenderTargetFormats.albedoFormat, mRenderTargetFormats.positionFormat,
+        mRenderTargetFormats.specularFormat, mRenderTargetFormats.normalFormat,
+        mRenderTargetFormats.segmentationFormat};
+    std::vector<bool> colorTransient = {
+        isTransient(RenderTarget::eAlbedo), isTransient(RenderTarget::ePosition),
+        isTransient(RenderTarget::eSpecular), isTransient(RenderTarget::eNormal),
+        isTransient(RenderTarget::eSegmentation)};
+    std::vector<vk::ImageView> imageViews;
+    for (auto &target : {std::cref(mRenderTargets.albedo), std::cref(mRenderTargets.position),
+                         std::cref(mRenderTargets.specular), std::cref(mRenderTargets.normal),
+                         std::cref(mRenderTargets.segmentation)}) {
+      if (target.get()) {
+        imageViews.push_back(target.get()->mImageView.get());
+      }
+    }
+    for (uint32_t i = 0; i < mConfig.customTextureCount; ++i) {
+      colorFormats.push_back(mRenderTargetFormats.customFormat);
+      colorTransient.push_back(false);
+      imageViews.push_back(mRenderTargets.custom[i]->mImageView.get());
+    }
+    imageViews.push_back(mRenderTargets.depth->mImageView.get());
+    imageViews.push_back(mRenderTargets.lighting->mImageView.get());
+    imageViews.push_back(mRenderTargets.lighting2->mImageView.get());
+
+    mMergedPass->initializePipeline(shaderDir, geometryLayouts, lightingLayouts, compositeLayouts,
+                                    colorFormats, colorTransient,
+                                    mRenderTargetFormats.depthFormat,
+                                    mRenderTargetFormats.lightingFormat,
+                                    isTransient(RenderTarget::eLighting), cullMode,
+                                    vk::FrontFace::eCounterClockwise, mConfig.compactGBuffer,
+                                    mConfig.positionFromDepth, mConfig.viewCount);
+    mMergedPass->initializeFramebuffer(
+        imageViews, {static_cast<uint32_t>(mWidth), static_cast<uint32_t>(mHeight)});
+    return;
+  }
+
   // initialize gbuffer pass
   {
     std::vector<vk::DescriptorSetLayout> layouts = {l.scene.get(), l.camera.get(), l.object.get(),
                                                     l.material.get()};
     std::vector<vk::Format> colorFormats = {
-        mRenderTargetFormats.colorFormat, mRenderTargetFormats.colorFormat,
-        mRenderTargetFormats.colorFormat, mRenderTargetFormats.colorFormat,
+        mRenderTargetFormats.albedoFormat, mRenderTargetFormats.positionFormat,
+        mRenderTargetFormats.specularFormat, mRenderTargetFormats.normalFormat,
         mRenderTargetFormats.segmentationFormat};
-    std::vector<vk::ImageView> imageViews = {
-        mRenderTargets.albedo->mImageView.get(), mRenderTargets.position->mImageView.get(),
-        mRenderTargets.specular->mImageView.get(), mRenderTargets.normal->mImageView.get(),
-        mRenderTargets.segmentation->mImageView.get()};
+    std::vector<vk::ImageView> imageViews;
+    for (auto &target : {std::cref(mRenderTargets.albedo), std::cref(mRenderTargets.position),
+                         std::cref(mRenderTargets.specular), std::cref(mRenderTargets.normal),
+                         std::cref(mRenderTargets.segmentation)}) {
+      if (target.get()) {
+        imageViews.push_back(target.get()->mImageView.get());
+      }
+    }
     for (uint32_t i = 0; i < mConfig.customTextureCount; ++i) {
-      colorFormats.push_back(mRenderTargetFormats.colorFormat);
+      colorFormats.push_back(mRenderTargetFormats.customFormat);
       imageViews.push_back(mRenderTargets.custom[i]->mImageView.get());
     }
     mGBufferPass->initializePipeline(shaderDir, layouts, colorFormats,
                                      mRenderTargetFormats.depthFormat, cullMode,
-                                     vk::FrontFace::eCounterClockwise);
+                                     vk::FrontFace::eCounterClockwise, mConfig.compactGBuffer);
     mGBufferPass->initializeFramebuffer(
         imageViews, mRenderTargets.depth->mImageView.get(),
         {static_cast<uint32_t>(mWidth), static_cast<uint32_t>(mHeight)});
   }
 
-  // initialize deferred pass
-  {
+  // initialize lighting
+  if (useTiledLighting()) {
+    mTiledLightingPass->initializePipeline(
+        shaderDir, {l.scene.get(), l.camera.get(), mDescriptorSetLayouts.tiledLighting.get()},
+        "lighting", 0,
+        {static_cast<uint32_t>(mConfig.compactGBuffer),
+         static_cast<uint32_t>(mConfig.positionFromDepth),
+         glm::floatBitsToUint(mConfig.tiledLightingCutoff)});
+  } else if (needsLighting()) {
     std::vector<vk::DescriptorSetLayout> layouts = {l.scene.get(), l.camera.get(),
                                                     mDescriptorSetLayouts.deferred.get()};
-    mDeferredPass->initializePipeline(shaderDir, layouts, {mRenderTargetFormats.colorFormat});
+    mDeferredPass->initializePipeline(shaderDir, layouts, {mRenderTargetFormats.lightingFormat},
+                                      mConfig.compactGBuffer, mConfig.positionFromDepth);
     mDeferredPass->initializeFramebuffer(
         {mRenderTargets.lighting->mImageView.get()},
         {static_cast<uint32_t>(mWidth), static_cast<uint32_t>(mHeight)});
@@ -302,29 +755,34 @@ void VulkanRenderer::initializeRenderPasses() {
     std::vector<vk::DescriptorSetLayout> layouts = {l.scene.get(), l.camera.get(), l.object.get(),
                                                     l.material.get()};
     std::vector<vk::Format> colorFormats = {
-        mRenderTargetFormats.colorFormat, mRenderTargetFormats.colorFormat,
-        mRenderTargetFormats.colorFormat, mRenderTargetFormats.colorFormat,
-        mRenderTargetFormats.colorFormat, mRenderTargetFormats.segmentationFormat};
-    std::vector<vk::ImageView> imageViews = {
-        mRenderTargets.lighting->mImageView.get(), mRenderTargets.albedo->mImageView.get(),
-        mRenderTargets.position->mImageView.get(), mRenderTargets.specular->mImageView.get(),
-        mRenderTargets.normal->mImageView.get(),   mRenderTargets.segmentation->mImageView.get()};
+        mRenderTargetFormats.lightingFormat, mRenderTargetFormats.albedoFormat,
+        mRenderTargetFormats.positionFormat, mRenderTargetFormats.specularFormat,
+        mRenderTargetFormats.normalFormat,   mRenderTargetFormats.segmentationFormat};
+    std::vector<vk::ImageView> imageViews;
+    for (auto &target : {std::cref(mRenderTargets.lighting), std::cref(mRenderTargets.albedo),
+                         std::cref(mRenderTargets.position), std::cref(mRenderTargets.specular),
+                         std::cref(mRenderTargets.normal), std::cref(mRenderTargets.segmentation)}) {
+      if (target.get()) {
+        imageViews.push_back(target.get()->mImageView.get());
+      }
+    }
     for (uint32_t i = 0; i < mConfig.customTextureCount; ++i) {
-      colorFormats.push_back(mRenderTargetFormats.colorFormat);
+      colorFormats.push_back(mRenderTargetFormats.customFormat);
       imageViews.push_back(mRenderTargets.custom[i]->mImageView.get());
     }
     mTransparencyPass->initializePipeline(shaderDir, layouts, colorFormats,
                                           mRenderTargetFormats.depthFormat, cullMode,
-                                          vk::FrontFace::eCounterClockwise);
+                                          vk::FrontFace::eCounterClockwise,
+                                          mConfig.compactGBuffer);
     mTransparencyPass->initializeFramebuffer(
         imageViews, mRenderTargets.depth->mImageView.get(),
         {static_cast<uint32_t>(mWidth), static_cast<uint32_t>(mHeight)});
   }
 
   // initialize composite pass
-  {
+  if (needsLighting()) {
     std::vector<vk::DescriptorSetLayout> layouts = {mDescriptorSetLayouts.composite.get()};
-    mCompositePass->initializePipeline(shaderDir, layouts, {mRenderTargetFormats.colorFormat},
+    mCompositePass->initializePipeline(shaderDir, layouts, {mRenderTargetFormats.lightingFormat},
                                        {"composite"});
     mCompositePass->initializeFramebuffer(
         {mRenderTargets.lighting2->mImageView.get()},
@@ -332,31 +790,89 @@ void VulkanRenderer::initializeRenderPasses() {
   }
 }
 
-void VulkanRenderer::render(vk::CommandBuffer commandBuffer, Scene &scene, Camera &camera) {
+vk::Extent2D VulkanRenderer::getTileExtent() const {
+  return {static_cast<uint32_t>(mTileWidth), static_cast<uint32_t>(mTileHeight)};
+}
+
+vk::Rect2D VulkanRenderer::getTile(uint32_t index) const {
+  return vk::Rect2D({static_cast<int32_t>(index % mTileColumns * mTileWidth),
+                     static_cast<int32_t>(index / mTileColumns * mTileHeight)},
+                    getTileExtent());
+}
+
+void VulkanRenderer::prepareScene(Scene &scene) {
   // sync object data to GPU
   scene.prepareObjectsForRender();
-  for (auto obj : scene.getOpaqueObjects()) {
-    obj->updateVulkanObject();
+  {
+    SVULKAN_PROFILE_SCOPE("updateVulkanObject");
+    for (auto obj : scene.getOpaqueObjects()) {
+      obj->updateVulkanObject();
+    }
+    for (auto obj : scene.getTransparentObjects()) {
+      obj->updateVulkanObject();
+    }
+  }
+  scene.updateUBO();
+}
+
+std::vector<PassTiming> VulkanRenderer::getPassTimings() const {
+  return mPasses.getTimings();
+}
+
+static CameraUBO getCameraData(Camera &camera) {
+  glm::mat4 view = camera.getViewMat();
+  glm::mat4 proj = camera.getProjectionMat();
+  return {view, proj, glm::inverse(view), glm::inverse(proj)};
+}
+
+void VulkanRenderer::render(vk::CommandBuffer target, Scene &scene, Camera &camera) {
+  SVULKAN_PROFILE_SCOPE("VulkanRenderer::render");
+  if (mConfig.viewCount > 1) {
+    throw std::runtime_error("This renderer renders several views, pass one camera per view");
   }
-  for (auto obj : scene.getTransparentObjects()) {
-    obj->updateVulkanObject();
+  if (mConfig.batchSize > 1) {
+    throw std::runtime_error("This renderer renders batches, use renderBatch");
   }
 
+  StatsCommandBuffer commandBuffer(target, mPasses.getCollector());
+  mPasses.beginFrame(commandBuffer);
+  prepareScene(scene);
+
   // sync camera data to GPU
   camera.updateUBO();
-  scene.updateUBO();
+  mRenderedCameras = {getCameraData(camera)};
+
+  if (useSensorPass()) {
+    renderSensor(commandBuffer, {{&scene, camera.mDescriptorSet.get(), getTile(0)}});
+    mPasses.endFrame();
+    return;
+  }
+  if (useShadows()) {
+    mPasses.begin(commandBuffer, "shadow");
+    renderShadows(commandBuffer, scene, camera);
+    mPasses.end(commandBuffer);
+  }
+  if (useMergedPass()) {
+    renderMerged(commandBuffer, {{&scene, camera.mDescriptorSet.get(), getTile(0)}});
+    mPasses.endFrame();
+    return;
+  }
 
   // render gbuffer pass
   {
+    mPasses.begin(commandBuffer, "gbuffer");
+    // clear values follow the allocated targets
     std::vector<vk::ClearValue> clearValues;
-    clearValues.push_back(vk::ClearColorValue(std::array<float, 4>{0.f, 0.f, 0.f, 1.f})); // albedo
-    clearValues.push_back(
-        vk::ClearColorValue(std::array<float, 4>{0.f, 0.f, 0.f, 0.f})); // position
-    clearValues.push_back(
-        vk::ClearColorValue(std::array<float, 4>{0.f, 0.f, 0.f, 0.f})); // specular
-    clearValues.push_back(vk::ClearColorValue(std::array<float, 4>{0.f, 0.f, 0.f, 0.f})); // normal
-    clearValues.push_back(
-        vk::ClearColorValue(std::array<float, 4>{0.f, 0.f, 0.f, 0.f})); // segmentation
+    if (mRenderTargets.albedo) {
+      clearValues.push_back(
+          vk::ClearColorValue(std::array<float, 4>{0.f, 0.f, 0.f, 1.f})); // albedo
+    }
+    for (auto target : {mRenderTargets.position.get(), mRenderTargets.specular.get(),
+                        mRenderTargets.normal.get(), mRenderTargets.segmentation.get()}) {
+      if (target) {
+        clearValues.push_back(vk::ClearColorValue(std::array<float, 4>{0.f, 0.f, 0.f, 0.f}));
+      }
+    }
     for (uint32_t i = 0; i < mConfig.customTextureCount; ++i) {
       clearValues.push_back(vk::ClearColorValue(std::array<float, 4>{0.f, 0.f, 0.f, 0.f}));
     }
@@ -397,10 +913,17 @@ void VulkanRenderer::render(vk::CommandBuffer commandBuffer, Scene &scene, Camer
       }
     }
     commandBuffer.endRenderPass();
+    mPasses.end(commandBuffer);
   }
 
+  // only the G-buffer and transparency are needed without lighting
+  bool lighting = needsLighting();
+
   // render deferred pass
-  {
+  if (useTiledLighting()) {
+    renderTiledLighting(commandBuffer, scene, camera);
+  } else if (lighting) {
+    mPasses.begin(commandBuffer, "deferred");
     // draw quad
     std::vector<vk::ClearValue> clearValues = {
         vk::ClearColorValue{std::array{0.f, 0.f, 0.f, 1.f}}};
@@ -426,10 +949,12 @@ void VulkanRenderer::render(vk::CommandBuffer commandBuffer, Scene &scene, Camer
 
     commandBuffer.draw(3, 1, 0, 0);
     commandBuffer.endRenderPass();
+    mPasses.end(commandBuffer);
   }
 
   // transparency pass
   if (scene.getTransparentObjects().size()) {
+    mPasses.begin(commandBuffer, "transparency");
     std::vector<vk::ClearValue> clearValues;
     clearValues.resize(7 + mConfig.customTextureCount);
     vk::RenderPassBeginInfo renderPassBeginInfo{
@@ -470,17 +995,52 @@ void VulkanRenderer::render(vk::CommandBuffer commandBuffer, Scene &scene, Camer
       }
     }
     commandBuffer.endRenderPass();
+    mPasses.end(commandBuffer);
+  } else if (!lighting) {
+    // the G-buffer pass leaves its targets readable by the deferred pass, return them to the
+    // attachment layouts downloads expect
+    std::vector<VulkanImageData *> targets = {
+        mRenderTargets.albedo.get(), mRenderTargets.position.get(), mRenderTargets.specular.get(),
+        mRenderTargets.normal.get(), mRenderTargets.segmentation.get()};
+    for (auto &target : mRenderTargets.custom) {
+      targets.push_back(target.get());
+    }
+    for (auto img : targets) {
+      if (!img) {
+        continue;
+      }
+      transitionImageLayout(
+          commandBuffer, img->mImage.get(), img->mFormat, vk::ImageLayout::eShaderReadOnlyOptimal,
+          vk::ImageLayout::eColorAttachmentOptimal, vk::AccessFlagBits::eColorAttachmentWrite,
+          vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
+          vk::PipelineStageFlagBits::eColorAttachmentOutput,
+          vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::ImageAspectFlagBits::eColor);
+    }
+    transitionImageLayout(
+        commandBuffer, mRenderTargets.depth->mImage.get(), mRenderTargetFormats.depthFormat,
+        vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eDepthStencilAttachmentOptimal,
+        vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+        vk::AccessFlagBits::eDepthStencilAttachmentRead |
+            vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+        vk::PipelineStageFlagBits::eEarlyFragmentTests |
+            vk::PipelineStageFlagBits::eLateFragmentTests,
+        vk::PipelineStageFlagBits::eEarlyFragmentTests |
+            vk::PipelineStageFlagBits::eLateFragmentTests,
+        vk::ImageAspectFlagBits::eDepth);
   }
 
   // composite pass
-  {
+  if (lighting) {
+    mPasses.begin(commandBuffer, "composite");
     // transition to texture formats
-    for (auto img :
-         {mRenderTargets.lighting->mImage.get(), mRenderTargets.albedo->mImage.get(),
-          mRenderTargets.position->mImage.get(), mRenderTargets.specular->mImage.get(),
-          mRenderTargets.normal->mImage.get(), mRenderTargets.segmentation->mImage.get()}) {
+    for (auto img : {mRenderTargets.lighting.get(), mRenderTargets.albedo.get(),
+                     mRenderTargets.position.get(), mRenderTargets.specular.get(),
+                     mRenderTargets.normal.get(), mRenderTargets.segmentation.get()}) {
+      if (!img) {
+        continue;
+      }
       transitionImageLayout(
-          commandBuffer, img, mRenderTargetFormats.colorFormat,
+          commandBuffer, img->mImage.get(), img->mFormat,
           vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
           vk::AccessFlagBits::eColorAttachmentWrite, vk::AccessFlagBits::eShaderRead,
           vk::PipelineStageFlagBits::eColorAttachmentOutput,
@@ -488,7 +1048,7 @@ void VulkanRenderer::render(vk::CommandBuffer commandBuffer, Scene &scene, Camer
     }
     for (uint32_t i = 0; i < mConfig.customTextureCount; ++i) {
       transitionImageLayout(
-          commandBuffer, mRenderTargets.custom[i]->mImage.get(), mRenderTargetFormats.colorFormat,
+          commandBuffer, mRenderTargets.custom[i]->mImage.get(), mRenderTargetFormats.customFormat,
           vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
           vk::AccessFlagBits::eColorAttachmentWrite, vk::AccessFlagBits::eShaderRead,
           vk::PipelineStageFlagBits::eColorAttachmentOutput,
@@ -523,12 +1083,14 @@ void VulkanRenderer::render(vk::CommandBuffer commandBuffer, Scene &scene, Camer
     commandBuffer.endRenderPass();
 
     // transition textures back to gbuffer formats
-    for (auto img :
-         {mRenderTargets.lighting->mImage.get(), mRenderTargets.albedo->mImage.get(),
-          mRenderTargets.position->mImage.get(), mRenderTargets.specular->mImage.get(),
-          mRenderTargets.normal->mImage.get(), mRenderTargets.segmentation->mImage.get()}) {
+    for (auto img : {mRenderTargets.lighting.get(), mRenderTargets.albedo.get(),
+                     mRenderTargets.position.get(), mRenderTargets.specular.get(),
+                     mRenderTargets.normal.get(), mRenderTargets.segmentation.get()}) {
+      if (!img) {
+        continue;
+      }
       transitionImageLayout(
-          commandBuffer, img, mRenderTargetFormats.colorFormat,
+          commandBuffer, img->mImage.get(), img->mFormat,
           vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eColorAttachmentOptimal,
           vk::AccessFlagBits::eShaderRead,
           vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
@@ -545,109 +1107,1554 @@ void VulkanRenderer::render(vk::CommandBuffer commandBuffer, Scene &scene, Camer
         vk::PipelineStageFlagBits::eEarlyFragmentTests |
             vk::PipelineStageFlagBits::eLateFragmentTests,
         vk::ImageAspectFlagBits::eDepth);
+    mPasses.end(commandBuffer);
   }
+  mPasses.endFrame();
 }
 
-void VulkanRenderer::display(vk::CommandBuffer commandBuffer, vk::Image swapchainImage,
-                             vk::Format swapchainFormat, uint32_t width, uint32_t height) {
-  auto &img = mRenderTargets.lighting2;
+void VulkanRenderer::renderSensor(StatsCommandBuffer commandBuffer,
+                                  std::vector<View> const &views) {
+  std::vector<vk::ClearValue> clearValues;
+  if (mRenderTargets.segmentation) {
+    clearValues.push_back(vk::ClearColorValue(std::array<float, 4>{0.f, 0.f, 0.f, 0.f}));
+  }
+  clearValues.push_back(vk::ClearDepthStencilValue(1.0f, 0));
 
-  transitionImageLayout(
-      commandBuffer, img->mImage.get(), mRenderTargetFormats.colorFormat,
-      vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eTransferSrcOptimal,
-      vk::AccessFlagBits::eColorAttachmentWrite, vk::AccessFlagBits::eTransferRead,
-      vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eTransfer,
-      vk::ImageAspectFlagBits::eColor);
-  transitionImageLayout(commandBuffer, swapchainImage, swapchainFormat,
-                        vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, {},
-                        vk::AccessFlagBits::eTransferWrite, vk::PipelineStageFlagBits::eTopOfPipe,
-                        vk::PipelineStageFlagBits::eTransfer, vk::ImageAspectFlagBits::eColor);
-  vk::ImageSubresourceLayers imageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
-  vk::ImageBlit imageBlit(imageSubresourceLayers,
-                          {{vk::Offset3D{0, 0, 0}, vk::Offset3D{mWidth, mHeight, 1}}},
-                          imageSubresourceLayers,
-                          {{vk::Offset3D{0, 0, 0},
-                            vk::Offset3D{static_cast<int>(width), static_cast<int>(height), 1}}});
+  vk::RenderPassBeginInfo renderPassBeginInfo{
+      mSensorPass->getRenderPass(), mSensorPass->getFramebuffer(),
+      vk::Rect2D({0, 0}, {static_cast<uint32_t>(mWidth), static_cast<uint32_t>(mHeight)}),
+      static_cast<uint32_t>(clearValues.size()), clearValues.data()};
+  mPasses.begin(commandBuffer, "sensor");
+  commandBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
 
-  commandBuffer.blitImage(img->mImage.get(), vk::ImageLayout::eTransferSrcOptimal, swapchainImage,
-                          vk::ImageLayout::eTransferDstOptimal, imageBlit, vk::Filter::eNearest);
+  vk::Pipeline boundPipeline{};
+  for (auto &view : views) {
+    commandBuffer.setViewport(0, {{static_cast<float>(view.area.offset.x),
+                                   static_cast<float>(view.area.offset.y),
+                                   static_cast<float>(view.area.extent.width),
+                                   static_cast<float>(view.area.extent.height), 0.f, 1.f}});
+    commandBuffer.setScissor(0, view.area);
 
-  transitionImageLayout(
-      commandBuffer, img->mImage.get(), mRenderTargetFormats.colorFormat,
-      vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eColorAttachmentOptimal,
-      vk::AccessFlagBits::eTransferRead,
-      vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
-      vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eColorAttachmentOutput,
-      vk::ImageAspectFlagBits::eColor);
-  transitionImageLayout(commandBuffer, swapchainImage, swapchainFormat,
-                        vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::ePresentSrcKHR,
-                        vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eMemoryRead,
-                        vk::PipelineStageFlagBits::eTransfer,
-                        vk::PipelineStageFlagBits::eAllCommands, vk::ImageAspectFlagBits::eColor);
+    // sets 0-2 are shared by both pipeline layouts, only alpha tested objects bind a material
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                     mSensorPass->getPipelineLayout(), 1, view.camera, nullptr);
+    for (auto &objects : {std::cref(view.scene->getOpaqueObjects()),
+                          std::cref(view.scene->getTransparentObjects())}) {
+      for (auto obj : objects.get()) {
+        auto vobj = obj->getVulkanObject();
+        if (!vobj) {
+          continue;
+        }
+        bool alphaTest = vobj->mMaterial->isAlphaTested();
+        vk::Pipeline pipeline =
+            alphaTest ? mSensorPass->getAlphaTestPipeline() : mSensorPass->getPipeline();
+        if (pipeline != boundPipeline) {
+          commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+          boundPipeline = pipeline;
+        }
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                         mSensorPass->getPipelineLayout(), 2,
+                                         vobj->mDescriptorSet.get(), nullptr);
+        if (alphaTest) {
+          commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                           mSensorPass->getAlphaTestPipelineLayout(), 3,
+                                           vobj->mMaterial->getDescriptorSet(), nullptr);
+        }
+        commandBuffer.bindVertexBuffers(0, *vobj->mMesh->mVertexBuffer->mBuffer, {0});
+        commandBuffer.bindIndexBuffer(*vobj->mMesh->mIndexBuffer->mBuffer, 0,
+                                      vk::IndexType::eUint32);
+        commandBuffer.drawIndexed(vobj->mMesh->mIndexCount, 1, 0, 0, 0);
+      }
+    }
+  }
+  commandBuffer.endRenderPass();
+  mPasses.end(commandBuffer);
 }
 
-std::vector<float> VulkanRenderer::downloadAlbedo() {
-  size_t size = (mRenderTargets.albedo->mExtent.width * mRenderTargets.albedo->mExtent.height) *
-                4 * sizeof(float);
-  return mRenderTargets.albedo->download<float>(mContext->getPhysicalDevice(),
-                                                mContext->getDevice(), mContext->getCommandPool(),
-                                                mContext->getGraphicsQueue(), size);
-}
+void VulkanRenderer::renderShadows(StatsCommandBuffer commandBuffer, Scene &scene,
+                                   Camera &camera) {
+  ShadowUBO ubo{};
+  std::vector<glm::mat4> matrices;
+  float size = static_cast<float>(mConfig.shadowMapSize);
+  ubo.texelSize = 1.f / size;
 
-std::vector<float> VulkanRenderer::downloadPosition() {
-  size_t size = (mRenderTargets.albedo->mExtent.width * mRenderTargets.albedo->mExtent.height) *
-                4 * sizeof(float);
-  return mRenderTargets.position->download<float>(
-      mContext->getPhysicalDevice(), mContext->getDevice(), mContext->getCommandPool(),
-      mContext->getGraphicsQueue(), size);
-}
+  std::vector<Object *> staticCasters;
+  std::vector<Object *> dynamicCasters;
+  for (auto obj : scene.getOpaqueObjects()) {
+    if (obj->getVulkanObject()) {
+      (obj->isStatic() ? staticCasters : dynamicCasters).push_back(obj);
+    }
+  }
+  // dynamic casters are drawn over the cached layers with the same matrices, so cascades are
+  // only fit to the frustum when there is no static geometry to cache
+  bool cached = staticCasters.size();
 
-std::vector<float> VulkanRenderer::downloadSpecular() {
-  size_t size = (mRenderTargets.albedo->mExtent.width * mRenderTargets.albedo->mExtent.height) *
-                4 * sizeof(float);
-  return mRenderTargets.specular->download<float>(
-      mContext->getPhysicalDevice(), mContext->getDevice(), mContext->getCommandPool(),
-      mContext->getGraphicsQueue(), size);
-}
+  // cascades of the first directional light over slices of the camera frustum
+  auto &directionalLights = scene.getDirectionalLights();
+  if (mConfig.shadowCascadeCount && directionalLights.size() &&
+      glm::length(glm::vec3(directionalLights[0].direction)) > 0) {
+    glm::vec3 dir = glm::normalize(glm::vec3(directionalLights[0].direction));
+    glm::vec3 up = std::abs(dir.z) > 0.99f ? glm::vec3(0, 1, 0) : glm::vec3(0, 0, 1);
+    glm::mat4 lightView = glm::lookAt(glm::vec3(0), dir, up);
 
-std::vector<float> VulkanRenderer::downloadNormal() {
-  size_t size = (mRenderTargets.albedo->mExtent.width * mRenderTargets.albedo->mExtent.height) *
-                4 * sizeof(float);
-  return mRenderTargets.normal->download<float>(mContext->getPhysicalDevice(),
-                                                mContext->getDevice(), mContext->getCommandPool(),
-                                                mContext->getGraphicsQueue(), size);
-}
+    glm::mat4 invViewProj = glm::inverse(camera.getProjectionMat() * camera.getViewMat());
+    glm::mat4 invProj = glm::inverse(camera.getProjectionMat());
+    glm::vec3 eye = glm::vec3(glm::inverse(camera.getViewMat())[3]);
+    std::array<glm::vec3, 4> nearCorners, farCorners, viewNearCorners, viewFarCorners;
+    for (uint32_t i = 0; i < 4; ++i) {
+      glm::vec2 ndc(i & 1 ? 1.f : -1.f, i & 2 ? 1.f : -1.f);
+      glm::vec4 n = invViewProj * glm::vec4(ndc, 0.f, 1.f);
+      glm::vec4 f = invViewProj * glm::vec4(ndc, 1.f, 1.f);
+      nearCorners[i] = glm::vec3(n) / n.w;
+      farCorners[i] = glm::vec3(f) / f.w;
+      n = invProj * glm::vec4(ndc, 0.f, 1.f);
+      f = invProj * glm::vec4(ndc, 1.f, 1.f);
+      viewNearCorners[i] = glm::vec3(n) / n.w;
+      viewFarCorners[i] = glm::vec3(f) / f.w;
+    }
 
-std::vector<float> VulkanRenderer::downloadLighting() {
-  size_t size = (mRenderTargets.albedo->mExtent.width * mRenderTargets.albedo->mExtent.height) *
-                4 * sizeof(float);
-  return mRenderTargets.lighting2->download<float>(
-      mContext->getPhysicalDevice(), mContext->getDevice(), mContext->getCommandPool(),
-      mContext->getGraphicsQueue(), size);
-}
+    float near = camera.near;
+    float far = std::min(camera.far, mConfig.shadowDistance);
+    uint32_t count = mConfig.shadowCascadeCount;
+    float begin = near;
+    for (uint32_t c = 0; c < count; ++c) {
+      // blend of logarithmic and uniform splits
+      float p = static_cast<float>(c + 1) / count;
+      float end = 0.75f * near * std::pow(far / near, p) + 0.25f * (near + (far - near) * p);
 
-std::vector<float> VulkanRenderer::downloadDepth() {
-  size_t size = (mRenderTargets.albedo->mExtent.width * mRenderTargets.albedo->mExtent.height) *
-                sizeof(float);
-  return mRenderTargets.depth->download<float>(mContext->getPhysicalDevice(),
-                                               mContext->getDevice(), mContext->getCommandPool(),
-                                               mContext->getGraphicsQueue(), size);
-}
+      std::array<glm::vec3, 8> corners;
+      for (uint32_t i = 0; i < 4; ++i) {
+        corners[i] = glm::mix(nearCorners[i], farCorners[i], (begin - near) / (camera.far - near));
+        corners[i + 4] = glm::mix(nearCorners[i], farCorners[i], (end - near) / (camera.far - near));
+      }
+      glm::vec3 center(0.f);
+      float radius = 0.f;
+      float step;
+      if (cached) {
+        // a sphere around the camera holding the slice in every orientation, on a grid of a
+        // quarter radius, so the cache survives rotations and moves within a grid cell. The
+        // radius comes from the projection alone, it is exactly the same for every view.
+        center = eye;
+        for (uint32_t i = 0; i < 4; ++i) {
+          radius = std::max(radius, glm::length(glm::mix(viewNearCorners[i], viewFarCorners[i],
+                                                         (end - near) / (camera.far - near))));
+        }
+        radius = std::ceil(radius * 16.f) / 16.f;
+        step = 0.25f * radius;
+        radius += 2.f * step; // the snapped center is at most sqrt(3) steps away
+      } else {
+        // bounding sphere of the slice, its size does not change when the camera rotates
+        for (auto &corner : corners) {
+          center += corner / 8.f;
+        }
+        for (auto &corner : corners) {
+          radius = std::max(radius, glm::length(corner - center));
+        }
+        radius = std::ceil(radius * 16.f) / 16.f;
+        step = 2.f * radius / size;
+      }
+
+      // snap to the grid in light space, frustum fit cascades snap to texels across the light
+      glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.f));
+      lightCenter.x = std::floor(lightCenter.x / step) * step;
+      lightCenter.y = std::floor(lightCenter.y / step) * step;
+      if (cached) {
+        lightCenter.z = std::floor(lightCenter.z / step) * step;
+      }
+
+      // keep casters up to shadowDistance towards the light
+      glm::mat4 proj = glm::ortho(lightCenter.x - radius, lightCenter.x + radius,
+                                  lightCenter.y - radius, lightCenter.y + radius,
+                                  -lightCenter.z - radius - mConfig.shadowDistance,
+                                  -lightCenter.z + radius);
+      matrices.push_back(proj * lightView);
+      ubo.cascadeSplits[c] = end;
+      begin = end;
+    }
+    ubo.numCascades = count;
+  }
+
+  // 6 faces for each shadowed point light, the shaders pick the face by the major axis
+  auto &pointLights = scene.getPointLights();
+  uint32_t pointCount =
+      std::min(mConfig.shadowPointLightCount, static_cast<uint32_t>(pointLights.size()));
+  const std::array<std::pair<glm::vec3, glm::vec3>, 6> faces = {
+      {{{1, 0, 0}, {0, -1, 0}},
+       {{-1, 0, 0}, {0, -1, 0}},
+       {{0, 1, 0}, {0, 0, 1}},
+       {{0, -1, 0}, {0, 0, -1}},
+       {{0, 0, 1}, {0, -1, 0}},
+       {{0, 0, -1}, {0, -1, 0}}}};
+  glm::mat4 faceProj =
+      glm::perspective(glm::half_pi<float>(), 1.f, 0.05f, mConfig.shadowDistance);
+  for (uint32_t i = 0; i < pointCount; ++i) {
+    glm::vec3 pos = glm::vec3(pointLights[i].position);
+    for (auto &face : faces) {
+      matrices.push_back(faceProj * glm::lookAt(pos, pos + face.first, face.second));
+    }
+  }
+  ubo.numPointLightShadows = pointCount;
+
+  for (uint32_t i = 0; i < matrices.size(); ++i) {
+    ubo.lightMatrices[i] = matrices[i];
+  }
+  scene.getVulkanScene()->updateShadowUBO(ubo);
+
+  uint32_t usedLayers = static_cast<uint32_t>(matrices.size());
+  auto &maps = scene.getVulkanScene()->getShadowMaps(
+      mConfig.shadowMapSize, mConfig.shadowCascadeCount + 6 * mConfig.shadowPointLightCount);
+  maps.initializeFramebuffers(mContext->getDevice(), mShadowPass->getStaticRenderPass());
+  if (usedLayers == 0) {
+    maps.mUsedLayers = 0;
+    return;
+  }
+
+  auto drawLayer = [&](vk::RenderPass renderPass, vk::Framebuffer framebuffer,
+                       std::vector<Object *> const &casters, glm::mat4 const &matrix) {
+    vk::ClearValue clearValue = vk::ClearDepthStencilValue(1.0f, 0);
+    vk::RenderPassBeginInfo renderPassBeginInfo{
+        renderPass, framebuffer,
+        vk::Rect2D({0, 0}, {mConfig.shadowMapSize, mConfig.shadowMapSize}), 1, &clearValue};
+    commandBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, mShadowPass->getPipeline());
+    commandBuffer.setViewport(0, {{0.f, 0.f, size, size, 0.f, 1.f}});
+    commandBuffer.setScissor(0, {{{0, 0}, {mConfig.shadowMapSize, mConfig.shadowMapSize}}});
+    commandBuffer.pushConstants<glm::mat4>(mShadowPass->getPipelineLayout(),
+                                           vk::ShaderStageFlagBits::eVertex, 0, matrix);
+    for (auto obj : casters) {
+      auto vobj = obj->getVulkanObject();
+      commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                       mShadowPass->getPipelineLayout(), 0,
+                                       vobj->mDescriptorSet.get(), nullptr);
+      commandBuffer.bindVertexBuffers(0, *vobj->mMesh->mVertexBuffer->mBuffer, {0});
+      commandBuffer.bindIndexBuffer(*vobj->mMesh->mIndexBuffer->mBuffer, 0,
+                                    vk::IndexType::eUint32);
+      commandBuffer.drawIndexed(vobj->mMesh->mIndexCount, 1, 0, 0, 0);
+    }
+    commandBuffer.endRenderPass();
+  };
+
+  // refresh cached layers whose light or static geometry changed
+  bool refreshed = false;
+  for (uint32_t i = 0; i < usedLayers; ++i) {
+    if (maps.mCachedValid[i] && maps.mCachedMatrices[i] == matrices[i] &&
+        maps.mCachedVersions[i] == scene.getStaticVersion()) {
+      continue;
+    }
+    drawLayer(mShadowPass->getStaticRenderPass(), maps.mStaticFramebuffers[i].get(),
+              staticCasters, matrices[i]);
+    maps.mCachedValid[i] = true;
+    maps.mCachedMatrices[i] = matrices[i];
+    maps.mCachedVersions[i] = scene.getStaticVersion();
+    refreshed = true;
+  }
+
+  // the sampled maps still hold exactly the cache
+  bool dynamic = dynamicCasters.size();
+  if (!refreshed && !dynamic && !maps.mHasDynamicCasters && maps.mUsedLayers == usedLayers) {
+    return;
+  }
+  maps.mUsedLayers = usedLayers;
+  maps.mHasDynamicCasters = dynamic;
+
+  // copy the cache, then draw dynamic casters over it
+  vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, usedLayers);
+  commandBuffer.pipelineBarrier(
+      vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader,
+      vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr,
+      vk::ImageMemoryBarrier(vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eTransferWrite,
+                             vk::ImageLayout::eShaderReadOnlyOptimal,
+                             vk::ImageLayout::eTransferDstOptimal, VK_QUEUE_FAMILY_IGNORED,
+                             VK_QUEUE_FAMILY_IGNORED, maps.mImage->mImage.get(), range));
+  vk::ImageCopy region({vk::ImageAspectFlagBits::eDepth, 0, 0, usedLayers}, {0, 0, 0},
+                       {vk::ImageAspectFlagBits::eDepth, 0, 0, usedLayers}, {0, 0, 0},
+                       {mConfig.shadowMapSize, mConfig.shadowMapSize, 1});
+  commandBuffer.copyImage(maps.mStaticImage->mImage.get(), vk::ImageLayout::eTransferSrcOptimal,
+                          maps.mImage->mImage.get(), vk::ImageLayout::eTransferDstOptimal,
+                          region);
+
+  if (dynamic) {
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eEarlyFragmentTests |
+            vk::PipelineStageFlagBits::eLateFragmentTests,
+        {}, nullptr, nullptr,
+        vk::ImageMemoryBarrier(vk::AccessFlagBits::eTransferWrite,
+                               vk::AccessFlagBits::eDepthStencilAttachmentRead |
+                                   vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+                               vk::ImageLayout::eTransferDstOptimal,
+                               vk::ImageLayout::eDepthStencilAttachmentOptimal,
+                               VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                               maps.mImage->mImage.get(), range));
+    for (uint32_t i = 0; i < usedLayers; ++i) {
+      drawLayer(mShadowPass->getDynamicRenderPass(), maps.mFramebuffers[i].get(), dynamicCasters,
+                matrices[i]);
+    }
+  } else {
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader,
+        {}, nullptr, nullptr,
+        vk::ImageMemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+                               vk::ImageLayout::eTransferDstOptimal,
+                               vk::ImageLayout::eShaderReadOnlyOptimal, VK_QUEUE_FAMILY_IGNORED,
+                               VK_QUEUE_FAMILY_IGNORED, maps.mImage->mImage.get(), range));
+  }
+}
+
+void VulkanRenderer::renderTiledLighting(StatsCommandBuffer commandBuffer, Scene &scene,
+                                         Camera &camera) {
+  mPasses.begin(commandBuffer, "tiled lighting");
+  // the G-buffer pass leaves its targets in shader read layouts, wait for its writes
+  vk::MemoryBarrier barrier(vk::AccessFlagBits::eColorAttachmentWrite |
+                                vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+                            vk::AccessFlagBits::eShaderRead);
+  commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput |
+                                    vk::PipelineStageFlagBits::eLateFragmentTests,
+                                vk::PipelineStageFlagBits::eComputeShader, {}, barrier, nullptr,
+                                nullptr);
+
+  // every pixel is overwritten, the previous content is discarded
+  transitionImageLayout(commandBuffer, mRenderTargets.lighting->mImage.get(),
+                        mRenderTargetFormats.lightingFormat, vk::ImageLayout::eUndefined,
+                        vk::ImageLayout::eGeneral, {}, vk::AccessFlagBits::eShaderWrite,
+                        vk::PipelineStageFlagBits::eTopOfPipe,
+                        vk::PipelineStageFlagBits::eComputeShader, vk::ImageAspectFlagBits::eColor);
+
+  commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, mTiledLightingPass->getPipeline());
+  commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                   mTiledLightingPass->getPipelineLayout(), 0,
+                                   scene.getVulkanScene()->getDescriptorSet(), nullptr);
+  commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                   mTiledLightingPass->getPipelineLayout(), 1,
+                                   camera.mDescriptorSet.get(), nullptr);
+  commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                   mTiledLightingPass->getPipelineLayout(), 2,
+                                   mTiledLightingDescriptorSet.get(), nullptr);
+  // 16x16 tiles, see glsl/lighting.comp
+  commandBuffer.dispatch((mWidth + 15) / 16, (mHeight + 15) / 16, 1);
+
+  // transparency and composite expect the layout the deferred pass leaves
+  transitionImageLayout(
+      commandBuffer, mRenderTargets.lighting->mImage.get(), mRenderTargetFormats.lightingFormat,
+      vk::ImageLayout::eGeneral, vk::ImageLayout::eColorAttachmentOptimal,
+      vk::AccessFlagBits::eShaderWrite,
+      vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
+      vk::PipelineStageFlagBits::eComputeShader,
+      vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::ImageAspectFlagBits::eColor);
+  mPasses.end(commandBuffer);
+}
+
+void VulkanRenderer::render(vk::CommandBuffer target, Scene &scene,
+                            std::vector<Camera *> const &cameras) {
+  SVULKAN_PROFILE_SCOPE("VulkanRenderer::render");
+  if (cameras.size() != mConfig.viewCount || mConfig.viewCount < 2) {
+    throw std::runtime_error("The number of cameras must match viewCount");
+  }
+
+  StatsCommandBuffer commandBuffer(target, mPasses.getCollector());
+  mPasses.beginFrame(commandBuffer);
+  // object data is synced once and shared by all views
+  prepareScene(scene);
+
+  std::vector<CameraUBO> cameraData;
+  cameraData.reserve(cameras.size());
+  for (auto camera : cameras) {
+    cameraData.push_back(getCameraData(*camera));
+  }
+  copyToDevice<CameraUBO>(mContext->getDevice(), mMultiviewCameraBuffer->mMemory.get(),
+                          cameraData.data(), cameraData.size());
+  mRenderedCameras = cameraData;
+
+  renderMerged(commandBuffer, {{&scene, mMultiviewCameraDescriptorSet.get(), getTile(0)}});
+  mPasses.endFrame();
+}
+
+void VulkanRenderer::renderBatch(vk::CommandBuffer target,
+                                 std::vector<std::pair<Scene *, Camera *>> const &batch) {
+  SVULKAN_PROFILE_SCOPE("VulkanRenderer::renderBatch");
+  if (batch.empty() || batch.size() > mConfig.batchSize) {
+    throw std::runtime_error("A batch holds between 1 and batchSize scenes");
+  }
+
+  // a scene holds one set of shadow maps, fit to the camera it is rendered with
+  std::vector<Scene *> scenes;
+  for (auto &[scene, camera] : batch) {
+    if (std::find(scenes.begin(), scenes.end(), scene) == scenes.end()) {
+      scenes.push_back(scene);
+    } else if (useShadows()) {
+      throw std::runtime_error("With shadows, every pair of a batch needs its own scene");
+    }
+  }
+
+  StatsCommandBuffer commandBuffer(target, mPasses.getCollector());
+  mPasses.beginFrame(commandBuffer);
+  // object data is synced once per scene, pairs that share a scene share it
+  for (auto scene : scenes) {
+    prepareScene(*scene);
+  }
+  std::vector<View> views;
+  views.reserve(batch.size());
+  mRenderedCameras.clear();
+  for (uint32_t i = 0; i < batch.size(); ++i) {
+    auto [scene, camera] = batch[i];
+    camera->updateUBO();
+    mRenderedCameras.push_back(getCameraData(*camera));
+    // shadow maps belong to each scene and are rendered before the shared pass
+    if (useShadows()) {
+      mPasses.begin(commandBuffer, "shadow");
+      renderShadows(commandBuffer, *scene, *camera);
+      mPasses.end(commandBuffer);
+    }
+    views.push_back({scene, camera->mDescriptorSet.get(), getTile(i)});
+  }
+
+  if (useSensorPass()) {
+    renderSensor(commandBuffer, views);
+  } else {
+    renderMerged(commandBuffer, views);
+  }
+  mPasses.endFrame();
+}
+
+void VulkanRenderer::renderMerged(StatsCommandBuffer commandBuffer,
+                                  std::vector<View> const &views) {
+  // clear values follow the framebuffer attachments
+  std::vector<vk::ClearValue> clearValues;
+  clearValues.push_back(vk::ClearColorValue(std::array<float, 4>{0.f, 0.f, 0.f, 1.f})); // albedo
+  if (mRenderTargets.position) {
+    clearValues.push_back(vk::ClearColorValue(std::array<float, 4>{0.f, 0.f, 0.f, 0.f}));
+  }
+  clearValues.push_back(vk::ClearColorValue(std::array<float, 4>{0.f, 0.f, 0.f, 0.f})); // specular
+  clearValues.push_back(vk::ClearColorValue(std::array<float, 4>{0.f, 0.f, 0.f, 0.f})); // normal
+  if (mRenderTargets.segmentation) {
+    clearValues.push_back(vk::ClearColorValue(std::array<float, 4>{0.f, 0.f, 0.f, 0.f}));
+  }
+  for (uint32_t i = 0; i < mConfig.customTextureCount; ++i) {
+    clearValues.push_back(vk::ClearColorValue(std::array<float, 4>{0.f, 0.f, 0.f, 0.f}));
+  }
+  clearValues.push_back(vk::ClearDepthStencilValue(1.0f, 0));                           // depth
+  clearValues.push_back(vk::ClearColorValue(std::array<float, 4>{0.f, 0.f, 0.f, 1.f})); // lighting
+  clearValues.push_back(vk::ClearColorValue(std::array<float, 4>{0.f, 0.f, 0.f, 1.f})); // output
+
+  vk::Rect2D renderArea({0, 0},
+                        {static_cast<uint32_t>(mWidth), static_cast<uint32_t>(mHeight)});
+  vk::RenderPassBeginInfo renderPassBeginInfo{
+      mMergedPass->getRenderPass(), mMergedPass->getFramebuffer(), renderArea,
+      static_cast<uint32_t>(clearValues.size()), clearValues.data()};
+  // subpasses cannot be timed separately, timestamps inside a multiview pass use one query
+  // per view
+  mPasses.begin(commandBuffer, "merged");
+  commandBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
+
+  auto setArea = [&](vk::Rect2D const &area) {
+    commandBuffer.setViewport(
+        0, {{static_cast<float>(area.offset.x), static_cast<float>(area.offset.y),
+             static_cast<float>(area.extent.width), static_cast<float>(area.extent.height), 0.f,
+             1.f}});
+    commandBuffer.setScissor(0, area);
+  };
+
+  auto drawObjects = [&](vk::PipelineLayout layout, View const &view, auto const &objects) {
+    setArea(view.area);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, 0,
+                                     view.scene->getVulkanScene()->getDescriptorSet(), nullptr);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, 1, view.camera,
+                                     nullptr);
+    for (auto &obj : objects) {
+      auto vobj = obj->getVulkanObject();
+      if (vobj) {
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, 2,
+                                         vobj->mDescriptorSet.get(), nullptr);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, 3,
+                                         vobj->mMaterial->getDescriptorSet(), nullptr);
+        commandBuffer.bindVertexBuffers(0, *vobj->mMesh->mVertexBuffer->mBuffer, {0});
+        commandBuffer.bindIndexBuffer(*vobj->mMesh->mIndexBuffer->mBuffer, 0,
+                                      vk::IndexType::eUint32);
+        commandBuffer.drawIndexed(vobj->mMesh->mIndexCount, 1, 0, 0, 0);
+      }
+    }
+  };
+
+  // G-buffer
+  commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, mMergedPass->getGBufferPipeline());
+  for (auto &view : views) {
+    drawObjects(mMergedPass->getGBufferPipelineLayout(), view, view.scene->getOpaqueObjects());
+  }
+
+  // lighting, the full screen triangle covers the viewport of each tile
+  commandBuffer.nextSubpass(vk::SubpassContents::eInline);
+  commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                             mMergedPass->getLightingPipeline());
+  commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                   mMergedPass->getLightingPipelineLayout(), 2,
+                                   mLightingInputDescriptorSet.get(), nullptr);
+  for (auto &view : views) {
+    setArea(view.area);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                     mMergedPass->getLightingPipelineLayout(), 0,
+                                     view.scene->getVulkanScene()->getDescriptorSet(), nullptr);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                     mMergedPass->getLightingPipelineLayout(), 1, view.camera,
+                                     nullptr);
+    commandBuffer.draw(3, 1, 0, 0);
+  }
+
+  // transparency
+  commandBuffer.nextSubpass(vk::SubpassContents::eInline);
+  bool transparencyBound = false;
+  for (auto &view : views) {
+    if (view.scene->getTransparentObjects().empty()) {
+      continue;
+    }
+    if (!transparencyBound) {
+      commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                                 mMergedPass->getTransparencyPipeline());
+      commandBuffer.pushConstants<float>(mMergedPass->getTransparencyPipelineLayout(),
+                                         vk::ShaderStageFlagBits::eFragment, 0, 1.f);
+      transparencyBound = true;
+    }
+    drawObjects(mMergedPass->getTransparencyPipelineLayout(), view,
+                view.scene->getTransparentObjects());
+  }
+
+  // composite does not depend on the scene and runs once over all tiles
+  commandBuffer.nextSubpass(vk::SubpassContents::eInline);
+  setArea(renderArea);
+  commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                             mMergedPass->getCompositePipeline());
+  commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                   mMergedPass->getCompositePipelineLayout(), 0,
+                                   mCompositeInputDescriptorSet.get(), nullptr);
+  commandBuffer.draw(3, 1, 0, 0);
+  commandBuffer.endRenderPass();
+  mPasses.end(commandBuffer);
+}
+
+void VulkanRenderer::display(vk::CommandBuffer commandBuffer, vk::Image swapchainImage,
+                             vk::Format swapchainFormat, uint32_t width, uint32_t height) {
+  auto &img = mRenderTargets.lighting2;
+  if (!img) {
+    throw std::runtime_error("Display requires the lighting output");
+  }
+
+  transitionImageLayout(
+      commandBuffer, img->mImage.get(), img->mFormat,
+      vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eTransferSrcOptimal,
+      vk::AccessFlagBits::eColorAttachmentWrite, vk::AccessFlagBits::eTransferRead,
+      vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eTransfer,
+      vk::ImageAspectFlagBits::eColor);
+  transitionImageLayout(commandBuffer, swapchainImage, swapchainFormat,
+                        vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, {},
+                        vk::AccessFlagBits::eTransferWrite, vk::PipelineStageFlagBits::eTopOfPipe,
+                        vk::PipelineStageFlagBits::eTransfer, vk::ImageAspectFlagBits::eColor);
+  vk::ImageSubresourceLayers imageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+  vk::ImageBlit imageBlit(imageSubresourceLayers,
+                          {{vk::Offset3D{0, 0, 0}, vk::Offset3D{mWidth, mHeight, 1}}},
+                          imageSubresourceLayers,
+                          {{vk::Offset3D{0, 0, 0},
+                            vk::Offset3D{static_cast<int>(width), static_cast<int>(height), 1}}});
+
+  commandBuffer.blitImage(img->mImage.get(), vk::ImageLayout::eTransferSrcOptimal, swapchainImage,
+                          vk::ImageLayout::eTransferDstOptimal, imageBlit, vk::Filter::eNearest);
+
+  transitionImageLayout(
+      commandBuffer, img->mImage.get(), img->mFormat,
+      vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eColorAttachmentOptimal,
+      vk::AccessFlagBits::eTransferRead,
+      vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
+      vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eColorAttachmentOutput,
+      vk::ImageAspectFlagBits::eColor);
+  transitionImageLayout(commandBuffer, swapchainImage, swapchainFormat,
+                        vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::ePresentSrcKHR,
+                        vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eMemoryRead,
+                        vk::PipelineStageFlagBits::eTransfer,
+                        vk::PipelineStageFlagBits::eAllCommands, vk::ImageAspectFlagBits::eColor);
+}
+
+static float srgbToLinear(uint8_t value) {
+  float c = value / 255.f;
+  return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+VulkanImageData &VulkanRenderer::getDownloadTarget(RenderTarget target) {
+  VulkanImageData *image = nullptr;
+  switch (target) {
+  case RenderTarget::eAlbedo:
+    image = mRenderTargets.albedo.get();
+    break;
+  case RenderTarget::ePosition:
+    image = mRenderTargets.position.get();
+    break;
+  case RenderTarget::eSpecular:
+    image = mRenderTargets.specular.get();
+    break;
+  case RenderTarget::eNormal:
+    image = mRenderTargets.normal.get();
+    break;
+  case RenderTarget::eSegmentation:
+    image = mRenderTargets.segmentation.get();
+    break;
+  case RenderTarget::eDepth:
+    image = mRenderTargets.depth.get();
+    break;
+  case RenderTarget::eLighting:
+    image = mRenderTargets.lighting2.get();
+    break;
+  }
+  // lighting2 holds the composited lighting and is never transient
+  if (!image || (target != RenderTarget::eLighting && isTransient(target))) {
+    throw std::runtime_error("This render target is not an output of the renderer");
+  }
+  return *image;
+}
+
+// normals of the compact G-buffer are stored octahedral encoded
+static glm::vec3 decodeOctahedral(glm::vec2 encoded) {
+  glm::vec3 n{encoded.x, encoded.y, 1.f - std::abs(encoded.x) - std::abs(encoded.y)};
+  float t = std::max(-n.z, 0.f);
+  n.x += n.x >= 0.f ? -t : t;
+  n.y += n.y >= 0.f ? -t : t;
+  return glm::normalize(n);
+}
+
+/** Expand count pixels of a downloaded target to 4 floats per pixel (1 for depth), decoding
+ *  packed formats */
+static std::vector<float> unpackFloat4(vk::Format format, char const *raw, size_t count) {
+  switch (format) {
+  case vk::Format::eR32G32B32A32Sfloat: {
+    std::vector<float> output(count * 4);
+    memcpy(output.data(), raw, output.size() * sizeof(float));
+    return output;
+  }
+  case vk::Format::eD32Sfloat:
+  case vk::Format::eR32Sfloat: {
+    std::vector<float> output(count);
+    memcpy(output.data(), raw, output.size() * sizeof(float));
+    return output;
+  }
+  case vk::Format::eR16G16B16A16Sfloat: {
+    auto half = reinterpret_cast<uint16_t const *>(raw);
+    std::vector<float> output(count * 4);
+    for (size_t i = 0; i < output.size(); ++i) {
+      output[i] = glm::unpackHalf1x16(half[i]);
+    }
+    return output;
+  }
+  case vk::Format::eR8G8B8A8Unorm: {
+    auto bytes = reinterpret_cast<uint8_t const *>(raw);
+    std::vector<float> output(count * 4);
+    for (size_t i = 0; i < output.size(); ++i) {
+      output[i] = bytes[i] / 255.f;
+    }
+    return output;
+  }
+  case vk::Format::eR8G8B8A8Srgb: {
+    static const std::array<float, 256> table = [] {
+      std::array<float, 256> table;
+      for (uint32_t i = 0; i < 256; ++i) {
+        table[i] = srgbToLinear(i);
+      }
+      return table;
+    }();
+    auto bytes = reinterpret_cast<uint8_t const *>(raw);
+    std::vector<float> output(count * 4);
+    for (size_t i = 0; i < output.size(); i += 4) {
+      output[i] = table[bytes[i]];
+      output[i + 1] = table[bytes[i + 1]];
+      output[i + 2] = table[bytes[i + 2]];
+      output[i + 3] = bytes[i + 3] / 255.f;
+    }
+    return output;
+  }
+  case vk::Format::eR16G16Snorm:
+  case vk::Format::eR16G16Sfloat: {
+    auto packed = reinterpret_cast<uint16_t const *>(raw);
+    bool snorm = format == vk::Format::eR16G16Snorm;
+    auto unpack = [snorm](uint16_t value) {
+      return snorm ? glm::unpackSnorm1x16(value) : glm::unpackHalf1x16(value);
+    };
+    std::vector<float> output(count * 4);
+    for (size_t i = 0; i < count; ++i) {
+      glm::vec3 n = decodeOctahedral({unpack(packed[2 * i]), unpack(packed[2 * i + 1])});
+      output[4 * i] = n.x;
+      output[4 * i + 1] = n.y;
+      output[4 * i + 2] = n.z;
+      output[4 * i + 3] = 0.f;
+    }
+    return output;
+  }
+  default:
+    throw std::runtime_error("This image format does not support download");
+  }
+}
+
+// downloads the first tileCount tiles of the image
+static std::vector<float> downloadFloat4(VulkanContext &context, VulkanImageData &image,
+                                         vk::Extent2D tile, uint32_t tileCount) {
+  SVULKAN_PROFILE_SCOPE("download");
+  size_t count = size_t(tile.width) * tile.height * tileCount * image.mArrayLayers;
+  size_t size = count * getFormatSize(image.mFormat);
+  auto download = [&](auto t) {
+    return image.download<decltype(t)>(context.getPhysicalDevice(), context.getDevice(),
+                                       context.getCommandPool(), context.getGraphicsQueue(), size,
+                                       tile);
+  };
+
+  // full precision targets need no decoding
+  if (image.mFormat == vk::Format::eR32G32B32A32Sfloat) {
+    return download(float{});
+  }
+  auto raw = download(char{});
+  return unpackFloat4(image.mFormat, raw.data(), count);
+}
+
+std::vector<float> VulkanRenderer::downloadAlbedo() {
+  return downloadFloat4(*mContext, getDownloadTarget(RenderTarget::eAlbedo), getTileExtent(),
+                        mConfig.batchSize);
+}
+
+std::vector<float> VulkanRenderer::downloadPosition() {
+  if (!mConfig.positionFromDepth) {
+    return downloadFloat4(*mContext, getDownloadTarget(RenderTarget::ePosition),
+                          getTileExtent(), mConfig.batchSize);
+  }
+
+  struct {
+    glm::mat4 projectionMatrixInverse;
+    glm::uvec2 size;
+  } pushConstants{getProjectionsInverse()[0],
+                  {static_cast<uint32_t>(mWidth), static_cast<uint32_t>(mHeight)}};
+
+  OneTimeSubmit(
+      mContext->getDevice(), mContext->getCommandPool(), mContext->getGraphicsQueue(),
+      [&](vk::CommandBuffer commandBuffer) {
+        mPasses.begin(commandBuffer, "position");
+        transitionImageLayout(
+            commandBuffer, mRenderTargets.depth->mImage.get(), mRenderTargetFormats.depthFormat,
+            vk::ImageLayout::eDepthStencilAttachmentOptimal,
+            vk::ImageLayout::eShaderReadOnlyOptimal,
+            vk::AccessFlagBits::eDepthStencilAttachmentWrite, vk::AccessFlagBits::eShaderRead,
+            vk::PipelineStageFlagBits::eEarlyFragmentTests |
+                vk::PipelineStageFlagBits::eLateFragmentTests,
+            vk::PipelineStageFlagBits::eComputeShader, vk::ImageAspectFlagBits::eDepth);
+
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, mPositionPass->getPipeline());
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                         mPositionPass->getPipelineLayout(), 0,
+                                         mPositionDescriptorSet.get(), nullptr);
+        commandBuffer.pushConstants(mPositionPass->getPipelineLayout(),
+                                    vk::ShaderStageFlagBits::eCompute, 0, sizeof(pushConstants),
+                                    &pushConstants);
+        commandBuffer.dispatch((mWidth + 15) / 16, (mHeight + 15) / 16, 1);
+
+        transitionImageLayout(
+            commandBuffer, mRenderTargets.depth->mImage.get(), mRenderTargetFormats.depthFormat,
+            vk::ImageLayout::eShaderReadOnlyOptimal,
+            vk::ImageLayout::eDepthStencilAttachmentOptimal, vk::AccessFlagBits::eShaderRead,
+            vk::AccessFlagBits::eDepthStencilAttachmentRead |
+                vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+            vk::PipelineStageFlagBits::eComputeShader,
+            vk::PipelineStageFlagBits::eEarlyFragmentTests |
+                vk::PipelineStageFlagBits::eLateFragmentTests,
+            vk::ImageAspectFlagBits::eDepth);
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eHost, {},
+            vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eHostRead),
+            nullptr, nullptr);
+        mPasses.end(commandBuffer);
+      });
+
+  size_t size = mWidth * mHeight * sizeof(glm::vec4);
+  std::vector<float> output(mWidth * mHeight * 4);
+  const char *memory = static_cast<const char *>(
+      mContext->getDevice().mapMemory(mPositionBuffer->getMemory(), 0, size));
+  memcpy(output.data(), memory, size);
+  mContext->getDevice().unmapMemory(mPositionBuffer->getMemory());
+  return output;
+}
+
+std::vector<float> VulkanRenderer::downloadSpecular() {
+  return downloadFloat4(*mContext, getDownloadTarget(RenderTarget::eSpecular), getTileExtent(),
+                        mConfig.batchSize);
+}
+
+std::vector<float> VulkanRenderer::downloadNormal() {
+  return downloadFloat4(*mContext, getDownloadTarget(RenderTarget::eNormal), getTileExtent(),
+                        mConfig.batchSize);
+}
+
+std::vector<float> VulkanRenderer::downloadLighting() {
+  return downloadFloat4(*mContext, getDownloadTarget(RenderTarget::eLighting), getTileExtent(),
+                        mConfig.batchSize);
+}
+
+std::vector<float> VulkanRenderer::downloadDepth() {
+  size_t size =
+      mTileWidth * mTileHeight * mConfig.batchSize * mConfig.viewCount * sizeof(float);
+  return getDownloadTarget(RenderTarget::eDepth).download<float>(
+      mContext->getPhysicalDevice(), mContext->getDevice(), mContext->getCommandPool(),
+      mContext->getGraphicsQueue(), size, getTileExtent());
+}
 
 std::vector<uint32_t> VulkanRenderer::downloadSegmentation() {
-  size_t size = (mRenderTargets.albedo->mExtent.width * mRenderTargets.albedo->mExtent.height) *
-                4 * sizeof(uint32_t);
-  return mRenderTargets.segmentation->download<uint32_t>(
+  size_t size = mTileWidth * mTileHeight * mConfig.batchSize * mConfig.viewCount *
+                getFormatSize(mRenderTargetFormats.segmentationFormat);
+  return getDownloadTarget(RenderTarget::eSegmentation).download<uint32_t>(
       mContext->getPhysicalDevice(), mContext->getDevice(), mContext->getCommandPool(),
-      mContext->getGraphicsQueue(), size);
+      mContext->getGraphicsQueue(), size, getTileExtent());
 }
 
 std::vector<float> VulkanRenderer::downloadCustom(uint32_t index) {
-  size_t size = (mRenderTargets.albedo->mExtent.width * mRenderTargets.albedo->mExtent.height) *
-                4 * sizeof(float);
-  return mRenderTargets.custom[index]->download<float>(
-      mContext->getPhysicalDevice(), mContext->getDevice(), mContext->getCommandPool(),
-      mContext->getGraphicsQueue(), size);
+  return downloadFloat4(*mContext, *mRenderTargets.custom[index], getTileExtent(),
+                        mConfig.batchSize);
+}
+
+static void waitForReadback(vk::Device device, vk::Fence fence) {
+  SVULKAN_PROFILE_SCOPE("download wait");
+  device.waitForFences(fence, VK_TRUE, UINT64_MAX);
+}
+
+namespace {
+
+// Staging slot and descriptor sets of an asynchronous readback, kept until fence has signaled
+// even when the future is dropped without get(). A null fence means the caller waits for the
+// submission.
+struct AsyncReadback {
+  vk::Device device;
+  vk::Fence fence;
+  VulkanReadbackSlot slot;
+  std::vector<vk::UniqueDescriptorSet> descriptorSets;
+
+  AsyncReadback(vk::Device device, vk::Fence fence, VulkanReadbackSlot slot,
+                std::vector<vk::UniqueDescriptorSet> descriptorSets = {})
+      : device(device), fence(fence), slot(std::move(slot)),
+        descriptorSets(std::move(descriptorSets)) {}
+  AsyncReadback(AsyncReadback &&other)
+      : device(other.device), fence(std::exchange(other.fence, vk::Fence())),
+        slot(std::move(other.slot)), descriptorSets(std::move(other.descriptorSets)) {}
+  AsyncReadback &operator=(AsyncReadback &&other) = delete;
+  ~AsyncReadback() { wait(); }
+
+  void wait() {
+    if (fence) {
+      waitForReadback(device, fence);
+      fence = vk::Fence();
+    }
+  }
+};
+
+} // namespace
+
+// records the copy into a staging buffer, returned to the ring with the handle
+static VulkanReadbackSlot recordReadback(VulkanReadbackRing &ring,
+                                         vk::CommandBuffer commandBuffer,
+                                         VulkanImageData const &image, size_t size,
+                                         vk::Extent2D tile) {
+  auto slot = ring.acquire(size);
+  image.recordDownload(commandBuffer, slot->mBuffer->getBuffer(), 0, size, tile);
+  vk::BufferMemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite,
+                                  vk::AccessFlagBits::eHostRead, VK_QUEUE_FAMILY_IGNORED,
+                                  VK_QUEUE_FAMILY_IGNORED, slot->mBuffer->getBuffer(), 0, size);
+  commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                vk::PipelineStageFlagBits::eHost, {}, nullptr, barrier, nullptr);
+  return slot;
+}
+
+VulkanImageData &VulkanRenderer::getDownloadTarget(DownloadTarget const &target) {
+  if (target.customIndex >= 0) {
+    if (static_cast<uint32_t>(target.customIndex) >= mConfig.customTextureCount) {
+      throw std::runtime_error("Custom target index out of range");
+    }
+    return *mRenderTargets.custom[target.customIndex];
+  }
+  if (target.target == RenderTarget::ePosition && mConfig.positionFromDepth) {
+    throw std::runtime_error("Positions reconstructed from depth are downloaded with "
+                             "downloadPosition");
+  }
+  return getDownloadTarget(target.target);
+}
+
+VulkanDownloadedTargets
+VulkanRenderer::downloadTargets(std::vector<DownloadTarget> const &targets) {
+  SVULKAN_PROFILE_SCOPE("VulkanRenderer::downloadTargets");
+  std::vector<VulkanImageData *> images;
+  std::vector<VulkanDownloadedTargets::Target> layout;
+  vk::DeviceSize totalSize = 0;
+  for (auto &target : targets) {
+    VulkanImageData *image = &getDownloadTarget(target);
+
+    // a target requested twice is copied once
+    auto it = std::find(images.begin(), images.end(), image);
+    if (it != images.end()) {
+      layout.push_back(layout[it - images.begin()]);
+      images.push_back(image);
+      continue;
+    }
+
+    uint32_t pixelSize = getFormatSize(image->mFormat);
+    if (pixelSize == 0) {
+      throw std::runtime_error("This image format does not support download");
+    }
+    size_t size =
+        size_t(mTileWidth) * mTileHeight * mConfig.batchSize * image->mArrayLayers * pixelSize;
+    // buffer offsets of copies must be multiples of the texel size
+    totalSize = (totalSize + 15) / 16 * 16;
+    layout.push_back({image->mFormat, totalSize, size});
+    images.push_back(image);
+    totalSize += size;
+  }
+
+  auto slot = mReadbackRing->acquire(totalSize);
+  OneTimeSubmit(
+      mContext->getDevice(), mContext->getCommandPool(), mContext->getGraphicsQueue(),
+      [&](vk::CommandBuffer commandBuffer) {
+        mPasses.begin(commandBuffer, "download");
+        std::vector<VulkanImageData *> unique;
+        std::vector<vk::ImageMemoryBarrier> toTransfer;
+        std::vector<vk::ImageMemoryBarrier> toAttachment;
+        vk::PipelineStageFlags stages;
+        for (uint32_t i = 0; i < images.size(); ++i) {
+          if (std::find(unique.begin(), unique.end(), images[i]) != unique.end()) {
+            continue;
+          }
+          unique.push_back(images[i]);
+          toTransfer.push_back(images[i]->getDownloadBarrier(true));
+          toAttachment.push_back(images[i]->getDownloadBarrier(false));
+          stages |= images[i]->getAttachmentStages();
+        }
+
+        commandBuffer.pipelineBarrier(stages, vk::PipelineStageFlagBits::eTransfer, {},
+                                      nullptr, nullptr, toTransfer);
+        for (uint32_t i = 0; i < unique.size(); ++i) {
+          size_t index = std::find(images.begin(), images.end(), unique[i]) - images.begin();
+          commandBuffer.copyImageToBuffer(
+              unique[i]->mImage.get(), vk::ImageLayout::eTransferSrcOptimal,
+              slot->mBuffer->getBuffer(),
+              unique[i]->getDownloadRegions(layout[index].mOffset, layout[index].mSize,
+                                            getTileExtent()));
+        }
+        vk::BufferMemoryBarrier hostBarrier(
+            vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, slot->mBuffer->getBuffer(), 0,
+            totalSize);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                      vk::PipelineStageFlagBits::eHost, {}, nullptr,
+                                      hostBarrier, nullptr);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, stages, {},
+                                      nullptr, nullptr, toAttachment);
+        mPasses.end(commandBuffer);
+      });
+  slot.invalidate();
+  return VulkanDownloadedTargets(std::move(slot), std::move(layout));
+}
+
+// barriers moving every distinct image between its attachment layout and layout, returns the
+// attachment stages to synchronize with
+static vk::PipelineStageFlags
+getAttachmentBarriers(std::vector<VulkanImageData *> const &images, vk::ImageLayout layout,
+                      vk::AccessFlags access, std::vector<vk::ImageMemoryBarrier> &toLayout,
+                      std::vector<vk::ImageMemoryBarrier> &toAttachment) {
+  std::vector<VulkanImageData *> unique;
+  vk::PipelineStageFlags stages;
+  for (auto image : images) {
+    if (std::find(unique.begin(), unique.end(), image) != unique.end()) {
+      continue;
+    }
+    unique.push_back(image);
+    toLayout.push_back(image->getAttachmentBarrier(layout, access, true));
+    toAttachment.push_back(image->getAttachmentBarrier(layout, access, false));
+    stages |= image->getAttachmentStages();
+  }
+  return stages;
+}
+
+std::vector<glm::mat4> VulkanRenderer::getProjectionsInverse() const {
+  // tiles that were not part of the last batch keep the identity
+  std::vector<glm::mat4> projections(mConfig.batchSize * mConfig.viewCount, glm::mat4(1.f));
+  for (size_t i = 0; i < mRenderedCameras.size() && i < projections.size(); ++i) {
+    projections[i] = mRenderedCameras[i].projectionMatrixInverse;
+  }
+  return projections;
+}
+
+VulkanBufferData &VulkanRenderer::getScratchBuffer(vk::DeviceSize size) {
+  if (mScratchBufferSize < size) {
+    mScratchBuffer = std::make_unique<VulkanBufferData>(
+        mContext->getPhysicalDevice(), mContext->getDevice(), size,
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc |
+            vk::BufferUsageFlagBits::eTransferDst,
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+    mScratchBufferSize = size;
+  }
+  return *mScratchBuffer;
+}
+
+VulkanDownloadedTargets
+VulkanRenderer::downloadConverted(std::vector<DownloadConversion> const &conversions) {
+  SVULKAN_PROFILE_SCOPE("VulkanRenderer::downloadConverted");
+  // storage buffer bindings must start at aligned offsets
+  vk::DeviceSize alignment = std::max<vk::DeviceSize>(
+      16, mContext->getPhysicalDevice().getProperties().limits.minStorageBufferOffsetAlignment);
+  std::vector<VulkanImageData *> images;
+  std::vector<VulkanDownloadedTargets::Target> layout;
+  vk::DeviceSize totalSize = 0;
+  for (auto &conversion : conversions) {
+    VulkanImageData *image = &getDownloadTarget(conversion.target);
+    if (conversion.channels.empty() || conversion.channels.size() > 4) {
+      throw std::runtime_error("Conversions select 1 to 4 channels");
+    }
+    for (uint32_t channel : conversion.channels) {
+      if (channel > 3) {
+        throw std::runtime_error("Conversion channel out of range");
+      }
+    }
+    if (conversion.linearDepth && !isDepthFormat(image->mFormat)) {
+      throw std::runtime_error("Linear depth can only be converted from the depth target");
+    }
+    size_t size = size_t(mTileWidth) * mTileHeight * mConfig.batchSize * image->mArrayLayers *
+                  conversion.channels.size() * ConvertPass::getElementSize(conversion.type);
+    totalSize = (totalSize + alignment - 1) / alignment * alignment;
+    layout.push_back({ConvertPass::getOutputFormat(conversion, *image), totalSize, size});
+    images.push_back(image);
+    // the shader writes whole words
+    totalSize += (size + 3) / 4 * 4;
+  }
+
+  auto &convertedBuffer = getScratchBuffer(totalSize);
+
+  // the inverse projections of every tile and view follow the converted data
+  vk::DeviceSize projectionsOffset = (totalSize + alignment - 1) / alignment * alignment;
+  std::vector<glm::mat4> projections = getProjectionsInverse();
+  vk::DeviceSize projectionsSize = projections.size() * sizeof(glm::mat4);
+  auto slot = mReadbackRing->acquire(projectionsOffset + projectionsSize);
+  memcpy(slot->mMapped + projectionsOffset, projections.data(), projectionsSize);
+  slot.flush();
+  vk::DescriptorBufferInfo projectionsInfo(slot->mBuffer->getBuffer(), projectionsOffset,
+                                           projectionsSize);
+  OneTimeSubmit(
+      mContext->getDevice(), mContext->getCommandPool(), mContext->getGraphicsQueue(),
+      [&](vk::CommandBuffer commandBuffer) {
+        mPasses.begin(commandBuffer, "convert");
+        std::vector<vk::ImageMemoryBarrier> toShader;
+        std::vector<vk::ImageMemoryBarrier> toAttachment;
+        auto stages = getAttachmentBarriers(images, vk::ImageLayout::eShaderReadOnlyOptimal,
+                                            vk::AccessFlagBits::eShaderRead, toShader,
+                                            toAttachment);
+
+        commandBuffer.pipelineBarrier(stages, vk::PipelineStageFlagBits::eComputeShader, {},
+                                      nullptr, nullptr, toShader);
+        for (uint32_t i = 0; i < images.size(); ++i) {
+          uint32_t elementCount = static_cast<uint32_t>(
+              layout[i].mSize / ConvertPass::getElementSize(conversions[i].type));
+          mConvertPass->record(commandBuffer, i, *images[i], mDeferredSampler.get(),
+                               conversions[i], getTileExtent(), mTileColumns,
+                               projectionsInfo, convertedBuffer.getBuffer(),
+                               layout[i].mOffset, elementCount);
+        }
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, stages, {},
+                                      nullptr, nullptr, toAttachment);
+
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer, {},
+            vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite,
+                              vk::AccessFlagBits::eTransferRead),
+            nullptr, nullptr);
+        commandBuffer.copyBuffer(convertedBuffer.getBuffer(), slot->mBuffer->getBuffer(),
+                                 vk::BufferCopy(0, 0, totalSize));
+        vk::BufferMemoryBarrier hostBarrier(
+            vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, slot->mBuffer->getBuffer(), 0,
+            totalSize);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                      vk::PipelineStageFlagBits::eHost, {}, nullptr,
+                                      hostBarrier, nullptr);
+        mPasses.end(commandBuffer);
+      });
+  slot.invalidate();
+  return VulkanDownloadedTargets(std::move(slot), std::move(layout));
+}
+
+PixelQueryResult VulkanRenderer::queryPixels(std::vector<DownloadTarget> const &targets,
+                                             std::vector<PixelQuery> const &points) {
+  SVULKAN_PROFILE_SCOPE("VulkanRenderer::queryPixels");
+  std::future<PixelQueryResult> result;
+  OneTimeSubmit(mContext->getDevice(), mContext->getCommandPool(), mContext->getGraphicsQueue(),
+                [&](vk::CommandBuffer commandBuffer) {
+                  result = queryPixelsAsync(commandBuffer, {}, targets, points);
+                });
+  return result.get();
+}
+
+std::future<PixelQueryResult>
+VulkanRenderer::queryPixelsAsync(vk::CommandBuffer commandBuffer, vk::Fence fence,
+                                 std::vector<DownloadTarget> const &targets,
+                                 std::vector<PixelQuery> const &points) {
+  std::vector<VulkanImageData *> images;
+  std::vector<vk::Format> formats;
+  for (auto &target : targets) {
+    images.push_back(&getDownloadTarget(target));
+    formats.push_back(images.back()->mFormat);
+  }
+  uint32_t pointCount = static_cast<uint32_t>(points.size());
+  if (images.empty() || pointCount == 0) {
+    std::promise<PixelQueryResult> empty;
+    empty.set_value({pointCount, {}});
+    return empty.get_future();
+  }
+
+  // points and values share one staging buffer
+  vk::DeviceSize alignment = std::max<vk::DeviceSize>(
+      16, mContext->getPhysicalDevice().getProperties().limits.minStorageBufferOffsetAlignment);
+  vk::DeviceSize pointsSize = pointCount * sizeof(glm::ivec4);
+  vk::DeviceSize valuesOffset = (pointsSize + alignment - 1) / alignment * alignment;
+  vk::DeviceSize valuesSize = pointCount * images.size() * sizeof(glm::uvec4);
+  auto slot = mReadbackRing->acquire(valuesOffset + valuesSize);
+
+  auto texels = reinterpret_cast<glm::ivec4 *>(slot->mMapped);
+  for (uint32_t i = 0; i < pointCount; ++i) {
+    auto &point = points[i];
+    if (point.x < 0 || point.y < 0 || point.x >= mTileWidth || point.y >= mTileHeight ||
+        point.tile >= mConfig.batchSize || point.view >= mConfig.viewCount) {
+      texels[i] = {-1, -1, 0, 0};
+      continue;
+    }
+    auto tile = getTile(point.tile);
+    texels[i] = {tile.offset.x + point.x, tile.offset.y + point.y,
+                 static_cast<int32_t>(point.view), 0};
+  }
+  slot.flush();
+
+  std::vector<vk::ImageMemoryBarrier> toShader;
+  std::vector<vk::ImageMemoryBarrier> toAttachment;
+  auto stages = getAttachmentBarriers(images, vk::ImageLayout::eShaderReadOnlyOptimal,
+                                      vk::AccessFlagBits::eShaderRead, toShader, toAttachment);
+  mPasses.begin(commandBuffer, "pick");
+  commandBuffer.pipelineBarrier(stages, vk::PipelineStageFlagBits::eComputeShader, {}, nullptr,
+                                nullptr, toShader);
+  vk::DescriptorBufferInfo pointsInfo(slot->mBuffer->getBuffer(), 0, pointsSize);
+  vk::DescriptorBufferInfo valuesInfo(slot->mBuffer->getBuffer(), valuesOffset, valuesSize);
+  std::vector<vk::UniqueDescriptorSet> descriptorSets;
+  for (uint32_t i = 0; i < images.size(); ++i) {
+    descriptorSets.push_back(mPickPass->record(commandBuffer, *images[i],
+                                               mDeferredSampler.get(), pointsInfo, valuesInfo,
+                                               pointCount, i * pointCount));
+  }
+  commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, stages, {}, nullptr,
+                                nullptr, toAttachment);
+  commandBuffer.pipelineBarrier(
+      vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eHost, {},
+      vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eHostRead),
+      nullptr, nullptr);
+  mPasses.end(commandBuffer);
+
+  // descriptor sets stay alive until the gather has completed
+  return std::async(std::launch::deferred,
+                    [readback = AsyncReadback(mContext->getDevice(), fence, std::move(slot),
+                                              std::move(descriptorSets)),
+                     valuesOffset, pointCount, formats]() mutable {
+                      SVULKAN_PROFILE_SCOPE("queryPixels gather");
+                      readback.wait();
+                      readback.slot.invalidate();
+                      PixelQueryResult result{pointCount, {}};
+                      result.values.resize(size_t(pointCount) * formats.size());
+                      memcpy(result.values.data(), readback.slot->mMapped + valuesOffset,
+                             result.values.size() * sizeof(glm::uvec4));
+
+                      for (uint32_t t = 0; t < formats.size(); ++t) {
+                        if (formats[t] != vk::Format::eR16G16Snorm &&
+                            formats[t] != vk::Format::eR16G16Sfloat) {
+                          continue;
+                        }
+                        for (uint32_t i = 0; i < pointCount; ++i) {
+                          auto &value = result.values[t * pointCount + i];
+                          glm::vec4 encoded = glm::uintBitsToFloat(value);
+                          value = glm::floatBitsToUint(
+                              glm::vec4(decodeOctahedral({encoded.x, encoded.y}), 0.f));
+                        }
+                      }
+                      return result;
+                    });
+}
+
+SegmentationStatsResult
+VulkanRenderer::computeSegmentationStats(std::vector<uint32_t> const &channels,
+                                         uint32_t idCount) {
+  SVULKAN_PROFILE_SCOPE("VulkanRenderer::computeSegmentationStats");
+  auto &image = getDownloadTarget(RenderTarget::eSegmentation);
+  uint32_t channelCount = image.mFormat == vk::Format::eR32G32Uint ? 2 : 4;
+  for (uint32_t channel : channels) {
+    if (channel >= channelCount) {
+      throw std::runtime_error("Segmentation channel out of range");
+    }
+  }
+
+  SegmentationStatsResult result;
+  result.idCount = idCount;
+  result.imageCount = mConfig.batchSize * image.mArrayLayers;
+  size_t tableEntries = size_t(result.imageCount) * idCount;
+  vk::DeviceSize size = channels.size() * tableEntries * 5 * sizeof(uint32_t);
+  if (size == 0) {
+    return result;
+  }
+
+  if (!mSegmentationStatsPass) {
+    mSegmentationStatsPass = std::make_unique<ComputePass>(*mContext);
+    mSegmentationStatsPass->initializePipeline(
+        mConfig.shaderDir == "" ? VulkanContext::gDefaultShaderDir : mConfig.shaderDir,
+        {mDescriptorSetLayouts.segmentationStats.get()}, "segmentation_stats",
+        sizeof(glm::uvec2) + 6 * sizeof(uint32_t));
+  }
+
+  auto &statsBuffer = getScratchBuffer(size);
+  vk::DescriptorImageInfo imageInfo(mDeferredSampler.get(), image.getArrayImageView(),
+                                    vk::ImageLayout::eShaderReadOnlyOptimal);
+  vk::DescriptorBufferInfo bufferInfo(statsBuffer.getBuffer(), 0, size);
+  std::vector<vk::WriteDescriptorSet> writeDescriptorSets = {
+      vk::WriteDescriptorSet(mSegmentationStatsDescriptorSet.get(), 0, 0, 1,
+                             vk::DescriptorType::eCombinedImageSampler, &imageInfo),
+      vk::WriteDescriptorSet(mSegmentationStatsDescriptorSet.get(), 1, 0, 1,
+                             vk::DescriptorType::eStorageBuffer, nullptr, &bufferInfo)};
+  mContext->getDevice().updateDescriptorSets(writeDescriptorSets, nullptr);
+
+  auto slot = mReadbackRing->acquire(size);
+  OneTimeSubmit(
+      mContext->getDevice(), mContext->getCommandPool(), mContext->getGraphicsQueue(),
+      [&](vk::CommandBuffer commandBuffer) {
+        mPasses.begin(commandBuffer, "segmentation stats");
+        commandBuffer.fillBuffer(statsBuffer.getBuffer(), 0, size, 0);
+        commandBuffer.pipelineBarrier(
+            image.getAttachmentStages() | vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eComputeShader, {},
+            vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite,
+                              vk::AccessFlagBits::eShaderRead |
+                                  vk::AccessFlagBits::eShaderWrite),
+            nullptr,
+            image.getAttachmentBarrier(vk::ImageLayout::eShaderReadOnlyOptimal,
+                                       vk::AccessFlagBits::eShaderRead, true));
+
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute,
+                                   mSegmentationStatsPass->getPipeline());
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                         mSegmentationStatsPass->getPipelineLayout(), 0,
+                                         mSegmentationStatsDescriptorSet.get(), nullptr);
+        for (uint32_t i = 0; i < channels.size(); ++i) {
+          struct {
+            glm::uvec2 tileSize;
+            uint32_t tileColumns;
+            uint32_t tileCount;
+            uint32_t layers;
+            uint32_t idCount;
+            uint32_t channel;
+            uint32_t tableOffset;
+          } pushConstants{{static_cast<uint32_t>(mTileWidth),
+                           static_cast<uint32_t>(mTileHeight)},
+                          mTileColumns,
+                          mConfig.batchSize,
+                          image.mArrayLayers,
+                          idCount,
+                          channels[i],
+                          static_cast<uint32_t>(i * tableEntries * 5)};
+          commandBuffer.pushConstants(mSegmentationStatsPass->getPipelineLayout(),
+                                      vk::ShaderStageFlagBits::eCompute, 0,
+                                      sizeof(pushConstants), &pushConstants);
+          commandBuffer.dispatch((mWidth + 15) / 16, (mHeight + 15) / 16, image.mArrayLayers);
+        }
+
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader,
+            image.getAttachmentStages() | vk::PipelineStageFlagBits::eTransfer, {},
+            vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite,
+                              vk::AccessFlagBits::eTransferRead),
+            nullptr,
+            image.getAttachmentBarrier(vk::ImageLayout::eShaderReadOnlyOptimal,
+                                       vk::AccessFlagBits::eShaderRead, false));
+        commandBuffer.copyBuffer(statsBuffer.getBuffer(), slot->mBuffer->getBuffer(),
+                                 vk::BufferCopy(0, 0, size));
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {},
+            vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite,
+                              vk::AccessFlagBits::eHostRead),
+            nullptr, nullptr);
+        mPasses.end(commandBuffer);
+      });
+  slot.invalidate();
+
+  auto table = reinterpret_cast<uint32_t const *>(slot->mMapped);
+  result.stats.resize(channels.size() * tableEntries);
+  for (size_t i = 0; i < result.stats.size(); ++i) {
+    auto entry = table + i * 5;
+    if (entry[0] == 0) {
+      continue;
+    }
+    result.stats[i] = {entry[0], {~entry[1], ~entry[2]}, {entry[3], entry[4]}};
+  }
+  return result;
+}
+
+PointCloud VulkanRenderer::computePointCloud(PointCloudConfig const &config) {
+  SVULKAN_PROFILE_SCOPE("VulkanRenderer::computePointCloud");
+  if (mRenderedCameras.empty()) {
+    throw std::runtime_error("Point clouds are computed from a rendered frame");
+  }
+  auto &depth = getDownloadTarget(RenderTarget::eDepth);
+  auto &color = config.color ? getDownloadTarget(config.colorTarget) : depth;
+  auto &segmentation =
+      config.segmentation ? getDownloadTarget(RenderTarget::eSegmentation) : depth;
+  if (isIntegerFormat(color.mFormat)) {
+    throw std::runtime_error("Point colors are read from a color target");
+  }
+  if (config.segmentation &&
+      config.segmentationChannel >=
+          (segmentation.mFormat == vk::Format::eR32G32Uint ? 2u : 4u)) {
+    throw std::runtime_error("Segmentation channel out of range");
+  }
+
+  auto &pass = mPointCloudPasses[{config.segmentation, config.worldSpace, config.color}];
+  if (!pass) {
+    pass = std::make_unique<ComputePass>(*mContext);
+    pass->initializePipeline(
+        mConfig.shaderDir == "" ? VulkanContext::gDefaultShaderDir : mConfig.shaderDir,
+        {mDescriptorSetLayouts.pointCloud.get()},
+        config.segmentation ? "pointcloud_segmentation" : "pointcloud",
+        sizeof(glm::uvec2) + 7 * sizeof(uint32_t), {config.worldSpace, config.color});
+  }
+
+  // tiles that were not part of the last batch have no camera
+  uint32_t tileCount = static_cast<uint32_t>(mRenderedCameras.size()) / depth.mArrayLayers;
+  uint32_t stride = 3 + config.segmentation + config.color;
+  size_t pixelCount = size_t(mTileWidth) * mTileHeight * mRenderedCameras.size();
+
+  // the staging buffer holds the point count, the cameras and the points written in place
+  vk::DeviceSize alignment = std::max<vk::DeviceSize>(
+      16, mContext->getPhysicalDevice().getProperties().limits.minStorageBufferOffsetAlignment);
+  vk::DeviceSize camerasOffset = alignment;
+  vk::DeviceSize camerasSize = mRenderedCameras.size() * 2 * sizeof(glm::mat4);
+  vk::DeviceSize pointsOffset = (camerasOffset + camerasSize + alignment - 1) / alignment *
+                                alignment;
+  vk::DeviceSize pointsSize = pixelCount * stride * sizeof(uint32_t);
+  auto slot = mReadbackRing->acquire(pointsOffset + pointsSize);
+  auto cameras = reinterpret_cast<glm::mat4 *>(slot->mMapped + camerasOffset);
+  for (size_t i = 0; i < mRenderedCameras.size(); ++i) {
+    cameras[2 * i] = mRenderedCameras[i].viewMatrixInverse;
+    cameras[2 * i + 1] = mRenderedCameras[i].projectionMatrixInverse;
+  }
+  slot.flush();
+
+  // the counter and the voxel hash table live in device memory
+  uint32_t tableSize = 1;
+  if (config.voxelSize > 0) {
+    while (tableSize < 2 * pixelCount) {
+      tableSize *= 2;
+    }
+  }
+  vk::DeviceSize counterSize = (1 + tableSize) * sizeof(uint32_t);
+  auto &counterBuffer = getScratchBuffer(counterSize);
+
+  vk::DescriptorImageInfo depthInfo(mDeferredSampler.get(), depth.getArrayImageView(),
+                                    vk::ImageLayout::eShaderReadOnlyOptimal);
+  vk::DescriptorImageInfo colorInfo(mDeferredSampler.get(), color.getArrayImageView(),
+                                    vk::ImageLayout::eShaderReadOnlyOptimal);
+  vk::DescriptorImageInfo segmentationInfo(mDeferredSampler.get(),
+                                           segmentation.getArrayImageView(),
+                                           vk::ImageLayout::eShaderReadOnlyOptimal);
+  vk::DescriptorBufferInfo camerasInfo(slot->mBuffer->getBuffer(), camerasOffset, camerasSize);
+  vk::DescriptorBufferInfo counterInfo(counterBuffer.getBuffer(), 0, counterSize);
+  vk::DescriptorBufferInfo pointsInfo(slot->mBuffer->getBuffer(), pointsOffset, pointsSize);
+  std::vector<vk::WriteDescriptorSet> writeDescriptorSets = {
+      vk::WriteDescriptorSet(mPointCloudDescriptorSet.get(), 0, 0, 1,
+                             vk::DescriptorType::eCombinedImageSampler, &depthInfo),
+      vk::WriteDescriptorSet(mPointCloudDescriptorSet.get(), 1, 0, 1,
+                             vk::DescriptorType::eCombinedImageSampler, &colorInfo),
+      vk::WriteDescriptorSet(mPointCloudDescriptorSet.get(), 3, 0, 1,
+                             vk::DescriptorType::eStorageBuffer, nullptr, &camerasInfo),
+      vk::WriteDescriptorSet(mPointCloudDescriptorSet.get(), 4, 0, 1,
+                             vk::DescriptorType::eStorageBuffer, nullptr, &counterInfo),
+      vk::WriteDescriptorSet(mPointCloudDescriptorSet.get(), 5, 0, 1,
+                             vk::DescriptorType::eStorageBuffer, nullptr, &pointsInfo)};
+  // only the segmentation variant reads binding 2
+  if (config.segmentation) {
+    writeDescriptorSets.push_back(
+        vk::WriteDescriptorSet(mPointCloudDescriptorSet.get(), 2, 0, 1,
+                               vk::DescriptorType::eCombinedImageSampler, &segmentationInfo));
+  }
+  mContext->getDevice().updateDescriptorSets(writeDescriptorSets, nullptr);
+
+  OneTimeSubmit(
+      mContext->getDevice(), mContext->getCommandPool(), mContext->getGraphicsQueue(),
+      [&](vk::CommandBuffer commandBuffer) {
+        mPasses.begin(commandBuffer, "point cloud");
+        commandBuffer.fillBuffer(counterBuffer.getBuffer(), 0, counterSize, 0);
+        std::vector<vk::ImageMemoryBarrier> toShader;
+        std::vector<vk::ImageMemoryBarrier> toAttachment;
+        auto stages = getAttachmentBarriers({&depth, &color, &segmentation},
+                                            vk::ImageLayout::eShaderReadOnlyOptimal,
+                                            vk::AccessFlagBits::eShaderRead, toShader,
+                                            toAttachment);
+        commandBuffer.pipelineBarrier(
+            stages | vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eComputeShader, {},
+            vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite,
+                              vk::AccessFlagBits::eShaderRead |
+                                  vk::AccessFlagBits::eShaderWrite),
+            nullptr, toShader);
+
+        struct {
+          glm::uvec2 tileSize;
+          uint32_t tileColumns;
+          uint32_t tileCount;
+          uint32_t layers;
+          uint32_t stride;
+          uint32_t segmentationChannel;
+          uint32_t voxelTableMask;
+          float voxelSize;
+        } pushConstants{{static_cast<uint32_t>(mTileWidth), static_cast<uint32_t>(mTileHeight)},
+                        mTileColumns,
+                        tileCount,
+                        depth.mArrayLayers,
+                        stride,
+                        config.segmentationChannel,
+                        config.voxelSize > 0 ? tableSize - 1 : 0,
+                        config.voxelSize};
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pass->getPipeline());
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                         pass->getPipelineLayout(), 0,
+                                         mPointCloudDescriptorSet.get(), nullptr);
+        commandBuffer.pushConstants(pass->getPipelineLayout(),
+                                    vk::ShaderStageFlagBits::eCompute, 0,
+                                    sizeof(pushConstants), &pushConstants);
+        commandBuffer.dispatch((mWidth + 15) / 16, (mHeight + 15) / 16, depth.mArrayLayers);
+
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader,
+            stages | vk::PipelineStageFlagBits::eTransfer, {},
+            vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite,
+                              vk::AccessFlagBits::eTransferRead),
+            nullptr, toAttachment);
+        commandBuffer.copyBuffer(counterBuffer.getBuffer(), slot->mBuffer->getBuffer(),
+                                 vk::BufferCopy(0, 0, sizeof(uint32_t)));
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eHost, {},
+            vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite |
+                                  vk::AccessFlagBits::eTransferWrite,
+                              vk::AccessFlagBits::eHostRead),
+            nullptr, nullptr);
+        mPasses.end(commandBuffer);
+      });
+  slot.invalidate();
+
+  uint32_t count = *reinterpret_cast<uint32_t const *>(slot->mMapped);
+  auto points = reinterpret_cast<uint32_t const *>(slot->mMapped + pointsOffset);
+  PointCloud result;
+  result.positions.resize(count);
+  result.segmentation.resize(config.segmentation ? count : 0);
+  result.colors.resize(config.color ? count : 0);
+  for (uint32_t i = 0; i < count; ++i) {
+    auto point = points + size_t(i) * stride;
+    memcpy(&result.positions[i], point, sizeof(glm::vec3));
+    if (config.segmentation) {
+      result.segmentation[i] = point[3];
+    }
+    if (config.color) {
+      result.colors[i] = point[stride - 1];
+    }
+  }
+  return result;
+}
+
+// copies rows of rowSize bytes into destination rows that are rowStride bytes apart
+static void copyRows(char const *source, size_t size, size_t rowSize, void *destination,
+                     size_t rowStride) {
+  if (rowStride == 0 || rowStride == rowSize) {
+    memcpy(destination, source, size);
+    return;
+  }
+  if (rowStride < rowSize) {
+    throw std::runtime_error("The row stride is smaller than a row of the download");
+  }
+  char *output = static_cast<char *>(destination);
+  for (size_t row = 0; row < size / rowSize; ++row) {
+    memcpy(output + row * rowStride, source + row * rowSize, rowSize);
+  }
+}
+
+size_t VulkanRenderer::getDownloadSize(DownloadTarget const &target) {
+  auto &image = getDownloadTarget(target);
+  return size_t(mTileWidth) * mTileHeight * mConfig.batchSize * image.mArrayLayers *
+         getFormatSize(image.mFormat);
+}
+
+size_t VulkanRenderer::getDownloadSize(DownloadConversion const &conversion) {
+  auto &image = getDownloadTarget(conversion.target);
+  return size_t(mTileWidth) * mTileHeight * mConfig.batchSize * image.mArrayLayers *
+         conversion.channels.size() * ConvertPass::getElementSize(conversion.type);
+}
+
+void VulkanRenderer::downloadInto(DownloadTarget const &target, void *destination,
+                                  size_t rowStride) {
+  auto result = downloadTargets({target});
+  copyRows(result.data(0), result.size(0), mTileWidth * getFormatSize(result.format(0)),
+           destination, rowStride);
+}
+
+void VulkanRenderer::downloadConvertedInto(DownloadConversion const &conversion,
+                                           void *destination, size_t rowStride) {
+  auto result = downloadConverted({conversion});
+  copyRows(result.data(0), result.size(0),
+           mTileWidth * conversion.channels.size() * ConvertPass::getElementSize(conversion.type),
+           destination, rowStride);
+}
+
+std::future<std::vector<float>> VulkanRenderer::downloadAsync(vk::CommandBuffer commandBuffer,
+                                                              vk::Fence fence,
+                                                              RenderTarget target) {
+  if (target == RenderTarget::eSegmentation) {
+    throw std::runtime_error("Segmentation is downloaded with downloadSegmentationAsync");
+  }
+  if (target == RenderTarget::ePosition && mConfig.positionFromDepth) {
+    throw std::runtime_error("Positions reconstructed from depth cannot be downloaded "
+                             "asynchronously");
+  }
+  auto &image = getDownloadTarget(target);
+  if (getFormatSize(image.mFormat) == 0) {
+    throw std::runtime_error("This image format does not support download");
+  }
+  size_t count = size_t(mTileWidth) * mTileHeight * mConfig.batchSize * image.mArrayLayers;
+  size_t size = count * getFormatSize(image.mFormat);
+  mPasses.begin(commandBuffer, "download");
+  auto slot = recordReadback(*mReadbackRing, commandBuffer, image, size, getTileExtent());
+  mPasses.end(commandBuffer);
+
+  return std::async(std::launch::deferred,
+                    [readback = AsyncReadback(mContext->getDevice(), fence, std::move(slot)),
+                     format = image.mFormat, count]() mutable {
+                      SVULKAN_PROFILE_SCOPE("downloadAsync");
+                      readback.wait();
+                      readback.slot.invalidate();
+                      return unpackFloat4(format, readback.slot->mMapped, count);
+                    });
+}
+
+std::future<std::vector<uint32_t>>
+VulkanRenderer::downloadSegmentationAsync(vk::CommandBuffer commandBuffer, vk::Fence fence) {
+  auto &image = getDownloadTarget(RenderTarget::eSegmentation);
+  size_t size = size_t(mTileWidth) * mTileHeight * mConfig.batchSize * image.mArrayLayers *
+                getFormatSize(image.mFormat);
+  mPasses.begin(commandBuffer, "download");
+  auto slot = recordReadback(*mReadbackRing, commandBuffer, image, size, getTileExtent());
+  mPasses.end(commandBuffer);
+
+  return std::async(std::launch::deferred,
+                    [readback = AsyncReadback(mContext->getDevice(), fence, std::move(slot)),
+                     size]() mutable {
+                      SVULKAN_PROFILE_SCOPE("downloadSegmentationAsync");
+                      readback.wait();
+                      readback.slot.invalidate();
+                      std::vector<uint32_t> output(size / sizeof(uint32_t));
+                      memcpy(output.data(), readback.slot->mMapped, size);
+                      return output;
+                    });
 }
 
 void VulkanRenderer::initializeDescriptorLayouts() {
@@ -684,6 +2691,57 @@ void VulkanRenderer::initializeDescriptorLayouts() {
         {vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment});
   }
   mDescriptorSetLayouts.composite = createDescriptorSetLayout(mContext->getDevice(), layout);
+
+  layout = {
+      {vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eCompute}, // depth
+      {vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute} // position
+  };
+  mDescriptorSetLayouts.position = createDescriptorSetLayout(mContext->getDevice(), layout);
+
+  layout = {
+      {vk::DescriptorType::eInputAttachment, 1, vk::ShaderStageFlagBits::eFragment}, // albedo
+      {vk::DescriptorType::eInputAttachment, 1, vk::ShaderStageFlagBits::eFragment}, // position
+      {vk::DescriptorType::eInputAttachment, 1, vk::ShaderStageFlagBits::eFragment}, // specular
+      {vk::DescriptorType::eInputAttachment, 1, vk::ShaderStageFlagBits::eFragment}, // normal
+      {vk::DescriptorType::eInputAttachment, 1, vk::ShaderStageFlagBits::eFragment}  // depth
+  };
+  mDescriptorSetLayouts.lightingInput = createDescriptorSetLayout(mContext->getDevice(), layout);
+
+  layout = {
+      {vk::DescriptorType::eInputAttachment, 1, vk::ShaderStageFlagBits::eFragment} // lighting
+  };
+  mDescriptorSetLayouts.compositeInput = createDescriptorSetLayout(mContext->getDevice(), layout);
+
+  layout = {
+      {vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eCompute}, // albedo
+      {vk::DescriptorType::eCombinedImageSampler, 1,
+       vk::ShaderStageFlagBits::eCompute}, // position
+      {vk::DescriptorType::eCombinedImageSampler, 1,
+       vk::ShaderStageFlagBits::eCompute}, // specular
+      {vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eCompute}, // normal
+      {vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eCompute}, // depth
+      {vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute} // lighting
+  };
+  mDescriptorSetLayouts.tiledLighting = createDescriptorSetLayout(mContext->getDevice(), layout);
+
+  layout = {
+      {vk::DescriptorType::eCombinedImageSampler, 1,
+       vk::ShaderStageFlagBits::eCompute},                                       // segmentation
+      {vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute} // statistics
+  };
+  mDescriptorSetLayouts.segmentationStats =
+      createDescriptorSetLayout(mContext->getDevice(), layout);
+
+  layout = {
+      {vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eCompute}, // depth
+      {vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eCompute}, // color
+      {vk::DescriptorType::eCombinedImageSampler, 1,
+       vk::ShaderStageFlagBits::eCompute},                                        // segmentation
+      {vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute}, // cameras
+      {vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute}, // counter
+      {vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute}  // points
+  };
+  mDescriptorSetLayouts.pointCloud = createDescriptorSetLayout(mContext->getDevice(), layout);
 }
 
 } // namespace svulkan
@@ -13,13 +13,12 @@ namespace svulkan {
 
 VulkanRendererForEditor::VulkanRendererForEditor(VulkanContext &context,
                                                  VulkanRendererConfig const &config)
-    : mContext(&context), mConfig(config) {
+    : mContext(&context), mConfig(config), mPasses(context, mConfig) {
   mGBufferPass = std::make_unique<GBufferPass>(context);
   mDeferredPass = std::make_unique<DeferredPass>(context);
   mAxisPass = std::make_unique<AxisPass>(context);
   mTransparencyPass = std::make_unique<TransparencyPass>(context);
   mCompositePass = std::make_unique<CompositePass>(context);
-
   initializeDescriptorLayouts();
 
   mDeferredDescriptorSet =
@@ -126,6 +125,21 @@ void VulkanRendererForEditor::initializeRenderTextures() {
         vk::ImageAspectFlagBits::eColor);
   }
 
+  auto name = [this](std::unique_ptr<VulkanImageData> const &target, std::string const &name) {
+    mContext->setDebugName(target->mImage.get(), "editor target " + name);
+  };
+  name(mRenderTargets.albedo, "albedo");
+  name(mRenderTargets.position, "position");
+  name(mRenderTargets.specular, "specular");
+  name(mRenderTargets.normal, "normal");
+  name(mRenderTargets.segmentation, "segmentation");
+  name(mRenderTargets.depth, "depth");
+  name(mRenderTargets.lighting, "lighting");
+  name(mRenderTargets.lighting2, "lighting2");
+  for (uint32_t i = 0; i < mConfig.customTextureCount; ++i) {
+    name(mRenderTargets.custom[i], "custom " + std::to_string(i));
+  }
+
   auto commandBuffer = createCommandBuffer(mContext->getDevice(), mContext->getCommandPool(),
                                            vk::CommandBufferLevel::ePrimary);
 
@@ -353,15 +367,21 @@ void VulkanRendererForEditor::initializeRenderPasses() {
   }
 }
 
-void VulkanRendererForEditor::render(vk::CommandBuffer commandBuffer, Scene &scene,
-                                     Camera &camera) {
+void VulkanRendererForEditor::render(vk::CommandBuffer target, Scene &scene, Camera &camera) {
+  SVULKAN_PROFILE_SCOPE("VulkanRendererForEditor::render");
+  StatsCommandBuffer commandBuffer(target, mPasses.getCollector());
+  mPasses.beginFrame(commandBuffer);
+
   // sync object data to GPU
   scene.prepareObjectsForRender();
-  for (auto obj : scene.getOpaqueObjects()) {
-    obj->updateVulkanObject();
-  }
-  for (auto obj : scene.getTransparentObjects()) {
-    obj->updateVulkanObject();
+  {
+    SVULKAN_PROFILE_SCOPE("updateVulkanObject");
+    for (auto obj : scene.getOpaqueObjects()) {
+      obj->updateVulkanObject();
+    }
+    for (auto obj : scene.getTransparentObjects()) {
+      obj->updateVulkanObject();
+    }
   }
 
   // sync camera and scene info to GPU
@@ -374,6 +394,7 @@ void VulkanRendererForEditor::render(vk::CommandBuffer commandBuffer, Scene &sce
 
   // render gbuffer pass
   {
+    mPasses.begin(commandBuffer, "gbuffer");
     std::vector<vk::ClearValue> clearValues;
     clearValues.push_back(vk::ClearColorValue(std::array<float, 4>{0.f, 0.f, 0.f, 1.f})); // albedo
     clearValues.push_back(
@@ -423,10 +444,12 @@ void VulkanRendererForEditor::render(vk::CommandBuffer commandBuffer, Scene &sce
       }
     }
     commandBuffer.endRenderPass();
+    mPasses.end(commandBuffer);
   }
 
   // render deferred pass
   {
+    mPasses.begin(commandBuffer, "deferred");
     // transition to texture formats
     // for (auto img : {mRenderTargets.albedo->mImage.get(), mRenderTargets.position->mImage.get(),
     //                  mRenderTargets.specular->mImage.get(),
@@ -495,10 +518,12 @@ void VulkanRendererForEditor::render(vk::CommandBuffer commandBuffer, Scene &sce
     //     vk::PipelineStageFlagBits::eEarlyFragmentTests |
     //         vk::PipelineStageFlagBits::eLateFragmentTests,
     //     vk::ImageAspectFlagBits::eDepth);
+    mPasses.end(commandBuffer);
   }
 
   // axis pass
   if (mAxesTransforms.size() || mStickTransforms.size()) {
+    mPasses.begin(commandBuffer, "axis");
     std::vector<vk::ClearValue> clearValues;
     clearValues.push_back(vk::ClearColorValue(std::array<float, 4>{0.f, 0.f, 0.f, 1.f})); // albedo
     clearValues.push_back(vk::ClearDepthStencilValue(1.0f, 0));                           // depth
@@ -541,9 +566,11 @@ void VulkanRendererForEditor::render(vk::CommandBuffer commandBuffer, Scene &sce
         0);
 
     commandBuffer.endRenderPass();
+    mPasses.end(commandBuffer);
   }
 
   // transparency pass
+  mPasses.begin(commandBuffer, "transparency");
   std::vector<vk::ClearValue> clearValues;
   clearValues.resize(7 + mConfig.customTextureCount);
   vk::RenderPassBeginInfo renderPassBeginInfo{
@@ -583,9 +610,11 @@ void VulkanRendererForEditor::render(vk::CommandBuffer commandBuffer, Scene &sce
     }
   }
   commandBuffer.endRenderPass();
+  mPasses.end(commandBuffer);
 
   // composite pass
   {
+    mPasses.begin(commandBuffer, "composite");
     // transition to texture formats
     for (auto img :
          {mRenderTargets.lighting->mImage.get(), mRenderTargets.albedo->mImage.get(),
@@ -657,7 +686,13 @@ void VulkanRendererForEditor::render(vk::CommandBuffer commandBuffer, Scene &sce
         vk::PipelineStageFlagBits::eEarlyFragmentTests |
             vk::PipelineStageFlagBits::eLateFragmentTests,
         vk::ImageAspectFlagBits::eDepth);
+    mPasses.end(commandBuffer);
   }
+  mPasses.endFrame();
+}
+
+std::vector<PassTiming> VulkanRendererForEditor::getPassTimings() const {
+  return mPasses.getTimings();
 }
 
 void VulkanRendererForEditor::display(vk::CommandBuffer commandBuffer, vk::Image swapchainImage,
@@ -7,7 +7,9 @@
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
+#include <algorithm>
 #include <experimental/filesystem>
+#include <set>
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_STATIC
@@ -278,6 +280,13 @@ VulkanResourcesManager::loadFile(std::string const &file) {
       log::info("Height texture loaded: {}", fullPath);
     }
     mat->setProperties(matSpec);
+    if (mContext->isDebugUtilsEnabled()) {
+      aiString matName;
+      m->Get(AI_MATKEY_NAME, matName);
+      std::string name = fullPath + " material " + std::to_string(i) + " " + matName.C_Str();
+      mContext->setDebugName(mat->getDescriptorSet(), name);
+      mContext->setDebugName(mat->getUniformBuffer(), name);
+    }
     mats.push_back(mat);
   }
 
@@ -332,6 +341,11 @@ VulkanResourcesManager::loadFile(std::string const &file) {
     std::shared_ptr<VulkanMesh> vulkanMesh = std::make_shared<VulkanMesh>(
         mContext->getPhysicalDevice(), mContext->getDevice(), mContext->getCommandPool(),
         mContext->getGraphicsQueue(), vertices, indices, !mesh->HasNormals());
+    if (mContext->isDebugUtilsEnabled()) {
+      std::string name = fullPath + " mesh " + std::to_string(i);
+      mContext->setDebugName(vulkanMesh->mVertexBuffer->getBuffer(), name + " vertices");
+      mContext->setDebugName(vulkanMesh->mIndexBuffer->getBuffer(), name + " indices");
+    }
     results.push_back({vulkanMesh, mats[mesh->mMaterialIndex]});
   }
   mFileMeshRegistry[fullPath] = results;
@@ -361,7 +375,17 @@ std::shared_ptr<VulkanTextureData> VulkanResourcesManager::loadTexture(std::stri
                     [&](void *target, vk::Extent2D const &extent) {
                       memcpy(target, data, extent.width * extent.height * 4);
                     });
+  texture->mHasTransparentTexels = false;
+  if (nrChannels == 4) {
+    for (int i = 0; i < width * height; ++i) {
+      if (data[4 * i + 3] == 0) {
+        texture->mHasTransparentTexels = true;
+        break;
+      }
+    }
+  }
   stbi_image_free(data);
+  mContext->setDebugName(texture->mImageData->mImage.get(), fullPath);
   mFileTextureRegistry[fullPath] = texture;
   return texture;
 }
@@ -377,4 +401,46 @@ std::shared_ptr<VulkanTextureData> VulkanResourcesManager::getPlaceholderTexture
   return mPlaceholderTexture;
 }
 
+std::vector<FileMemoryUsage> VulkanResourcesManager::getFileMemoryUsage() const {
+  std::vector<FileMemoryUsage> result;
+  std::set<VulkanTextureData const *> modelTextures;
+  for (auto &[file, meshes] : mFileMeshRegistry) {
+    FileMemoryUsage usage;
+    usage.file = file;
+    std::set<VulkanTextureData const *> textures;
+    for (auto &[mesh, material] : meshes) {
+      usage.meshCount++;
+      usage.meshBytes += mesh->mVertexBuffer->getAllocationSize() +
+                         mesh->mIndexBuffer->getAllocationSize();
+      if (!material) {
+        continue;
+      }
+      for (auto &texture : {material->getDiffuseTexture(), material->getSpecularTexture(),
+                            material->getNormalTexture(), material->getHeightTexture()}) {
+        if (texture && texture != mPlaceholderTexture && textures.insert(texture.get()).second) {
+          usage.textureBytes += texture->mImageData->getAllocationSize();
+        }
+      }
+    }
+    usage.textureCount = static_cast<uint32_t>(textures.size());
+    modelTextures.insert(textures.begin(), textures.end());
+    result.push_back(usage);
+  }
+
+  for (auto &[file, texture] : mFileTextureRegistry) {
+    if (!modelTextures.count(texture.get())) {
+      FileMemoryUsage usage;
+      usage.file = file;
+      usage.textureCount = 1;
+      usage.textureBytes = texture->mImageData->getAllocationSize();
+      result.push_back(usage);
+    }
+  }
+
+  std::sort(result.begin(), result.end(), [](auto const &a, auto const &b) {
+    return a.meshBytes + a.textureBytes > b.meshBytes + b.textureBytes;
+  });
+  return result;
+}
+
 } // namespace svulkan
@@ -4,16 +4,98 @@ namespace svulkan
 {
 VulkanScene::VulkanScene(vk::PhysicalDevice physicalDevice, vk::Device device,
                          vk::DescriptorPool descriptorPool,
-                         vk::DescriptorSetLayout descriptorLayout): mDevice(device) {
+                         vk::DescriptorSetLayout descriptorLayout,
+                         vk::CommandPool commandPool, vk::Queue queue)
+    : mPhysicalDevice(physicalDevice), mDevice(device), mCommandPool(commandPool),
+      mQueue(queue) {
   mUBO = std::make_unique<VulkanBufferData>(physicalDevice, device, sizeof(SceneUBO),
                                             vk::BufferUsageFlagBits::eUniformBuffer);
   mDescriptorSet = std::move(
       device.allocateDescriptorSetsUnique({descriptorPool, 1, &descriptorLayout}).front());
+  mDescriptorSetRecord = DescriptorSetRecord(device);
   updateDescriptorSets(device, mDescriptorSet.get(),
                        {{vk::DescriptorType::eUniformBuffer, mUBO->mBuffer.get(), vk::BufferView()}}, {}, 0);
+  updateLights({}, {});
+
+  mShadowUBO = std::make_unique<VulkanBufferData>(physicalDevice, device, sizeof(ShadowUBO),
+                                                  vk::BufferUsageFlagBits::eUniformBuffer);
+  updateDescriptorSets(
+      device, mDescriptorSet.get(),
+      {{vk::DescriptorType::eUniformBuffer, mShadowUBO->mBuffer.get(), vk::BufferView()}}, {}, 3);
+  updateShadowUBO({});
+  getShadowMaps(1, 1);
 }
 
 void VulkanScene::updateUBO(SceneUBO const &ubo) {
   copyToDevice<SceneUBO>(mDevice, mUBO->getMemory(), ubo);
 }
+
+void VulkanScene::updateLights(std::vector<DirectionalLight> const &directionalLights,
+                               std::vector<PointLight> const &pointLights) {
+  // storage buffers cannot be empty, keep at least one element
+  uint32_t directionalCapacity = std::max<uint32_t>(mDirectionalLightCapacity, 1);
+  while (directionalCapacity < directionalLights.size()) {
+    directionalCapacity *= 2;
+  }
+  uint32_t pointCapacity = std::max<uint32_t>(mPointLightCapacity, 1);
+  while (pointCapacity < pointLights.size()) {
+    pointCapacity *= 2;
+  }
+
+  if (directionalCapacity != mDirectionalLightCapacity || pointCapacity != mPointLightCapacity) {
+    // the old buffers may still be read by submitted frames
+    if (mDirectionalLightBuffer) {
+      mDevice.waitIdle();
+    }
+    if (directionalCapacity != mDirectionalLightCapacity) {
+      mDirectionalLightBuffer = std::make_unique<VulkanBufferData>(
+          mPhysicalDevice, mDevice, directionalCapacity * sizeof(DirectionalLight),
+          vk::BufferUsageFlagBits::eStorageBuffer);
+      mDirectionalLightCapacity = directionalCapacity;
+    }
+    if (pointCapacity != mPointLightCapacity) {
+      mPointLightBuffer = std::make_unique<VulkanBufferData>(
+          mPhysicalDevice, mDevice, pointCapacity * sizeof(PointLight),
+          vk::BufferUsageFlagBits::eStorageBuffer);
+      mPointLightCapacity = pointCapacity;
+    }
+    updateDescriptorSets(
+        mDevice, mDescriptorSet.get(),
+        {{vk::DescriptorType::eStorageBuffer, mDirectionalLightBuffer->mBuffer.get(),
+          vk::BufferView()},
+         {vk::DescriptorType::eStorageBuffer, mPointLightBuffer->mBuffer.get(), vk::BufferView()}},
+        {}, 1);
+  }
+
+  if (directionalLights.size()) {
+    copyToDevice<DirectionalLight>(mDevice, mDirectionalLightBuffer->getMemory(),
+                                   directionalLights.data(), directionalLights.size());
+  }
+  if (pointLights.size()) {
+    copyToDevice<PointLight>(mDevice, mPointLightBuffer->getMemory(), pointLights.data(),
+                             pointLights.size());
+  }
+}
+
+void VulkanScene::updateShadowUBO(ShadowUBO const &ubo) {
+  copyToDevice<ShadowUBO>(mDevice, mShadowUBO->getMemory(), ubo);
+}
+
+VulkanShadowMaps &VulkanScene::getShadowMaps(uint32_t size, uint32_t layers) {
+  if (mShadowMaps && mShadowMaps->mSize == size && mShadowMaps->mLayers == layers) {
+    return *mShadowMaps;
+  }
+  if (mShadowMaps) {
+    mDevice.waitIdle();
+  }
+  mShadowMaps = std::make_unique<VulkanShadowMaps>(mPhysicalDevice, mDevice, mCommandPool, mQueue,
+                                                   size, layers);
+  vk::DescriptorImageInfo imageInfo(mShadowMaps->mSampler.get(), mShadowMaps->mArrayView.get(),
+                                    vk::ImageLayout::eShaderReadOnlyOptimal);
+  mDevice.updateDescriptorSets(
+      {vk::WriteDescriptorSet(mDescriptorSet.get(), 4, 0, 1,
+                              vk::DescriptorType::eCombinedImageSampler, &imageInfo)},
+      nullptr);
+  return *mShadowMaps;
+}
 }
@@ -0,0 +1,76 @@
+#include "sapien_vulkan/internal/vulkan_shadow.h"
+
+namespace svulkan {
+
+static vk::UniqueImageView createLayerView(vk::Device device, vk::Image image, vk::Format format,
+                                           vk::ImageViewType type, uint32_t baseLayer,
+                                           uint32_t layerCount) {
+  vk::ComponentMapping componentMapping(vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eG,
+                                        vk::ComponentSwizzle::eB, vk::ComponentSwizzle::eA);
+  return device.createImageViewUnique(vk::ImageViewCreateInfo(
+      vk::ImageViewCreateFlags(), image, type, format, componentMapping,
+      vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, baseLayer, layerCount)));
+}
+
+VulkanShadowMaps::VulkanShadowMaps(vk::PhysicalDevice physicalDevice, vk::Device device,
+                                   vk::CommandPool commandPool, vk::Queue queue, uint32_t size,
+                                   uint32_t layers)
+    : mSize(size), mLayers(layers), mCachedMatrices(layers), mCachedVersions(layers),
+      mCachedValid(layers, false) {
+  mStaticImage = std::make_unique<VulkanImageData>(
+      physicalDevice, device, mFormat, vk::Extent2D(size, size), 1, vk::ImageTiling::eOptimal,
+      vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+      vk::ImageLayout::eUndefined, vk::MemoryPropertyFlagBits::eDeviceLocal,
+      vk::ImageAspectFlagBits::eDepth, layers);
+  mImage = std::make_unique<VulkanImageData>(
+      physicalDevice, device, mFormat, vk::Extent2D(size, size), 1, vk::ImageTiling::eOptimal,
+      vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransferDst |
+          vk::ImageUsageFlagBits::eSampled,
+      vk::ImageLayout::eUndefined, vk::MemoryPropertyFlagBits::eDeviceLocal,
+      vk::ImageAspectFlagBits::eDepth, layers);
+
+  // the shaders always sample an array, even with a single layer
+  mArrayView = createLayerView(device, mImage->mImage.get(), mFormat,
+                               vk::ImageViewType::e2DArray, 0, layers);
+  for (uint32_t i = 0; i < layers; ++i) {
+    mStaticLayerViews.push_back(createLayerView(device, mStaticImage->mImage.get(), mFormat,
+                                                vk::ImageViewType::e2D, i, 1));
+    mLayerViews.push_back(
+        createLayerView(device, mImage->mImage.get(), mFormat, vk::ImageViewType::e2D, i, 1));
+  }
+
+  mSampler = device.createSamplerUnique(vk::SamplerCreateInfo(
+      vk::SamplerCreateFlags(), vk::Filter::eNearest, vk::Filter::eNearest,
+      vk::SamplerMipmapMode::eNearest, vk::SamplerAddressMode::eClampToEdge,
+      vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge, 0.f, false,
+      0.f, true, vk::CompareOp::eLessOrEqual, 0.f, 0.f, vk::BorderColor::eFloatOpaqueWhite));
+
+  OneTimeSubmit(device, commandPool, queue, [&](vk::CommandBuffer commandBuffer) {
+    vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, layers);
+    std::array<vk::ImageMemoryBarrier, 2> barriers = {
+        vk::ImageMemoryBarrier({}, vk::AccessFlagBits::eTransferRead,
+                               vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferSrcOptimal,
+                               VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                               mStaticImage->mImage.get(), range),
+        vk::ImageMemoryBarrier({}, vk::AccessFlagBits::eShaderRead, vk::ImageLayout::eUndefined,
+                               vk::ImageLayout::eShaderReadOnlyOptimal, VK_QUEUE_FAMILY_IGNORED,
+                               VK_QUEUE_FAMILY_IGNORED, mImage->mImage.get(), range)};
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+                                  vk::PipelineStageFlagBits::eAllCommands, {}, nullptr, nullptr,
+                                  barriers);
+  });
+}
+
+void VulkanShadowMaps::initializeFramebuffers(vk::Device device, vk::RenderPass renderPass) {
+  if (mFramebuffers.size()) {
+    return;
+  }
+  for (uint32_t i = 0; i < mLayers; ++i) {
+    mStaticFramebuffers.push_back(createFramebuffer(
+        device, renderPass, {}, mStaticLayerViews[i].get(), vk::Extent2D(mSize, mSize)));
+    mFramebuffers.push_back(createFramebuffer(device, renderPass, {}, mLayerViews[i].get(),
+                                              vk::Extent2D(mSize, mSize)));
+  }
+}
+
+} // namespace svulkan
@@ -45,12 +45,49 @@ vk::UniqueDeviceMemory allocateMemory(vk::Device device,
       vk::MemoryAllocateInfo(memoryRequirements.size, memoryTypeIndex));
 }
 
+uint64_t &getCopiedToDeviceBytes() {
+  thread_local uint64_t bytes = 0;
+  return bytes;
+}
+
+uint32_t getFormatSize(vk::Format format) {
+  switch (format) {
+  case vk::Format::eR32G32B32A32Sfloat:
+  case vk::Format::eR32G32B32A32Uint:
+    return 16;
+  case vk::Format::eR16G16B16A16Sfloat:
+  case vk::Format::eR32G32Uint:
+    return 8;
+  case vk::Format::eR8G8B8A8Unorm:
+  case vk::Format::eR8G8B8A8Srgb:
+  case vk::Format::eR16G16Snorm:
+  case vk::Format::eR16G16Sfloat:
+  case vk::Format::eR32Sfloat:
+  case vk::Format::eR32Uint:
+  case vk::Format::eD32Sfloat:
+    return 4;
+  default:
+    return 0;
+  }
+}
+
+bool isDepthFormat(vk::Format format) {
+  return format == vk::Format::eD32Sfloat || format == vk::Format::eD16Unorm ||
+         format == vk::Format::eD24UnormS8Uint || format == vk::Format::eD32SfloatS8Uint;
+}
+
+bool isIntegerFormat(vk::Format format) {
+  return format == vk::Format::eR32Uint || format == vk::Format::eR32G32Uint ||
+         format == vk::Format::eR32G32B32Uint || format == vk::Format::eR32G32B32A32Uint;
+}
+
 void transitionImageLayout(vk::CommandBuffer commandBuffer, vk::Image image, vk::Format format,
                            vk::ImageLayout oldImageLayout, vk::ImageLayout newImageLayout,
                            vk::AccessFlags sourceAccessMask, vk::AccessFlags destAccessMask,
                            vk::PipelineStageFlags sourceStage, vk::PipelineStageFlags destStage,
-                           vk::ImageAspectFlags aspectMask, uint32_t mipLevels) {
-  vk::ImageSubresourceRange imageSubresourceRange(aspectMask, 0, mipLevels, 0, 1);
+                           vk::ImageAspectFlags aspectMask, uint32_t mipLevels,
+                           uint32_t arrayLayers) {
+  vk::ImageSubresourceRange imageSubresourceRange(aspectMask, 0, mipLevels, 0, arrayLayers);
   vk::ImageMemoryBarrier barrier(sourceAccessMask, destAccessMask, oldImageLayout, newImageLayout,
                                  VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, image,
                                  imageSubresourceRange);
@@ -0,0 +1,46 @@
+#include "sapien_vulkan/pass/compute.h"
+#include "sapien_vulkan/internal/vulkan_context.h"
+
+namespace svulkan
+{
+
+static vk::UniquePipeline createComputePipeline(std::string const &shaderDir, vk::Device device,
+                                                std::string const &shaderName,
+                                                std::vector<uint32_t> const &constants,
+                                                vk::PipelineLayout pipelineLayout) {
+  vk::UniquePipelineCache pipelineCache = device.createPipelineCacheUnique({});
+
+  auto csm = createShaderModule(device, shaderDir + "/" + shaderName + ".comp.spv");
+
+  std::vector<vk::SpecializationMapEntry> entries;
+  for (uint32_t i = 0; i < constants.size(); ++i) {
+    entries.push_back(vk::SpecializationMapEntry(i, i * sizeof(uint32_t), sizeof(uint32_t)));
+  }
+  vk::SpecializationInfo specializationInfo(static_cast<uint32_t>(entries.size()), entries.data(),
+                                            constants.size() * sizeof(uint32_t), constants.data());
+
+  vk::PipelineShaderStageCreateInfo pipelineShaderStageCreateInfo(
+      vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eCompute, csm.get(), "main",
+      &specializationInfo);
+
+  vk::ComputePipelineCreateInfo computePipelineCreateInfo(
+      vk::PipelineCreateFlags(), pipelineShaderStageCreateInfo, pipelineLayout);
+  return device.createComputePipelineUnique(pipelineCache.get(), computePipelineCreateInfo);
+}
+
+ComputePass::ComputePass(VulkanContext &context): mContext(&context) {}
+
+void ComputePass::initializePipeline(std::string const &shaderDir,
+                                     std::vector<vk::DescriptorSetLayout> const &layouts,
+                                     std::string const &shaderName, uint32_t pushConstantSize,
+                                     std::vector<uint32_t> const &specializationConstants) {
+  vk::PushConstantRange range{vk::ShaderStageFlagBits::eCompute, 0, pushConstantSize};
+  mPipelineLayout = mContext->getDevice().createPipelineLayoutUnique(vk::PipelineLayoutCreateInfo(
+      vk::PipelineLayoutCreateFlags(), layouts.size(), layouts.data(), pushConstantSize ? 1 : 0,
+      &range));
+
+  mPipeline = createComputePipeline(shaderDir, mContext->getDevice(), shaderName,
+                                    specializationConstants, mPipelineLayout.get());
+}
+
+}
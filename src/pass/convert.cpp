@@ -0,0 +1,143 @@
+#include "sapien_vulkan/pass/convert.h"
+#include "sapien_vulkan/internal/vulkan_context.h"
+#include "sapien_vulkan/internal/vulkan_image.h"
+#include <algorithm>
+
+namespace svulkan
+{
+
+ConvertPass::ConvertPass(VulkanContext &context): mContext(&context) {}
+
+void ConvertPass::initializePipeline(std::string const &shaderDir) {
+  mShaderDir = shaderDir;
+  mPipelines.clear();
+  mDescriptorSets.clear();
+  mDescriptorSetLayout = createDescriptorSetLayout(
+      mContext->getDevice(),
+      {{vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eCompute},
+       {vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute},
+       {vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute}});
+}
+
+ComputePass &ConvertPass::getPipeline(bool integer, DownloadConversion const &conversion) {
+  auto key = std::make_tuple(integer, conversion.type, conversion.linearDepth, conversion.srgb);
+  auto &pipeline = mPipelines[key];
+  if (!pipeline) {
+    pipeline = std::make_unique<ComputePass>(*mContext);
+    pipeline->initializePipeline(
+        mShaderDir, {mDescriptorSetLayout.get()}, integer ? "convert_uint" : "convert",
+        9 * sizeof(uint32_t),
+        {static_cast<uint32_t>(conversion.type), conversion.linearDepth, conversion.srgb});
+  }
+  return *pipeline;
+}
+
+uint32_t ConvertPass::getElementSize(ConvertedType type) {
+  switch (type) {
+  case ConvertedType::eUint8:
+    return 1;
+  case ConvertedType::eUint16:
+    return 2;
+  default:
+    return 4;
+  }
+}
+
+vk::Format ConvertPass::getOutputFormat(DownloadConversion const &conversion,
+                                        VulkanImageData const &image) {
+  static const vk::Format normalized[2][4] = {
+      {vk::Format::eR8Unorm, vk::Format::eR8G8Unorm, vk::Format::eR8G8B8Unorm,
+       vk::Format::eR8G8B8A8Unorm},
+      {vk::Format::eR16Unorm, vk::Format::eR16G16Unorm, vk::Format::eR16G16B16Unorm,
+       vk::Format::eR16G16B16A16Unorm}};
+  static const vk::Format integer[3][4] = {
+      {vk::Format::eR8Uint, vk::Format::eR8G8Uint, vk::Format::eR8G8B8Uint,
+       vk::Format::eR8G8B8A8Uint},
+      {vk::Format::eR16Uint, vk::Format::eR16G16Uint, vk::Format::eR16G16B16Uint,
+       vk::Format::eR16G16B16A16Uint},
+      {vk::Format::eR32Uint, vk::Format::eR32G32Uint, vk::Format::eR32G32B32Uint,
+       vk::Format::eR32G32B32A32Uint}};
+  static const vk::Format floating[4] = {vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat,
+                                         vk::Format::eR32G32B32Sfloat,
+                                         vk::Format::eR32G32B32A32Sfloat};
+
+  size_t channels = conversion.channels.size() - 1;
+  uint32_t type = static_cast<uint32_t>(conversion.type);
+  if (conversion.type == ConvertedType::eFloat32) {
+    return floating[channels];
+  }
+  // scaled floats keep no normalized meaning beyond 8 and 16 bits
+  if (isIntegerFormat(image.mFormat) || conversion.linearDepth ||
+      conversion.type == ConvertedType::eUint32) {
+    return integer[type][channels];
+  }
+  return normalized[type][channels];
+}
+
+void ConvertPass::record(vk::CommandBuffer commandBuffer, uint32_t index,
+                         VulkanImageData const &image, vk::Sampler sampler,
+                         DownloadConversion const &conversion, vk::Extent2D tile,
+                         uint32_t tileColumns, vk::DescriptorBufferInfo const &projections,
+                         vk::Buffer buffer, vk::DeviceSize offset, uint32_t elementCount) {
+  bool integer = isIntegerFormat(image.mFormat);
+  auto &pipeline = getPipeline(integer, conversion);
+
+  while (mDescriptorSets.size() <= index) {
+    mDescriptorSets.push_back(std::move(
+        mContext->getDevice()
+            .allocateDescriptorSetsUnique(vk::DescriptorSetAllocateInfo(
+                mContext->getDescriptorPool(), 1, &mDescriptorSetLayout.get()))
+            .front()));
+  }
+  vk::DescriptorSet descriptorSet = mDescriptorSets[index].get();
+
+  uint32_t elementSize = getElementSize(conversion.type);
+  uint32_t wordCount = (elementCount * elementSize + 3) / 4;
+  vk::DescriptorImageInfo imageInfo(sampler, image.getArrayImageView(),
+                                    vk::ImageLayout::eShaderReadOnlyOptimal);
+  vk::DescriptorBufferInfo bufferInfo(buffer, offset, wordCount * 4);
+  std::vector<vk::WriteDescriptorSet> writeDescriptorSets = {
+      vk::WriteDescriptorSet(descriptorSet, 0, 0, 1, vk::DescriptorType::eCombinedImageSampler,
+                             &imageInfo),
+      vk::WriteDescriptorSet(descriptorSet, 1, 0, 1, vk::DescriptorType::eStorageBuffer,
+                             nullptr, &bufferInfo),
+      vk::WriteDescriptorSet(descriptorSet, 2, 0, 1, vk::DescriptorType::eStorageBuffer,
+                             nullptr, &projections)};
+  mContext->getDevice().updateDescriptorSets(writeDescriptorSets, nullptr);
+
+  // one invocation per word, rows of groups keep large targets within the dispatch limit
+  uint32_t groupCount = (wordCount + 255) / 256;
+  uint32_t groupsX = std::min(groupCount, 65535u);
+  uint32_t groupsY = (groupCount + groupsX - 1) / groupsX;
+
+  uint32_t channels = 0;
+  for (uint32_t i = 0; i < conversion.channels.size(); ++i) {
+    channels |= conversion.channels[i] << (8 * i);
+  }
+  struct {
+    glm::uvec2 tileSize;
+    uint32_t tileColumns;
+    uint32_t layers;
+    uint32_t elementCount;
+    uint32_t channelCount;
+    uint32_t channels;
+    uint32_t rowLength;
+    float scale;
+  } pushConstants{{tile.width, tile.height},
+                  tileColumns,
+                  image.mArrayLayers,
+                  elementCount,
+                  static_cast<uint32_t>(conversion.channels.size()),
+                  channels,
+                  groupsX * 256,
+                  conversion.scale};
+
+  commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline.getPipeline());
+  commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                   pipeline.getPipelineLayout(), 0, descriptorSet, nullptr);
+  commandBuffer.pushConstants(pipeline.getPipelineLayout(), vk::ShaderStageFlagBits::eCompute, 0,
+                              sizeof(pushConstants), &pushConstants);
+  commandBuffer.dispatch(groupsX, groupsY, 1);
+}
+
+}
@@ -32,18 +32,20 @@ static vk::UniquePipeline createGraphicsPipeline(
     std::string const &shaderDir,
     vk::Device device, uint32_t numColorAttachments,
     vk::PipelineLayout pipelineLayout,
-    vk::RenderPass renderPass) {
+    vk::RenderPass renderPass,
+    bool octahedralNormal,
+    bool reconstructPosition) {
   vk::UniquePipelineCache pipelineCache = device.createPipelineCacheUnique({});
 
   auto vsm = createShaderModule(device, shaderDir + "/deferred.vert.spv");
   auto fsm = createShaderModule(device, shaderDir + "/deferred.frag.spv");
 
-  // TODO: clean up light count handling
-  std::vector<vk::SpecializationMapEntry> entries = { vk::SpecializationMapEntry(0, 0, sizeof(uint32_t)),
-    vk::SpecializationMapEntry(1, sizeof(uint32_t), sizeof(uint32_t)) };
-  std::vector<uint32_t> data = { NumDirectionalLights, NumPointLights };
+  std::vector<vk::SpecializationMapEntry> entries = {
+    vk::SpecializationMapEntry(0, 0, sizeof(vk::Bool32)),
+    vk::SpecializationMapEntry(1, sizeof(uint32_t), sizeof(vk::Bool32)) };
+  std::vector<uint32_t> data = { octahedralNormal, reconstructPosition };
   vk::SpecializationInfo specializationInfo(static_cast<uint32_t>(entries.size()), entries.data(),
-                                            2 * sizeof(uint32_t), data.data());
+                                            data.size() * sizeof(uint32_t), data.data());
 
   vk::PipelineShaderStageCreateInfo pipelineShaderStageCreateInfos[2] = {
     vk::PipelineShaderStageCreateInfo(vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eVertex,
@@ -106,7 +108,9 @@ DeferredPass::DeferredPass(VulkanContext &context): mContext(&context) {}
 void DeferredPass::initializePipeline(
     std::string shaderDir,
     std::vector<vk::DescriptorSetLayout> const &layouts,
-    std::vector<vk::Format> const &outputFormats) {
+    std::vector<vk::Format> const &outputFormats,
+    bool octahedralNormal,
+    bool reconstructPosition) {
   mShaderDir = shaderDir;
   mOutputFormats = outputFormats;
   mLayouts = layouts;
@@ -118,7 +122,8 @@ void DeferredPass::initializePipeline(
   mRenderPass = createRenderPass(mContext->getDevice(), outputFormats);
 
   mPipeline = createGraphicsPipeline(shaderDir, mContext->getDevice(), outputFormats.size(),
-                                     mPipelineLayout.get(), mRenderPass.get());
+                                     mPipelineLayout.get(), mRenderPass.get(), octahedralNormal,
+                                     reconstructPosition);
 }
 
 void DeferredPass::initializeFramebuffer(std::vector<vk::ImageView> const& outputImageViews,
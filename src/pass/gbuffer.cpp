@@ -8,25 +8,28 @@ static vk::UniqueRenderPass createRenderPass(vk::Device device, std::vector<vk::
                                              vk::Format depthFormat,
                                              vk::AttachmentLoadOp loadOp = vk::AttachmentLoadOp::eDontCare) {
   std::vector<vk::AttachmentDescription> attachmentDescriptions;
+  std::vector<vk::AttachmentReference> colorAttachments;
   for (vk::Format colorFormat : colorFormats) {
-    assert(colorFormat != vk::Format::eUndefined);
+    // an undefined format marks an output that is not kept by the renderer
+    if (colorFormat == vk::Format::eUndefined) {
+      colorAttachments.emplace_back(VK_ATTACHMENT_UNUSED, vk::ImageLayout::eUndefined);
+      continue;
+    }
+    colorAttachments.emplace_back(attachmentDescriptions.size(),
+                                  vk::ImageLayout::eColorAttachmentOptimal);
     attachmentDescriptions.push_back(vk::AttachmentDescription(
         vk::AttachmentDescriptionFlags(), colorFormat, vk::SampleCountFlagBits::e1, loadOp,
         vk::AttachmentStoreOp::eStore, vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
         vk::ImageLayout::eUndefined, vk::ImageLayout::eShaderReadOnlyOptimal));
   }
   assert(depthFormat != vk::Format::eUndefined);
+  vk::AttachmentReference depthAttachment(attachmentDescriptions.size(),
+                                          vk::ImageLayout::eDepthStencilAttachmentOptimal);
   attachmentDescriptions.push_back(vk::AttachmentDescription(
       vk::AttachmentDescriptionFlags(), depthFormat, vk::SampleCountFlagBits::e1, loadOp,
       vk::AttachmentStoreOp::eStore, vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
       vk::ImageLayout::eUndefined, vk::ImageLayout::eShaderReadOnlyOptimal));
 
-  std::vector<vk::AttachmentReference> colorAttachments;
-  for (uint32_t i = 0; i < colorFormats.size(); ++i) {
-    colorAttachments.emplace_back(i, vk::ImageLayout::eColorAttachmentOptimal);
-  }
-  vk::AttachmentReference depthAttachment(colorFormats.size(),
-                                          vk::ImageLayout::eDepthStencilAttachmentOptimal);
   vk::SubpassDescription subpassDescription(
       vk::SubpassDescriptionFlags(), vk::PipelineBindPoint::eGraphics,
       0, nullptr, colorAttachments.size(), colorAttachments.data(), nullptr, &depthAttachment);
@@ -39,18 +42,23 @@ static vk::UniqueRenderPass createRenderPass(vk::Device device, std::vector<vk::
 static vk::UniquePipeline createGraphicsPipeline(std::string const &shaderDir,
                                                  vk::Device device, uint32_t numColorAttachments,
                                                    vk::CullModeFlags cullMode, vk::FrontFace frontFace,
-                                                   vk::PipelineLayout pipelineLayout, vk::RenderPass renderPass
-                                                   ) {
+                                                   vk::PipelineLayout pipelineLayout, vk::RenderPass renderPass,
+                                                   bool octahedralNormal) {
   vk::UniquePipelineCache pipelineCache = device.createPipelineCacheUnique(vk::PipelineCacheCreateInfo());
 
   auto vsm = createShaderModule(device, shaderDir + "/gbuffer.vert.spv");
   auto fsm = createShaderModule(device, shaderDir + "/gbuffer.frag.spv");
 
+  vk::SpecializationMapEntry entry(0, 0, sizeof(vk::Bool32));
+  vk::Bool32 data = octahedralNormal;
+  vk::SpecializationInfo specializationInfo(1, &entry, sizeof(vk::Bool32), &data);
+
   std::array<vk::PipelineShaderStageCreateInfo, 2> pipelineShaderStageCreateInfos {
     vk::PipelineShaderStageCreateInfo(vk::PipelineShaderStageCreateFlags(),
                                       vk::ShaderStageFlagBits::eVertex, vsm.get(), "main", nullptr),
     vk::PipelineShaderStageCreateInfo(vk::PipelineShaderStageCreateFlags(),
-                                      vk::ShaderStageFlagBits::eFragment, fsm.get(), "main", nullptr)
+                                      vk::ShaderStageFlagBits::eFragment, fsm.get(), "main",
+                                      &specializationInfo)
   };
 
   // vertex input state
@@ -132,7 +140,8 @@ void GBufferPass::initializePipeline(
     std::vector<vk::Format> const &colorFormats,
     vk::Format depthFormat,
     vk::CullModeFlags cullMode,
-    vk::FrontFace frontFace) {
+    vk::FrontFace frontFace,
+    bool octahedralNormal) {
   // contains information about what buffers 
   mPipelineLayout = mContext->getDevice().createPipelineLayoutUnique(vk::PipelineLayoutCreateInfo(
       vk::PipelineLayoutCreateFlags(), layouts.size(), layouts.data()));
@@ -140,7 +149,8 @@ void GBufferPass::initializePipeline(
   mRenderPass = createRenderPass(mContext->getDevice(), colorFormats, depthFormat,
                                  vk::AttachmentLoadOp::eClear);
   mPipeline = createGraphicsPipeline(shaderDir, mContext->getDevice(), colorFormats.size(),
-                                     cullMode, frontFace, mPipelineLayout.get(), mRenderPass.get());
+                                     cullMode, frontFace, mPipelineLayout.get(), mRenderPass.get(),
+                                     octahedralNormal);
 
 }
 
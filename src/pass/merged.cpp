@@ -0,0 +1,338 @@
+#include "sapien_vulkan/pass/merged.h"
+#include "sapien_vulkan/internal/vulkan_context.h"
+#include "sapien_vulkan/uniform_buffers.h"
+
+namespace svulkan
+{
+
+static constexpr uint32_t GBufferSubpass = 0;
+static constexpr uint32_t LightingSubpass = 1;
+static constexpr uint32_t TransparencySubpass = 2;
+static constexpr uint32_t CompositeSubpass = 3;
+
+static vk::UniqueRenderPass createRenderPass(vk::Device device,
+                                             std::vector<vk::Format> const &gbufferFormats,
+                                             std::vector<bool> const &gbufferTransient,
+                                             vk::Format depthFormat, vk::Format lightingFormat,
+                                             bool lightingTransient, uint32_t viewCount) {
+  std::vector<vk::AttachmentDescription> attachmentDescriptions;
+
+  // G-buffer targets, undefined formats are not kept
+  std::vector<uint32_t> gbufferIndices;
+  for (uint32_t i = 0; i < gbufferFormats.size(); ++i) {
+    if (gbufferFormats[i] == vk::Format::eUndefined) {
+      gbufferIndices.push_back(VK_ATTACHMENT_UNUSED);
+      continue;
+    }
+    gbufferIndices.push_back(attachmentDescriptions.size());
+    attachmentDescriptions.push_back(vk::AttachmentDescription(
+        vk::AttachmentDescriptionFlags(), gbufferFormats[i], vk::SampleCountFlagBits::e1,
+        vk::AttachmentLoadOp::eClear,
+        gbufferTransient[i] ? vk::AttachmentStoreOp::eDontCare : vk::AttachmentStoreOp::eStore,
+        vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
+        vk::ImageLayout::eUndefined, vk::ImageLayout::eColorAttachmentOptimal));
+  }
+
+  assert(depthFormat != vk::Format::eUndefined);
+  uint32_t depthIndex = attachmentDescriptions.size();
+  attachmentDescriptions.push_back(vk::AttachmentDescription(
+      vk::AttachmentDescriptionFlags(), depthFormat, vk::SampleCountFlagBits::e1,
+      vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore,
+      vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
+      vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthStencilAttachmentOptimal));
+
+  uint32_t lightingIndex = attachmentDescriptions.size();
+  attachmentDescriptions.push_back(vk::AttachmentDescription(
+      vk::AttachmentDescriptionFlags(), lightingFormat, vk::SampleCountFlagBits::e1,
+      vk::AttachmentLoadOp::eDontCare,
+      lightingTransient ? vk::AttachmentStoreOp::eDontCare : vk::AttachmentStoreOp::eStore,
+      vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
+      vk::ImageLayout::eUndefined, vk::ImageLayout::eColorAttachmentOptimal));
+
+  uint32_t outputIndex = attachmentDescriptions.size();
+  attachmentDescriptions.push_back(vk::AttachmentDescription(
+      vk::AttachmentDescriptionFlags(), lightingFormat, vk::SampleCountFlagBits::e1,
+      vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eStore,
+      vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
+      vk::ImageLayout::eUndefined, vk::ImageLayout::eColorAttachmentOptimal));
+
+  // subpass 0: G-buffer
+  std::vector<vk::AttachmentReference> gbufferColors;
+  for (uint32_t index : gbufferIndices) {
+    gbufferColors.emplace_back(index, index == VK_ATTACHMENT_UNUSED
+                                          ? vk::ImageLayout::eUndefined
+                                          : vk::ImageLayout::eColorAttachmentOptimal);
+  }
+  vk::AttachmentReference depthAttachment(depthIndex,
+                                          vk::ImageLayout::eDepthStencilAttachmentOptimal);
+
+  // subpass 1: lighting reads albedo, position, specular, normal and depth
+  std::vector<vk::AttachmentReference> lightingInputs;
+  for (uint32_t i = 0; i < 4; ++i) {
+    lightingInputs.emplace_back(gbufferIndices[i], gbufferIndices[i] == VK_ATTACHMENT_UNUSED
+                                                       ? vk::ImageLayout::eUndefined
+                                                       : vk::ImageLayout::eShaderReadOnlyOptimal);
+  }
+  lightingInputs.emplace_back(depthIndex, vk::ImageLayout::eDepthStencilReadOnlyOptimal);
+  vk::AttachmentReference lightingColor(lightingIndex, vk::ImageLayout::eColorAttachmentOptimal);
+  std::vector<uint32_t> lightingPreserve;
+  for (uint32_t i = 4; i < gbufferIndices.size(); ++i) {
+    if (gbufferIndices[i] != VK_ATTACHMENT_UNUSED) {
+      lightingPreserve.push_back(gbufferIndices[i]);
+    }
+  }
+
+  // subpass 2: transparency blends into lighting and writes the G-buffer
+  std::vector<vk::AttachmentReference> transparencyColors = {lightingColor};
+  transparencyColors.insert(transparencyColors.end(), gbufferColors.begin(), gbufferColors.end());
+
+  // subpass 3: composite reads lighting
+  vk::AttachmentReference compositeInput(lightingIndex, vk::ImageLayout::eShaderReadOnlyOptimal);
+  vk::AttachmentReference compositeColor(outputIndex, vk::ImageLayout::eColorAttachmentOptimal);
+
+  std::array<vk::SubpassDescription, 4> subpassDescriptions = {
+      vk::SubpassDescription({}, vk::PipelineBindPoint::eGraphics, 0, nullptr,
+                             gbufferColors.size(), gbufferColors.data(), nullptr,
+                             &depthAttachment),
+      vk::SubpassDescription({}, vk::PipelineBindPoint::eGraphics, lightingInputs.size(),
+                             lightingInputs.data(), 1, &lightingColor, nullptr, nullptr,
+                             lightingPreserve.size(), lightingPreserve.data()),
+      vk::SubpassDescription({}, vk::PipelineBindPoint::eGraphics, 0, nullptr,
+                             transparencyColors.size(), transparencyColors.data(), nullptr,
+                             &depthAttachment),
+      vk::SubpassDescription({}, vk::PipelineBindPoint::eGraphics, 1, &compositeInput, 1,
+                             &compositeColor)};
+
+  std::array<vk::SubpassDependency, 3> dependencies = {
+      // G-buffer writes -> lighting input reads
+      vk::SubpassDependency(GBufferSubpass, LightingSubpass,
+                            vk::PipelineStageFlagBits::eColorAttachmentOutput |
+                                vk::PipelineStageFlagBits::eLateFragmentTests,
+                            vk::PipelineStageFlagBits::eFragmentShader,
+                            vk::AccessFlagBits::eColorAttachmentWrite |
+                                vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+                            vk::AccessFlagBits::eInputAttachmentRead,
+                            vk::DependencyFlagBits::eByRegion),
+      // lighting input reads and writes -> transparency attachment writes
+      vk::SubpassDependency(LightingSubpass, TransparencySubpass,
+                            vk::PipelineStageFlagBits::eFragmentShader |
+                                vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                            vk::PipelineStageFlagBits::eEarlyFragmentTests |
+                                vk::PipelineStageFlagBits::eLateFragmentTests |
+                                vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                            vk::AccessFlagBits::eInputAttachmentRead |
+                                vk::AccessFlagBits::eColorAttachmentWrite,
+                            vk::AccessFlagBits::eDepthStencilAttachmentRead |
+                                vk::AccessFlagBits::eDepthStencilAttachmentWrite |
+                                vk::AccessFlagBits::eColorAttachmentRead |
+                                vk::AccessFlagBits::eColorAttachmentWrite,
+                            vk::DependencyFlagBits::eByRegion),
+      // transparency writes -> composite input reads
+      vk::SubpassDependency(TransparencySubpass, CompositeSubpass,
+                            vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                            vk::PipelineStageFlagBits::eFragmentShader,
+                            vk::AccessFlagBits::eColorAttachmentWrite,
+                            vk::AccessFlagBits::eInputAttachmentRead,
+                            vk::DependencyFlagBits::eByRegion)};
+
+  vk::RenderPassCreateInfo info({}, attachmentDescriptions.size(), attachmentDescriptions.data(),
+                                subpassDescriptions.size(), subpassDescriptions.data(),
+                                dependencies.size(), dependencies.data());
+
+  // every subpass renders all views and each view only depends on the same view of the
+  // previous subpass; views are spatially correlated so the implementation may share work
+  uint32_t viewMask = (1u << viewCount) - 1;
+  std::array<uint32_t, 4> viewMasks = {viewMask, viewMask, viewMask, viewMask};
+  vk::RenderPassMultiviewCreateInfo multiviewInfo(viewMasks.size(), viewMasks.data(), 0,
+                                                  nullptr, 1, &viewMask);
+  if (viewCount > 1) {
+    for (auto &dependency : dependencies) {
+      dependency.dependencyFlags |= vk::DependencyFlagBits::eViewLocal;
+    }
+    info.pNext = &multiviewInfo;
+  }
+  return device.createRenderPassUnique(info);
+}
+
+static vk::UniquePipeline
+createGraphicsPipeline(vk::Device device, vk::ShaderModule vsm, vk::ShaderModule fsm,
+                       vk::SpecializationInfo const *specializationInfo, bool hasVertexInput,
+                       bool depthTest, bool blendFirstAttachment, uint32_t numColorAttachments,
+                       vk::CullModeFlags cullMode, vk::FrontFace frontFace,
+                       vk::PipelineLayout pipelineLayout, vk::RenderPass renderPass,
+                       uint32_t subpass) {
+  vk::UniquePipelineCache pipelineCache = device.createPipelineCacheUnique({});
+
+  std::array<vk::PipelineShaderStageCreateInfo, 2> pipelineShaderStageCreateInfos{
+      vk::PipelineShaderStageCreateInfo(vk::PipelineShaderStageCreateFlags(),
+                                        vk::ShaderStageFlagBits::eVertex, vsm, "main", nullptr),
+      vk::PipelineShaderStageCreateInfo(vk::PipelineShaderStageCreateFlags(),
+                                        vk::ShaderStageFlagBits::eFragment, fsm, "main",
+                                        specializationInfo)};
+
+  // vertex input state, full screen passes generate their vertices
+  std::vector<vk::VertexInputAttributeDescription> vertexInputAttributeDescriptions;
+  vk::PipelineVertexInputStateCreateInfo pipelineVertexInputStateCreateInfo;
+  vk::VertexInputBindingDescription vertexInputBindingDescription(0, sizeof(Vertex));
+  if (hasVertexInput) {
+    auto &vertexInputAttributeFormatOffset = Vertex::getFormatOffset();
+    for (uint32_t i = 0; i < vertexInputAttributeFormatOffset.size(); i++) {
+      vertexInputAttributeDescriptions.push_back(vk::VertexInputAttributeDescription(
+          i, 0, vertexInputAttributeFormatOffset[i].first,
+          vertexInputAttributeFormatOffset[i].second));
+    }
+    pipelineVertexInputStateCreateInfo.vertexBindingDescriptionCount = 1;
+    pipelineVertexInputStateCreateInfo.pVertexBindingDescriptions =
+        &vertexInputBindingDescription;
+    pipelineVertexInputStateCreateInfo.vertexAttributeDescriptionCount =
+        vertexInputAttributeDescriptions.size();
+    pipelineVertexInputStateCreateInfo.pVertexAttributeDescriptions =
+        vertexInputAttributeDescriptions.data();
+  }
+
+  // input assembly state
+  vk::PipelineInputAssemblyStateCreateInfo pipelineInputAssemblyStateCreateInfo(
+      vk::PipelineInputAssemblyStateCreateFlags(), vk::PrimitiveTopology::eTriangleList);
+
+  // viewport state
+  vk::PipelineViewportStateCreateInfo pipelineViewportStateCreateInfo(
+      vk::PipelineViewportStateCreateFlags(), 1, nullptr, 1, nullptr);
+
+  // rasterization state
+  vk::PipelineRasterizationStateCreateInfo pipelineRasterizationStateCreateInfo(
+      vk::PipelineRasterizationStateCreateFlags(), false, false, vk::PolygonMode::eFill, cullMode,
+      frontFace, false, 0.0f, 0.0f, 0.0f, 1.0f);
+
+  // multisample state
+  vk::PipelineMultisampleStateCreateInfo pipelineMultisampleStateCreateInfo;
+
+  // stencil state
+  vk::StencilOpState stencilOpState{};
+  vk::PipelineDepthStencilStateCreateInfo pipelineDepthStencilStateCreateInfo(
+      vk::PipelineDepthStencilStateCreateFlags(), depthTest, depthTest,
+      vk::CompareOp::eLessOrEqual, false, false, stencilOpState, stencilOpState);
+
+  // color blend state
+  vk::ColorComponentFlags colorComponentFlags(
+      vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+      vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA);
+  std::vector<vk::PipelineColorBlendAttachmentState> pipelineColorBlendAttachmentStates;
+  for (uint32_t i = 0; i < numColorAttachments; ++i) {
+    if (i == 0 && blendFirstAttachment) {
+      pipelineColorBlendAttachmentStates.push_back(vk::PipelineColorBlendAttachmentState(
+          true, vk::BlendFactor::eSrcAlpha, vk::BlendFactor::eOneMinusSrcAlpha, vk::BlendOp::eAdd,
+          vk::BlendFactor::eOne, vk::BlendFactor::eZero, vk::BlendOp::eAdd, colorComponentFlags));
+    } else {
+      pipelineColorBlendAttachmentStates.push_back(vk::PipelineColorBlendAttachmentState(
+          false, vk::BlendFactor::eZero, vk::BlendFactor::eZero, vk::BlendOp::eAdd,
+          vk::BlendFactor::eZero, vk::BlendFactor::eZero, vk::BlendOp::eAdd,
+          colorComponentFlags));
+    }
+  }
+  vk::PipelineColorBlendStateCreateInfo pipelineColorBlendStateCreateInfo(
+      vk::PipelineColorBlendStateCreateFlags(), false, vk::LogicOp::eNoOp, numColorAttachments,
+      pipelineColorBlendAttachmentStates.data(), {{1.0f, 1.0f, 1.0f, 1.0f}});
+
+  // dynamic state
+  vk::DynamicState dynamicStates[2] = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+  vk::PipelineDynamicStateCreateInfo pipelineDynamicStateCreateInfo(
+      vk::PipelineDynamicStateCreateFlags(), 2, dynamicStates);
+
+  // create pipeline
+  vk::GraphicsPipelineCreateInfo graphicsPipelineCreateInfo(
+      vk::PipelineCreateFlags(), pipelineShaderStageCreateInfos.size(),
+      pipelineShaderStageCreateInfos.data(), &pipelineVertexInputStateCreateInfo,
+      &pipelineInputAssemblyStateCreateInfo, nullptr, &pipelineViewportStateCreateInfo,
+      &pipelineRasterizationStateCreateInfo, &pipelineMultisampleStateCreateInfo,
+      &pipelineDepthStencilStateCreateInfo, &pipelineColorBlendStateCreateInfo,
+      &pipelineDynamicStateCreateInfo, pipelineLayout, renderPass, subpass);
+  return device.createGraphicsPipelineUnique(pipelineCache.get(), graphicsPipelineCreateInfo);
+}
+
+MergedPass::MergedPass(VulkanContext &context) : mContext(&context) {}
+
+void MergedPass::initializePipeline(std::string const &shaderDir,
+                                    std::vector<vk::DescriptorSetLayout> const &geometryLayouts,
+                                    std::vector<vk::DescriptorSetLayout> const &lightingLayouts,
+                                    std::vector<vk::DescriptorSetLayout> const &compositeLayouts,
+                                    std::vector<vk::Format> const &gbufferFormats,
+                                    std::vector<bool> const &gbufferTransient,
+                                    vk::Format depthFormat, vk::Format lightingFormat,
+                                    bool lightingTransient, vk::CullModeFlags cullMode,
+                                    vk::FrontFace frontFace, bool octahedralNormal,
+                                    bool reconstructPosition, uint32_t viewCount) {
+  auto device = mContext->getDevice();
+  assert(gbufferFormats.size() == gbufferTransient.size() && gbufferFormats.size() >= 5);
+
+  mRenderPass = createRenderPass(device, gbufferFormats, gbufferTransient, depthFormat,
+                                 lightingFormat, lightingTransient, viewCount);
+
+  mGBufferPipelineLayout = device.createPipelineLayoutUnique(vk::PipelineLayoutCreateInfo(
+      vk::PipelineLayoutCreateFlags(), geometryLayouts.size(), geometryLayouts.data()));
+  mLightingPipelineLayout = device.createPipelineLayoutUnique(vk::PipelineLayoutCreateInfo(
+      vk::PipelineLayoutCreateFlags(), lightingLayouts.size(), lightingLayouts.data()));
+  vk::PushConstantRange range{vk::ShaderStageFlagBits::eFragment, 0, sizeof(float)};
+  mTransparencyPipelineLayout = device.createPipelineLayoutUnique(vk::PipelineLayoutCreateInfo(
+      vk::PipelineLayoutCreateFlags(), geometryLayouts.size(), geometryLayouts.data(), 1, &range));
+  mCompositePipelineLayout = device.createPipelineLayoutUnique(vk::PipelineLayoutCreateInfo(
+      vk::PipelineLayoutCreateFlags(), compositeLayouts.size(), compositeLayouts.data()));
+
+  // gbuffer takes the normal encoding, lighting passes also take the position mode
+  vk::SpecializationMapEntry gbufferEntry(0, 0, sizeof(vk::Bool32));
+  vk::Bool32 gbufferData = octahedralNormal;
+  vk::SpecializationInfo gbufferSpecialization(1, &gbufferEntry, sizeof(vk::Bool32),
+                                               &gbufferData);
+
+  std::vector<vk::SpecializationMapEntry> entries = {
+      vk::SpecializationMapEntry(0, 0, sizeof(vk::Bool32)),
+      vk::SpecializationMapEntry(1, sizeof(uint32_t), sizeof(vk::Bool32))};
+  std::vector<uint32_t> data = {octahedralNormal, reconstructPosition};
+  vk::SpecializationInfo lightingSpecialization(static_cast<uint32_t>(entries.size()),
+                                                entries.data(), data.size() * sizeof(uint32_t),
+                                                data.data());
+
+  uint32_t numGBufferColors = gbufferFormats.size();
+
+  // shaders that read the camera index it by view with multiview
+  std::string suffix = viewCount > 1 ? "_multiview" : "";
+
+  {
+    auto vsm = createShaderModule(device, shaderDir + "/gbuffer" + suffix + ".vert.spv");
+    auto fsm = createShaderModule(device, shaderDir + "/gbuffer.frag.spv");
+    mGBufferPipeline = createGraphicsPipeline(
+        device, vsm.get(), fsm.get(), &gbufferSpecialization, true, true, false,
+        numGBufferColors, cullMode, frontFace, mGBufferPipelineLayout.get(), mRenderPass.get(),
+        GBufferSubpass);
+  }
+  {
+    auto vsm = createShaderModule(device, shaderDir + "/deferred.vert.spv");
+    auto fsm = createShaderModule(device, shaderDir + "/deferred_subpass" + suffix + ".frag.spv");
+    mLightingPipeline = createGraphicsPipeline(
+        device, vsm.get(), fsm.get(), &lightingSpecialization, false, false, false, 1,
+        vk::CullModeFlagBits::eFront, vk::FrontFace::eCounterClockwise,
+        mLightingPipelineLayout.get(), mRenderPass.get(), LightingSubpass);
+  }
+  {
+    auto vsm = createShaderModule(device, shaderDir + "/transparency" + suffix + ".vert.spv");
+    auto fsm = createShaderModule(device, shaderDir + "/transparency" + suffix + ".frag.spv");
+    mTransparencyPipeline = createGraphicsPipeline(
+        device, vsm.get(), fsm.get(), &lightingSpecialization, true, true, true,
+        numGBufferColors + 1, cullMode, frontFace, mTransparencyPipelineLayout.get(),
+        mRenderPass.get(), TransparencySubpass);
+  }
+  {
+    auto vsm = createShaderModule(device, shaderDir + "/composite.vert.spv");
+    auto fsm = createShaderModule(device, shaderDir + "/composite_subpass.frag.spv");
+    mCompositePipeline = createGraphicsPipeline(
+        device, vsm.get(), fsm.get(), nullptr, false, false, false, 1,
+        vk::CullModeFlagBits::eFront, vk::FrontFace::eCounterClockwise,
+        mCompositePipelineLayout.get(), mRenderPass.get(), CompositeSubpass);
+  }
+}
+
+void MergedPass::initializeFramebuffer(std::vector<vk::ImageView> const &imageViews,
+                                       vk::Extent2D const &extent) {
+  mFramebuffer = createFramebuffer(mContext->getDevice(), mRenderPass.get(), imageViews, {}, extent);
+}
+
+}
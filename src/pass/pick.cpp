@@ -0,0 +1,64 @@
+#include "sapien_vulkan/pass/pick.h"
+#include "sapien_vulkan/internal/vulkan_context.h"
+#include "sapien_vulkan/internal/vulkan_image.h"
+
+namespace svulkan
+{
+
+PickPass::PickPass(VulkanContext &context): mContext(&context) {}
+
+void PickPass::initializePipeline(std::string const &shaderDir) {
+  mShaderDir = shaderDir;
+  mFloatPipeline.reset();
+  mUintPipeline.reset();
+  mDescriptorSetLayout = createDescriptorSetLayout(
+      mContext->getDevice(),
+      {{vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eCompute},
+       {vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute},
+       {vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute}});
+}
+
+ComputePass &PickPass::getPipeline(bool integer) {
+  auto &pipeline = integer ? mUintPipeline : mFloatPipeline;
+  if (!pipeline) {
+    pipeline = std::make_unique<ComputePass>(*mContext);
+    pipeline->initializePipeline(mShaderDir, {mDescriptorSetLayout.get()},
+                                 integer ? "pick_uint" : "pick", 2 * sizeof(uint32_t));
+  }
+  return *pipeline;
+}
+
+vk::UniqueDescriptorSet PickPass::record(vk::CommandBuffer commandBuffer,
+                                         VulkanImageData const &image, vk::Sampler sampler,
+                                         vk::DescriptorBufferInfo const &points,
+                                         vk::DescriptorBufferInfo const &values,
+                                         uint32_t pointCount, uint32_t outputOffset) {
+  auto &pipeline = getPipeline(isIntegerFormat(image.mFormat));
+  auto descriptorSet =
+      std::move(mContext->getDevice()
+                    .allocateDescriptorSetsUnique(vk::DescriptorSetAllocateInfo(
+                        mContext->getDescriptorPool(), 1, &mDescriptorSetLayout.get()))
+                    .front());
+
+  vk::DescriptorImageInfo imageInfo(sampler, image.getArrayImageView(),
+                                    vk::ImageLayout::eShaderReadOnlyOptimal);
+  std::vector<vk::WriteDescriptorSet> writeDescriptorSets = {
+      vk::WriteDescriptorSet(descriptorSet.get(), 0, 0, 1,
+                             vk::DescriptorType::eCombinedImageSampler, &imageInfo),
+      vk::WriteDescriptorSet(descriptorSet.get(), 1, 0, 1, vk::DescriptorType::eStorageBuffer,
+                             nullptr, &points),
+      vk::WriteDescriptorSet(descriptorSet.get(), 2, 0, 1, vk::DescriptorType::eStorageBuffer,
+                             nullptr, &values)};
+  mContext->getDevice().updateDescriptorSets(writeDescriptorSets, nullptr);
+
+  uint32_t pushConstants[2] = {pointCount, outputOffset};
+  commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline.getPipeline());
+  commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                   pipeline.getPipelineLayout(), 0, descriptorSet.get(), nullptr);
+  commandBuffer.pushConstants(pipeline.getPipelineLayout(), vk::ShaderStageFlagBits::eCompute, 0,
+                              sizeof(pushConstants), pushConstants);
+  commandBuffer.dispatch((pointCount + 63) / 64, 1, 1);
+  return descriptorSet;
+}
+
+}
@@ -0,0 +1,161 @@
+#include "sapien_vulkan/pass/sensor.h"
+#include "sapien_vulkan/internal/vulkan_context.h"
+
+namespace svulkan
+{
+
+static vk::UniqueRenderPass createRenderPass(vk::Device device, vk::Format segmentationFormat,
+                                             vk::Format depthFormat) {
+  std::vector<vk::AttachmentDescription> attachmentDescriptions;
+  std::vector<vk::AttachmentReference> colorAttachments;
+  if (segmentationFormat != vk::Format::eUndefined) {
+    colorAttachments.emplace_back(0, vk::ImageLayout::eColorAttachmentOptimal);
+    attachmentDescriptions.push_back(vk::AttachmentDescription(
+        vk::AttachmentDescriptionFlags(), segmentationFormat, vk::SampleCountFlagBits::e1,
+        vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore,
+        vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
+        vk::ImageLayout::eUndefined, vk::ImageLayout::eColorAttachmentOptimal));
+  }
+  assert(depthFormat != vk::Format::eUndefined);
+  vk::AttachmentReference depthAttachment(attachmentDescriptions.size(),
+                                          vk::ImageLayout::eDepthStencilAttachmentOptimal);
+  attachmentDescriptions.push_back(vk::AttachmentDescription(
+      vk::AttachmentDescriptionFlags(), depthFormat, vk::SampleCountFlagBits::e1,
+      vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore,
+      vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
+      vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthStencilAttachmentOptimal));
+
+  vk::SubpassDescription subpassDescription(
+      vk::SubpassDescriptionFlags(), vk::PipelineBindPoint::eGraphics,
+      0, nullptr, colorAttachments.size(), colorAttachments.data(), nullptr, &depthAttachment);
+
+  return device.createRenderPassUnique(
+      vk::RenderPassCreateInfo({}, attachmentDescriptions.size(), attachmentDescriptions.data(),
+                               1, &subpassDescription));
+}
+
+/** fsm may be empty for a vertex-only pipeline */
+static vk::UniquePipeline createGraphicsPipeline(vk::Device device, vk::ShaderModule vsm,
+                                                 vk::ShaderModule fsm,
+                                                 uint32_t numColorAttachments,
+                                                 vk::CullModeFlags cullMode,
+                                                 vk::FrontFace frontFace,
+                                                 vk::PipelineLayout pipelineLayout,
+                                                 vk::RenderPass renderPass) {
+  vk::UniquePipelineCache pipelineCache = device.createPipelineCacheUnique(vk::PipelineCacheCreateInfo());
+
+  std::vector<vk::PipelineShaderStageCreateInfo> pipelineShaderStageCreateInfos {
+    vk::PipelineShaderStageCreateInfo(vk::PipelineShaderStageCreateFlags(),
+                                      vk::ShaderStageFlagBits::eVertex, vsm, "main", nullptr)
+  };
+  if (fsm) {
+    pipelineShaderStageCreateInfos.push_back(vk::PipelineShaderStageCreateInfo(
+        vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eFragment, fsm, "main",
+        nullptr));
+  }
+
+  // vertex input state, only position and uv are read
+  auto &vertexInputAttributeFormatOffset = Vertex::getFormatOffset();
+  std::array<vk::VertexInputAttributeDescription, 2> vertexInputAttributeDescriptions{
+      vk::VertexInputAttributeDescription(0, 0, vertexInputAttributeFormatOffset[0].first,
+                                          vertexInputAttributeFormatOffset[0].second),
+      vk::VertexInputAttributeDescription(2, 0, vertexInputAttributeFormatOffset[2].first,
+                                          vertexInputAttributeFormatOffset[2].second)};
+  vk::VertexInputBindingDescription vertexInputBindingDescription(0, sizeof(Vertex));
+  vk::PipelineVertexInputStateCreateInfo pipelineVertexInputStateCreateInfo(
+      vk::PipelineVertexInputStateCreateFlags(), 1, &vertexInputBindingDescription,
+      vertexInputAttributeDescriptions.size(), vertexInputAttributeDescriptions.data());
+
+  // input assembly state
+  vk::PipelineInputAssemblyStateCreateInfo pipelineInputAssemblyStateCreateInfo(
+      vk::PipelineInputAssemblyStateCreateFlags(), vk::PrimitiveTopology::eTriangleList);
+
+  // viewport state 
+  vk::PipelineViewportStateCreateInfo pipelineViewportStateCreateInfo(vk::PipelineViewportStateCreateFlags(),
+                                                                      1, nullptr, 1, nullptr);
+
+  // rasterization state
+  vk::PipelineRasterizationStateCreateInfo pipelineRasterizationStateCreateInfo(
+      vk::PipelineRasterizationStateCreateFlags(), false, false, vk::PolygonMode::eFill, cullMode, frontFace,
+      false, 0.0f, 0.0f, 0.0f, 1.0f);
+
+  // multisample state
+  vk::PipelineMultisampleStateCreateInfo pipelineMultisampleStateCreateInfo;
+
+  // stencil state
+  vk::StencilOpState stencilOpState{};
+  vk::PipelineDepthStencilStateCreateInfo pipelineDepthStencilStateCreateInfo(
+      vk::PipelineDepthStencilStateCreateFlags(), true, true, vk::CompareOp::eLessOrEqual,
+      false, false, stencilOpState, stencilOpState);
+
+  // color blend state
+  vk::ColorComponentFlags colorComponentFlags(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+                                              vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA);
+  std::vector<vk::PipelineColorBlendAttachmentState> pipelineColorBlendAttachmentStates;
+  for (uint32_t i = 0; i < numColorAttachments; ++i) {
+    pipelineColorBlendAttachmentStates.push_back(vk::PipelineColorBlendAttachmentState(
+        false, vk::BlendFactor::eZero, vk::BlendFactor::eZero, vk::BlendOp::eAdd, vk::BlendFactor::eZero,
+        vk::BlendFactor::eZero, vk::BlendOp::eAdd, colorComponentFlags));
+  }
+  vk::PipelineColorBlendStateCreateInfo pipelineColorBlendStateCreateInfo(
+      vk::PipelineColorBlendStateCreateFlags(), false, vk::LogicOp::eNoOp, numColorAttachments,
+      pipelineColorBlendAttachmentStates.data(), {{1.0f, 1.0f, 1.0f, 1.0f}});
+
+  // dynamic state
+  vk::DynamicState dynamicStates[2] = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+  vk::PipelineDynamicStateCreateInfo pipelineDynamicStateCreateInfo(vk::PipelineDynamicStateCreateFlags(), 2,
+                                                                    dynamicStates);
+
+  // create pipeline
+  vk::GraphicsPipelineCreateInfo graphicsPipelineCreateInfo(
+      vk::PipelineCreateFlags(),
+      pipelineShaderStageCreateInfos.size(), pipelineShaderStageCreateInfos.data(),
+      &pipelineVertexInputStateCreateInfo,
+      &pipelineInputAssemblyStateCreateInfo, nullptr, &pipelineViewportStateCreateInfo,
+      &pipelineRasterizationStateCreateInfo, &pipelineMultisampleStateCreateInfo,
+      &pipelineDepthStencilStateCreateInfo, &pipelineColorBlendStateCreateInfo,
+      &pipelineDynamicStateCreateInfo, pipelineLayout, renderPass);
+  return device.createGraphicsPipelineUnique(pipelineCache.get(), graphicsPipelineCreateInfo);
+}
+
+SensorPass::SensorPass(VulkanContext &context): mContext(&context) {}
+
+void SensorPass::initializePipeline(std::string const &shaderDir,
+                                    std::vector<vk::DescriptorSetLayout> const &layouts,
+                                    vk::Format segmentationFormat, vk::Format depthFormat,
+                                    vk::CullModeFlags cullMode, vk::FrontFace frontFace) {
+  auto device = mContext->getDevice();
+  assert(layouts.size() == 4);
+
+  // the plain pipeline does not touch materials, sets 0-2 stay compatible between the two
+  mPipelineLayout = device.createPipelineLayoutUnique(
+      vk::PipelineLayoutCreateInfo(vk::PipelineLayoutCreateFlags(), 3, layouts.data()));
+  mAlphaTestPipelineLayout = device.createPipelineLayoutUnique(vk::PipelineLayoutCreateInfo(
+      vk::PipelineLayoutCreateFlags(), layouts.size(), layouts.data()));
+
+  mRenderPass = createRenderPass(device, segmentationFormat, depthFormat);
+
+  bool segmentation = segmentationFormat != vk::Format::eUndefined;
+  uint32_t numColorAttachments = segmentation ? 1 : 0;
+  auto vsm = createShaderModule(device, shaderDir + "/sensor.vert.spv");
+  auto alphaFsm = createShaderModule(device, shaderDir + "/sensor_alpha.frag.spv");
+  vk::UniqueShaderModule fsm;
+  if (segmentation) {
+    fsm = createShaderModule(device, shaderDir + "/sensor.frag.spv");
+  }
+
+  mPipeline = createGraphicsPipeline(device, vsm.get(), fsm.get(), numColorAttachments, cullMode,
+                                     frontFace, mPipelineLayout.get(), mRenderPass.get());
+  mAlphaTestPipeline = createGraphicsPipeline(device, vsm.get(), alphaFsm.get(),
+                                              numColorAttachments, cullMode, frontFace,
+                                              mAlphaTestPipelineLayout.get(), mRenderPass.get());
+}
+
+void SensorPass::initializeFramebuffer(std::vector<vk::ImageView> const &colorImageViews,
+                                       vk::ImageView depthImageView,
+                                       vk::Extent2D const &extent) {
+  mFramebuffer = createFramebuffer(
+      mContext->getDevice(), mRenderPass.get(), colorImageViews, depthImageView, extent);
+}
+
+}
@@ -0,0 +1,132 @@
+#include "sapien_vulkan/pass/shadow.h"
+#include "sapien_vulkan/internal/vulkan_context.h"
+
+namespace svulkan
+{
+
+static vk::UniqueRenderPass createRenderPass(vk::Device device, vk::Format depthFormat,
+                                             vk::AttachmentLoadOp loadOp,
+                                             vk::ImageLayout initialLayout,
+                                             vk::ImageLayout finalLayout) {
+  vk::AttachmentDescription attachmentDescription(
+      vk::AttachmentDescriptionFlags(), depthFormat, vk::SampleCountFlagBits::e1, loadOp,
+      vk::AttachmentStoreOp::eStore, vk::AttachmentLoadOp::eDontCare,
+      vk::AttachmentStoreOp::eDontCare, initialLayout, finalLayout);
+  vk::AttachmentReference depthAttachment(0, vk::ImageLayout::eDepthStencilAttachmentOptimal);
+
+  vk::SubpassDescription subpassDescription(vk::SubpassDescriptionFlags(),
+                                            vk::PipelineBindPoint::eGraphics, 0, nullptr, 0,
+                                            nullptr, nullptr, &depthAttachment);
+
+  // the layer is copied from or sampled before and after the pass
+  std::array<vk::SubpassDependency, 2> dependencies = {
+      vk::SubpassDependency(
+          VK_SUBPASS_EXTERNAL, 0,
+          vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eFragmentShader |
+              vk::PipelineStageFlagBits::eComputeShader,
+          vk::PipelineStageFlagBits::eEarlyFragmentTests |
+              vk::PipelineStageFlagBits::eLateFragmentTests,
+          vk::AccessFlagBits::eTransferWrite,
+          vk::AccessFlagBits::eDepthStencilAttachmentRead |
+              vk::AccessFlagBits::eDepthStencilAttachmentWrite),
+      vk::SubpassDependency(
+          0, VK_SUBPASS_EXTERNAL, vk::PipelineStageFlagBits::eLateFragmentTests,
+          vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eFragmentShader |
+              vk::PipelineStageFlagBits::eComputeShader,
+          vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+          vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eShaderRead)};
+
+  return device.createRenderPassUnique(
+      vk::RenderPassCreateInfo({}, 1, &attachmentDescription, 1, &subpassDescription,
+                               dependencies.size(), dependencies.data()));
+}
+
+static vk::UniquePipeline createGraphicsPipeline(vk::Device device, vk::ShaderModule vsm,
+                                                 vk::PipelineLayout pipelineLayout,
+                                                 vk::RenderPass renderPass) {
+  vk::UniquePipelineCache pipelineCache = device.createPipelineCacheUnique(vk::PipelineCacheCreateInfo());
+
+  std::vector<vk::PipelineShaderStageCreateInfo> pipelineShaderStageCreateInfos {
+    vk::PipelineShaderStageCreateInfo(vk::PipelineShaderStageCreateFlags(),
+                                      vk::ShaderStageFlagBits::eVertex, vsm, "main", nullptr)
+  };
+
+  // vertex input state, only position is read
+  auto &vertexInputAttributeFormatOffset = Vertex::getFormatOffset();
+  vk::VertexInputAttributeDescription vertexInputAttributeDescription(
+      0, 0, vertexInputAttributeFormatOffset[0].first, vertexInputAttributeFormatOffset[0].second);
+  vk::VertexInputBindingDescription vertexInputBindingDescription(0, sizeof(Vertex));
+  vk::PipelineVertexInputStateCreateInfo pipelineVertexInputStateCreateInfo(
+      vk::PipelineVertexInputStateCreateFlags(), 1, &vertexInputBindingDescription, 1,
+      &vertexInputAttributeDescription);
+
+  // input assembly state
+  vk::PipelineInputAssemblyStateCreateInfo pipelineInputAssemblyStateCreateInfo(
+      vk::PipelineInputAssemblyStateCreateFlags(), vk::PrimitiveTopology::eTriangleList);
+
+  // viewport state
+  vk::PipelineViewportStateCreateInfo pipelineViewportStateCreateInfo(vk::PipelineViewportStateCreateFlags(),
+                                                                      1, nullptr, 1, nullptr);
+
+  // rasterization state, no culling since meshes are not guaranteed to be closed;
+  // depth bias against self shadowing
+  vk::PipelineRasterizationStateCreateInfo pipelineRasterizationStateCreateInfo(
+      vk::PipelineRasterizationStateCreateFlags(), false, false, vk::PolygonMode::eFill,
+      vk::CullModeFlagBits::eNone, vk::FrontFace::eCounterClockwise, true, 1.25f, 0.0f, 1.75f,
+      1.0f);
+
+  // multisample state
+  vk::PipelineMultisampleStateCreateInfo pipelineMultisampleStateCreateInfo;
+
+  // stencil state
+  vk::StencilOpState stencilOpState{};
+  vk::PipelineDepthStencilStateCreateInfo pipelineDepthStencilStateCreateInfo(
+      vk::PipelineDepthStencilStateCreateFlags(), true, true, vk::CompareOp::eLessOrEqual,
+      false, false, stencilOpState, stencilOpState);
+
+  // color blend state
+  vk::PipelineColorBlendStateCreateInfo pipelineColorBlendStateCreateInfo(
+      vk::PipelineColorBlendStateCreateFlags(), false, vk::LogicOp::eNoOp, 0, nullptr,
+      {{1.0f, 1.0f, 1.0f, 1.0f}});
+
+  // dynamic state
+  vk::DynamicState dynamicStates[2] = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+  vk::PipelineDynamicStateCreateInfo pipelineDynamicStateCreateInfo(vk::PipelineDynamicStateCreateFlags(), 2,
+                                                                    dynamicStates);
+
+  // create pipeline
+  vk::GraphicsPipelineCreateInfo graphicsPipelineCreateInfo(
+      vk::PipelineCreateFlags(),
+      pipelineShaderStageCreateInfos.size(), pipelineShaderStageCreateInfos.data(),
+      &pipelineVertexInputStateCreateInfo,
+      &pipelineInputAssemblyStateCreateInfo, nullptr, &pipelineViewportStateCreateInfo,
+      &pipelineRasterizationStateCreateInfo, &pipelineMultisampleStateCreateInfo,
+      &pipelineDepthStencilStateCreateInfo, &pipelineColorBlendStateCreateInfo,
+      &pipelineDynamicStateCreateInfo, pipelineLayout, renderPass);
+  return device.createGraphicsPipelineUnique(pipelineCache.get(), graphicsPipelineCreateInfo);
+}
+
+ShadowPass::ShadowPass(VulkanContext &context): mContext(&context) {}
+
+void ShadowPass::initializePipeline(std::string const &shaderDir,
+                                    vk::DescriptorSetLayout objectLayout,
+                                    vk::Format depthFormat) {
+  auto device = mContext->getDevice();
+
+  vk::PushConstantRange range{vk::ShaderStageFlagBits::eVertex, 0, sizeof(glm::mat4)};
+  mPipelineLayout = device.createPipelineLayoutUnique(
+      vk::PipelineLayoutCreateInfo(vk::PipelineLayoutCreateFlags(), 1, &objectLayout, 1, &range));
+
+  mStaticRenderPass =
+      createRenderPass(device, depthFormat, vk::AttachmentLoadOp::eClear,
+                       vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferSrcOptimal);
+  mDynamicRenderPass = createRenderPass(device, depthFormat, vk::AttachmentLoadOp::eLoad,
+                                        vk::ImageLayout::eDepthStencilAttachmentOptimal,
+                                        vk::ImageLayout::eShaderReadOnlyOptimal);
+
+  auto vsm = createShaderModule(device, shaderDir + "/shadow.vert.spv");
+  mPipeline = createGraphicsPipeline(device, vsm.get(), mPipelineLayout.get(),
+                                     mStaticRenderPass.get());
+}
+
+}
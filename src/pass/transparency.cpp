@@ -9,9 +9,16 @@ static vk::UniqueRenderPass createRenderPass(vk::Device device, std::vector<vk::
                                              vk::Format depthFormat,
                                              vk::AttachmentLoadOp loadOp = vk::AttachmentLoadOp::eDontCare) {
   std::vector<vk::AttachmentDescription> attachmentDescriptions;
+  std::vector<vk::AttachmentReference> colorAttachments;
 
   for (uint32_t i = 0; i < colorFormats.size(); ++i) {
-    assert(colorFormats[i] != vk::Format::eUndefined);
+    // an undefined format marks an output that is not kept by the renderer
+    if (colorFormats[i] == vk::Format::eUndefined) {
+      colorAttachments.emplace_back(VK_ATTACHMENT_UNUSED, vk::ImageLayout::eUndefined);
+      continue;
+    }
+    colorAttachments.emplace_back(attachmentDescriptions.size(),
+                                  vk::ImageLayout::eColorAttachmentOptimal);
     attachmentDescriptions.push_back(vk::AttachmentDescription(
         vk::AttachmentDescriptionFlags(), colorFormats[i], vk::SampleCountFlagBits::e1, loadOp,
         vk::AttachmentStoreOp::eStore, vk::AttachmentLoadOp::eDontCare,
@@ -22,18 +29,14 @@ static vk::UniqueRenderPass createRenderPass(vk::Device device, std::vector<vk::
   }
 
   assert(depthFormat != vk::Format::eUndefined);
+  vk::AttachmentReference depthAttachment(attachmentDescriptions.size(),
+                                          vk::ImageLayout::eDepthStencilAttachmentOptimal);
   attachmentDescriptions.push_back(vk::AttachmentDescription(
       vk::AttachmentDescriptionFlags(), depthFormat, vk::SampleCountFlagBits::e1, loadOp,
       vk::AttachmentStoreOp::eStore, vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
       // depth was in the gbuffer texture
       vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eDepthStencilAttachmentOptimal));
 
-  std::vector<vk::AttachmentReference> colorAttachments;
-  for (uint32_t i = 0; i < colorFormats.size(); ++i) {
-    colorAttachments.emplace_back(i, vk::ImageLayout::eColorAttachmentOptimal);
-  }
-  vk::AttachmentReference depthAttachment(colorFormats.size(),
-                                          vk::ImageLayout::eDepthStencilAttachmentOptimal);
   vk::SubpassDescription subpassDescription(
       vk::SubpassDescriptionFlags(), vk::PipelineBindPoint::eGraphics,
       0, nullptr, colorAttachments.size(), colorAttachments.data(), nullptr, &depthAttachment);
@@ -46,19 +49,18 @@ static vk::UniqueRenderPass createRenderPass(vk::Device device, std::vector<vk::
 static vk::UniquePipeline createGraphicsPipeline(std::string const &shaderDir,
                                                  vk::Device device, uint32_t numColorAttachments,
                                                    vk::CullModeFlags cullMode, vk::FrontFace frontFace,
-                                                   vk::PipelineLayout pipelineLayout, vk::RenderPass renderPass
-                                                   ) {
+                                                   vk::PipelineLayout pipelineLayout, vk::RenderPass renderPass,
+                                                   bool octahedralNormal) {
   vk::UniquePipelineCache pipelineCache = device.createPipelineCacheUnique(vk::PipelineCacheCreateInfo());
 
   auto vsm = createShaderModule(device, shaderDir + "/transparency.vert.spv");
   auto fsm = createShaderModule(device, shaderDir + "/transparency.frag.spv");
 
-  // TODO: clean up light count handling
-  std::vector<vk::SpecializationMapEntry> entries = { vk::SpecializationMapEntry(0, 0, sizeof(uint32_t)),
-    vk::SpecializationMapEntry(1, sizeof(uint32_t), sizeof(uint32_t)) };
-  std::vector<uint32_t> data = { NumDirectionalLights, NumPointLights };
+  std::vector<vk::SpecializationMapEntry> entries = {
+    vk::SpecializationMapEntry(0, 0, sizeof(vk::Bool32)) };
+  std::vector<uint32_t> data = { octahedralNormal };
   vk::SpecializationInfo specializationInfo(static_cast<uint32_t>(entries.size()), entries.data(),
-                                            2 * sizeof(uint32_t), data.data());
+                                            data.size() * sizeof(uint32_t), data.data());
 
   std::array<vk::PipelineShaderStageCreateInfo, 2> pipelineShaderStageCreateInfos {
     vk::PipelineShaderStageCreateInfo(vk::PipelineShaderStageCreateFlags(),
@@ -154,7 +156,8 @@ void TransparencyPass::initializePipeline(
     std::vector<vk::Format> const &colorFormats,
     vk::Format depthFormat,
     vk::CullModeFlags cullMode,
-    vk::FrontFace frontFace) {
+    vk::FrontFace frontFace,
+    bool octahedralNormal) {
 
     vk::PushConstantRange range{vk::ShaderStageFlagBits::eFragment, 0, sizeof(float)};
     mPipelineLayout = mContext->getDevice().createPipelineLayoutUnique(vk::PipelineLayoutCreateInfo(
@@ -163,7 +166,8 @@ void TransparencyPass::initializePipeline(
   mRenderPass = createRenderPass(mContext->getDevice(), colorFormats, depthFormat,
                                  vk::AttachmentLoadOp::eLoad);
   mPipeline = createGraphicsPipeline(shaderDir, mContext->getDevice(), colorFormats.size(),
-                                     cullMode, frontFace, mPipelineLayout.get(), mRenderPass.get());
+                                     cullMode, frontFace, mPipelineLayout.get(), mRenderPass.get(),
+                                     octahedralNormal);
 
 }
 
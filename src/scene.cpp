@@ -1,19 +1,17 @@
 #include "sapien_vulkan/scene.h"
+#include "sapien_vulkan/common/profiler.h"
 
 namespace svulkan {
 
 void Scene::updateUBO() {
+  SVULKAN_PROFILE_SCOPE("Scene::updateUBO");
   if (mLightUpdated) {
     SceneUBO ubo{};
     ubo.ambientLight = ambientLight;
-    for (uint32_t i = 0; i < std::min<uint32_t>(NumDirectionalLights, directionalLights.size());
-         ++i) {
-      ubo.directionalLights[i] = directionalLights[i];
-    }
-    for (uint32_t i = 0; i < std::min<uint32_t>(NumPointLights, pointLights.size()); ++i) {
-      ubo.pointLights[i] = pointLights[i];
-    }
+    ubo.numDirectionalLights = directionalLights.size();
+    ubo.numPointLights = pointLights.size();
     mVulkanScene->updateUBO(ubo);
+    mVulkanScene->updateLights(directionalLights, pointLights);
     mLightUpdated = false;
   }
 }
@@ -91,12 +89,24 @@ static void prepareObjectTree(Object *obj, const glm::mat4 &parentModelMat,
 }
 
 void Scene::prepareObjectsForRender() {
+  SVULKAN_PROFILE_SCOPE("Scene::prepareObjectsForRender");
   forceRemove();
   opaque_objects.clear();
   transparent_objects.clear();
   for (auto &obj : objects) {
     prepareObjectTree(obj.get(), glm::mat4(1.f), opaque_objects, transparent_objects);
   }
+
+  std::vector<std::pair<Object *, glm::mat4>> snapshot;
+  for (auto obj : opaque_objects) {
+    if (obj->isStatic()) {
+      snapshot.push_back({obj, obj->mGlobalModelMatrixCache});
+    }
+  }
+  if (snapshot != mStaticSnapshot) {
+    mStaticSnapshot = std::move(snapshot);
+    mStaticVersion++;
+  }
 }
 
 } // namespace svulkan